@@ -14,7 +14,7 @@ entity pwm_rgb_controller_avalon is
     -- avalon memory-mapped slave interface
     avs_read      : in std_logic;
     avs_write     : in std_logic;
-    avs_address   : in std_logic_vector(1 downto 0);
+    avs_address   : in std_logic_vector(2 downto 0);
     avs_readdata  : out std_logic_vector(31 downto 0);
     avs_writedata : in std_logic_vector(31 downto 0);
     -- external I/O; export to top-level
@@ -36,6 +36,13 @@ architecture arch of pwm_rgb_controller_avalon is
   -- set period initially to 1 ms
   signal reg_period : std_logic_vector(31 downto 0) := (24 => '1', others => '0');
 
+  -- free-running counts of bus reads and writes, for profiling; a read
+  -- takes two clocks (one wait cycle), so every other clock of avs_read
+  -- starts a new one
+  signal perf_reads  : unsigned(31 downto 0) := (others => '0');
+  signal perf_writes : unsigned(31 downto 0) := (others => '0');
+  signal read_wait   : std_logic := '0';
+
   component pwm_controller is
 	  port (
 		 clk : in std_logic;
@@ -86,10 +93,12 @@ begin
   begin
     if rising_edge(clk) and avs_read = '1' then
       case avs_address is
-        when "00" => avs_readdata   <= reg_red_duty_cycle;
-        when "01" => avs_readdata   <= reg_green_duty_cycle;
-        when "10" => avs_readdata   <= reg_blue_duty_cycle;
-        when "11" => avs_readdata <= reg_period;
+        when "000" => avs_readdata   <= reg_red_duty_cycle;
+        when "001" => avs_readdata   <= reg_green_duty_cycle;
+        when "010" => avs_readdata   <= reg_blue_duty_cycle;
+        when "011" => avs_readdata <= reg_period;
+        when "100" => avs_readdata <= std_logic_vector(perf_reads);
+        when "101" => avs_readdata <= std_logic_vector(perf_writes);
         when others => avs_readdata <= (others => '0');
       end case;
     end if;
@@ -104,13 +113,34 @@ begin
       reg_period <= (21 => '1', others => '0');
     elsif rising_edge(clk) and avs_write = '1' then
       case avs_address is
-        when "00"   => reg_red_duty_cycle <= avs_writedata(31 downto 0);
-        when "01"   => reg_green_duty_cycle         <= avs_writedata(31 downto 0);
-        when "10"   => reg_blue_duty_cycle     <= avs_writedata(31 downto 0);
-        when "11" => reg_period <= avs_writedata(31 downto 0);
+        when "000"   => reg_red_duty_cycle <= avs_writedata(31 downto 0);
+        when "001"   => reg_green_duty_cycle         <= avs_writedata(31 downto 0);
+        when "010"   => reg_blue_duty_cycle     <= avs_writedata(31 downto 0);
+        when "011" => reg_period <= avs_writedata(31 downto 0);
         when others => null; -- ignore writes to unused registers
       end case;
     end if;
   end process;
 
+  perf_counters : process (clk, rst)
+  begin
+    if rst = '1' then
+      perf_reads  <= (others => '0');
+      perf_writes <= (others => '0');
+      read_wait   <= '0';
+    elsif rising_edge(clk) then
+      if avs_read = '1' then
+        if read_wait = '0' then
+          perf_reads <= perf_reads + 1;
+        end if;
+        read_wait <= not read_wait;
+      else
+        read_wait <= '0';
+      end if;
+      if avs_write = '1' then
+        perf_writes <= perf_writes + 1;
+      end if;
+    end if;
+  end process;
+
 end architecture arch;
\ No newline at end of file
@@ -14,9 +14,13 @@ entity stop_button_avalon is
     -- avalon memory-mapped slave interface
     avs_read      : in std_logic;
     avs_write     : in std_logic;
-    avs_address   : in std_logic;
+    avs_address   : in std_logic_vector(3 downto 0);
     avs_readdata  : out std_logic_vector(31 downto 0);
     avs_writedata : in std_logic_vector(31 downto 0);
+    -- avalon interrupt sender; high while a press interrupt is pending and enabled
+    irq           : out std_logic;
+    -- position of the moving led, from the ws2811 driver; captured on a press
+    strip_index   : in std_logic_vector(31 downto 0);
     -- external I/O; export to top-level
     stop_button        : in std_ulogic
   );
@@ -31,6 +35,37 @@ architecture arch of stop_button_avalon is
   -- the LSB will hold the stop state (0 for run; 1 for stop)
   signal stop       : std_logic_vector(31 downto 0) := (others => '0');
 
+  -- interrupt control register
+  -- bit 0: interrupt enable (R/W)
+  -- bit 1: interrupt pending, set by a press (R, write 1 to clear)
+  signal irq_enable  : std_logic := '0';
+  signal irq_pending : std_logic := '0';
+
+  -- free-running count of presses, read in the upper half of the status register
+  -- software keeps the last value it saw, so a press is never lost between
+  -- reading the status and clearing it
+  signal press_count : unsigned(15 downto 0) := (others => '0');
+
+  -- hit detection: strip_index is captured on the same clock edge as the press
+  -- and compared against the win window [win_lo, win_hi]
+  signal hit_index : std_logic_vector(31 downto 0) := (others => '0');
+  signal win_lo    : std_logic_vector(31 downto 0) := (others => '0');
+  signal win_hi    : std_logic_vector(31 downto 0) := (others => '0');
+  signal won       : std_logic := '0';
+
+  -- the press register reads like status and clears the latched press and
+  -- win in the same clock, so no press can land between the read and the
+  -- clear; press_hit keeps the hit_index that went with that read
+  signal press_read : std_logic;
+  signal press_hit  : std_logic_vector(31 downto 0) := (others => '0');
+
+  -- free-running counts of bus reads and writes, for profiling; a read
+  -- takes two clocks (one wait cycle), so every other clock of avs_read
+  -- starts a new one
+  signal perf_reads  : unsigned(31 downto 0) := (others => '0');
+  signal perf_writes : unsigned(31 downto 0) := (others => '0');
+  signal read_wait   : std_logic := '0';
+
   component async_conditioner is
     port
         (
@@ -52,12 +87,33 @@ begin
     sync => blip
 	  );
 
+  -- a read lasts two clocks; the value the bus takes is the one registered
+  -- on the first, so that is where the press register clears
+  press_read <= '1' when avs_read = '1' and read_wait = '0' and avs_address = "1000" else '0';
+
   avalon_register_read : process (clk)
   begin
     if rising_edge(clk) and avs_read = '1' then
       case avs_address is
-        when '0' =>
+        when "0000" =>
           avs_readdata   <= stop;
+        when "0001" =>
+          avs_readdata   <= (1 => irq_pending, 0 => irq_enable, others => '0');
+        when "0010" | "1000" =>
+          -- status: press count in the upper half, win in bit 1, latched press in bit 0
+          avs_readdata   <= std_logic_vector(press_count) & x"000" & "00" & won & stop(0);
+        when "0011" =>
+          avs_readdata   <= hit_index;
+        when "0100" =>
+          avs_readdata   <= win_lo;
+        when "0101" =>
+          avs_readdata   <= win_hi;
+        when "0110" =>
+          avs_readdata   <= std_logic_vector(perf_reads);
+        when "0111" =>
+          avs_readdata   <= std_logic_vector(perf_writes);
+        when "1001" =>
+          avs_readdata   <= press_hit;
         when others => avs_readdata <= (others => '0');
       end case;
     end if;
@@ -67,19 +123,105 @@ begin
   begin
     if rst = '1' then
         stop(0) <= '0';
+        press_count <= (others => '0');
+        hit_index <= (others => '0');
+        won <= '0';
+        press_hit <= (others => '0');
     elsif rising_edge(clk) then
+        if press_read = '1' then
+            press_hit <= hit_index;
+        end if;
+
         -- NOTE: a write will not be allowed to happen when the button is pressed (during 20ms pulse)
         -- this means that the C code would think the game is reset, but the stop_button condition would stay high
         -- this corrisponds to the user hitting the button the instant the game is reset (no bad consequences)
+        -- the same goes for a write 1 to clear of the status register: the press wins
+        -- a press on the same clock as a read of the press register isn't in
+        -- what the read returns, so it is what the next read reports
         if blip = '1' then
             stop(0) <= '1';
+            press_count <= press_count + 1;
+            hit_index <= strip_index;
+            if unsigned(strip_index) >= unsigned(win_lo) and unsigned(strip_index) <= unsigned(win_hi) then
+                won <= '1';
+            elsif press_read = '1' then
+                won <= '0';
+            end if;
+        elsif press_read = '1' then
+            stop(0) <= '0';
+            won <= '0';
         elsif avs_write = '1' then
             case avs_address is
-                when '0'   => stop <= avs_writedata(31 downto 0);
+                when "0000" => stop <= avs_writedata(31 downto 0);
+                when "0010" =>
+                    -- status: write 1 to bit 0 to clear the latched press, to bit 1 to clear the win
+                    if avs_writedata(0) = '1' then
+                        stop(0) <= '0';
+                    end if;
+                    if avs_writedata(1) = '1' then
+                        won <= '0';
+                    end if;
                 when others => null; -- ignore writes to unused registers
             end case;
         end if;
     end if;
   end process;
 
+  win_window : process (clk, rst)
+  begin
+    if rst = '1' then
+      win_lo <= (others => '0');
+      win_hi <= (others => '0');
+    elsif rising_edge(clk) and avs_write = '1' then
+      case avs_address is
+        when "0100" => win_lo <= avs_writedata(31 downto 0);
+        when "0101" => win_hi <= avs_writedata(31 downto 0);
+        when others => null;
+      end case;
+    end if;
+  end process;
+
+  -- the press (blip) sets the pending bit; a write of 1 to bit 1 clears it.
+  -- a press on the same clock edge as the clear wins so no press is lost.
+  interrupt_control : process (clk, rst)
+  begin
+    if rst = '1' then
+      irq_enable  <= '0';
+      irq_pending <= '0';
+    elsif rising_edge(clk) then
+      if avs_write = '1' and avs_address = "0001" then
+        irq_enable <= avs_writedata(0);
+      end if;
+
+      if blip = '1' then
+        irq_pending <= '1';
+      elsif avs_write = '1' and avs_address = "0001" and avs_writedata(1) = '1' then
+        irq_pending <= '0';
+      end if;
+    end if;
+  end process;
+
+  irq <= irq_pending and irq_enable;
+
+  perf_counters : process (clk, rst)
+  begin
+    if rst = '1' then
+      perf_reads  <= (others => '0');
+      perf_writes <= (others => '0');
+      read_wait   <= '0';
+    elsif rising_edge(clk) then
+      if avs_read = '1' then
+        if read_wait = '0' then
+          perf_reads <= perf_reads + 1;
+        end if;
+        read_wait <= not read_wait;
+      else
+        read_wait <= '0';
+      end if;
+      if avs_write = '1' then
+        perf_writes <= perf_writes + 1;
+      end if;
+    end if;
+  end process;
+
 end architecture arch;
\ No newline at end of file
@@ -0,0 +1,144 @@
+-- altera vhdl_input_version vhdl_2008
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+
+-- Colour stage of the pixel path, on 16 bits per colour: every colour is
+-- scaled by brightness (0 to 256, 256 leaves it as it is) and then, with
+-- gamma set, mapped through the gamma table. The table has 256 words; word
+-- v holds what red, green and blue of value v become, in bits 23-16, 15-8
+-- and 7-0, so each colour can have its own curve. Between two entries the
+-- output is interpolated from the low byte, so the table keeps 16 bits of
+-- precision. Every channel has its own copy of the table, all written
+-- together. The output settles within five clocks of a new input.
+entity colour_correction is
+  generic (
+    CHANNELS : integer
+  );
+  port (
+    clk        : in std_logic;
+    -- gamma table window, one word per address; reads are registered
+    write      : in std_logic;
+    address    : in unsigned(7 downto 0);
+    writedata  : in std_logic_vector(31 downto 0);
+    readdata   : out std_logic_vector(31 downto 0);
+    -- settings, only to be changed between frames
+    gamma      : in std_logic;
+    brightness : in natural range 0 to 256;
+    -- channel c in bits 48c+47 downto 48c, red at the top
+    pixel_in   : in std_logic_vector(48 * CHANNELS - 1 downto 0);
+    pixel_out  : out std_logic_vector(48 * CHANNELS - 1 downto 0)
+  );
+end entity colour_correction;
+
+architecture rtl of colour_correction is
+
+  component pixel_ram is
+    generic (
+      ADDR_WIDTH : natural;
+      DATA_WIDTH : natural
+    );
+    port (
+      clk     : in std_logic;
+      a_addr  : in unsigned(ADDR_WIDTH - 1 downto 0);
+      a_write : in std_logic;
+      a_wdata : in std_logic_vector(DATA_WIDTH - 1 downto 0);
+      a_rdata : out std_logic_vector(DATA_WIDTH - 1 downto 0);
+      b_addr  : in unsigned(ADDR_WIDTH - 1 downto 0);
+      b_rdata : out std_logic_vector(DATA_WIDTH - 1 downto 0)
+    );
+  end component;
+
+  type table_array is array (0 to CHANNELS - 1) of std_logic_vector(23 downto 0);
+
+  signal table_rdata : table_array;
+
+  -- The table is read twice per value, entry v and entry v + 1, on
+  -- alternate clocks; phase_read is the entry the table output belongs to
+  signal phase      : std_logic := '0';
+  signal phase_read : std_logic := '0';
+
+begin
+
+  readdata <= x"00" & table_rdata(0);
+
+  table_phase : process (clk)
+  begin
+    if rising_edge(clk) then
+      phase      <= not phase;
+      phase_read <= phase;
+    end if;
+  end process;
+
+  CHANNEL : for c in 0 to CHANNELS - 1 generate
+  begin
+
+    -- one table per colour, so all three can be looked up at once
+    COLOUR : for k in 0 to 2 generate
+      signal scaled    : unsigned(15 downto 0) := (others => '0');
+      signal entry     : unsigned(7 downto 0);
+      signal looked    : std_logic_vector(7 downto 0);
+      signal lower     : unsigned(7 downto 0) := (others => '0');
+      signal upper     : unsigned(7 downto 0) := (others => '0');
+      signal corrected : unsigned(15 downto 0) := (others => '0');
+    begin
+
+      scale : process (clk)
+        variable product : unsigned(24 downto 0);
+      begin
+        if rising_edge(clk) then
+          product := unsigned(pixel_in(48 * c + 16 * k + 15 downto 48 * c + 16 * k)) * to_unsigned(brightness, 9);
+          scaled  <= product(23 downto 8);
+        end if;
+      end process;
+
+      -- the entry above the last one is the last one
+      entry <= scaled(15 downto 8) + 1 when phase = '1' and scaled(15 downto 8) /= 255 else
+               scaled(15 downto 8);
+
+      GAMMA_TABLE : pixel_ram
+      generic map(
+        ADDR_WIDTH => 8,
+        DATA_WIDTH => 8
+      )
+      port map
+      (
+        clk     => clk,
+        a_addr  => address,
+        a_write => write,
+        a_wdata => writedata(8 * k + 7 downto 8 * k),
+        a_rdata => table_rdata(c)(8 * k + 7 downto 8 * k),
+        b_addr  => entry,
+        b_rdata => looked
+      );
+
+      interpolate : process (clk)
+        variable value : signed(17 downto 0);
+      begin
+        if rising_edge(clk) then
+          if phase_read = '0' then
+            lower <= unsigned(looked);
+          else
+            upper <= unsigned(looked);
+          end if;
+
+          -- lower * (256 - low byte) + upper * low byte, written so that
+          -- it needs one multiplier; never below 0 or above 65280
+          value := signed("00" & lower & x"00") +
+                   (signed("0" & upper) - signed("0" & lower)) * signed("0" & scaled(7 downto 0));
+          if gamma = '1' then
+            corrected <= unsigned(value(15 downto 0));
+          else
+            corrected <= scaled;
+          end if;
+        end if;
+      end process;
+
+      pixel_out(48 * c + 16 * k + 15 downto 48 * c + 16 * k) <= std_logic_vector(corrected);
+
+    end generate;
+
+  end generate;
+
+end architecture rtl;
@@ -0,0 +1,213 @@
+-- altera vhdl_input_version vhdl_2008
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+
+-- Avalon-MM read master that copies a frame from memory, e.g. HPS DDR over
+-- the FPGA-to-SDRAM port, into the back page of the framebuffer. The frame
+-- is laid out like the pixel window: word n goes to word n mod row of
+-- channel n / row, where row is the words a channel takes in the current
+-- mode, so CHANNELS * row words are read from base on. start takes the
+-- address; the fetch begins once hold is low and is done when the last
+-- word has come back, which done pulses. Reads are issued in bursts of up
+-- to 2**(BURST_WIDTH - 1) words, several outstanding. A start while busy
+-- is ignored. The fetch has the framebuffer to itself while busy, so the
+-- words can be written as they come, with no FIFO. If the port takes no
+-- command and returns no word for TIMEOUT clocks, or abort is pulsed, the
+-- fetch gives up: busy drops, done doesn't pulse, and failed is set until
+-- the next start. A read command the port hasn't taken yet stays asserted,
+-- as Avalon requires, until it does. Words the port still owes, the ones
+-- that command asks for included, are thrown away as they come; the next
+-- fetch waits for them, and gives up the same way if they don't.
+entity frame_fetch is
+  generic (
+    CHANNELS      : integer;
+    FB_ADDR_WIDTH : natural; -- words in each channel's bank, as address bits
+    BURST_WIDTH   : natural;
+    TIMEOUT       : positive -- clocks without progress before giving up
+  );
+  port (
+    clk           : in std_logic;
+    rst           : in std_logic;
+    start         : in std_logic;
+    abort         : in std_logic;
+    base          : in std_logic_vector(31 downto 0);
+    -- words of a channel's bank in use in the current mode
+    row           : in natural range 1 to 2**FB_ADDR_WIDTH;
+    -- the framebuffer is taken and the fetch waits to begin
+    hold          : in std_logic;
+    busy          : out std_logic;
+    done          : out std_logic;
+    failed        : out std_logic;
+    -- avalon memory-mapped master, byte addresses
+    address       : out std_logic_vector(31 downto 0);
+    read          : out std_logic;
+    burstcount    : out std_logic_vector(BURST_WIDTH - 1 downto 0);
+    readdata      : in std_logic_vector(31 downto 0);
+    readdatavalid : in std_logic;
+    waitrequest   : in std_logic;
+    -- framebuffer port
+    fb_write      : out std_logic;
+    fb_channel    : out natural range 0 to CHANNELS - 1;
+    fb_word       : out unsigned(FB_ADDR_WIDTH - 1 downto 0);
+    fb_wdata      : out std_logic_vector(31 downto 0)
+  );
+end entity frame_fetch;
+
+architecture rtl of frame_fetch is
+
+  constant MAX_BURST : natural := 2**(BURST_WIDTH - 1);
+  constant MAX_WORDS : natural := CHANNELS * 2**FB_ADDR_WIDTH;
+
+  signal base_reg : unsigned(31 downto 0) := (others => '0');
+  signal pending  : std_logic := '0';
+  signal fetching : std_logic := '0';
+  signal total    : natural range 0 to MAX_WORDS := 0;
+  -- row as it was when the fetch began
+  signal row_reg  : natural range 1 to 2**FB_ADDR_WIDTH := 1;
+
+  -- words asked for, and where the next word to come back goes
+  signal requested : natural range 0 to MAX_WORDS := 0;
+  signal received  : natural range 0 to MAX_WORDS := 0;
+  signal channel   : natural range 0 to CHANNELS - 1 := 0;
+  signal word      : natural range 0 to 2**FB_ADDR_WIDTH - 1 := 0;
+
+  signal read_int : std_logic;
+  signal burst    : natural range 0 to MAX_BURST;
+
+  -- words a fetch that was given up on still has coming, which are thrown
+  -- away as they come; the next fetch waits for them
+  signal stale    : natural range 0 to MAX_WORDS := 0;
+  -- a command that was on the bus when the fetch was given up, held there
+  -- until the port takes it; its words are then stale too
+  signal held         : std_logic := '0';
+  signal held_address : std_logic_vector(31 downto 0) := (others => '0');
+  signal held_burst   : natural range 0 to MAX_BURST := 0;
+  -- clocks the port has taken no command and returned no word while a
+  -- fetch or its wait for stale words was on
+  signal waiting  : std_logic;
+  signal idle     : natural range 0 to TIMEOUT := 0;
+  signal accepted : std_logic;
+  signal released : std_logic;
+  signal arrived  : std_logic;
+  signal give_up  : std_logic;
+
+begin
+
+  busy <= pending or fetching;
+
+  read_int   <= '1' when fetching = '1' and requested < total else '0';
+  burst      <= MAX_BURST when total - requested > MAX_BURST else total - requested;
+  read       <= read_int or held;
+  address    <= held_address when held = '1' else std_logic_vector(base_reg + to_unsigned(requested * 4, 32));
+  burstcount <= std_logic_vector(to_unsigned(held_burst, BURST_WIDTH)) when held = '1' else
+                std_logic_vector(to_unsigned(burst, BURST_WIDTH));
+
+  accepted <= read_int and not waitrequest;
+  released <= held and not waitrequest;
+  arrived  <= fetching and readdatavalid;
+  waiting  <= '1' when fetching = '1' or (pending = '1' and (stale /= 0 or held = '1')) else '0';
+  give_up  <= '1' when (abort = '1' and (pending = '1' or fetching = '1')) or
+                       (waiting = '1' and idle = TIMEOUT and accepted = '0' and released = '0' and
+                        readdatavalid = '0') else '0';
+
+  fb_write   <= arrived;
+  fb_channel <= channel;
+  fb_word    <= to_unsigned(word, FB_ADDR_WIDTH);
+  fb_wdata   <= readdata;
+
+  fetch : process (clk, rst)
+    variable owed : natural range 0 to MAX_WORDS;
+    variable left : natural range 0 to MAX_WORDS;
+  begin
+    if rst = '1' then
+      pending  <= '0';
+      fetching <= '0';
+      done     <= '0';
+      failed   <= '0';
+      stale    <= 0;
+      held     <= '0';
+      idle     <= 0;
+    elsif rising_edge(clk) then
+      done <= '0';
+
+      if start = '1' and pending = '0' and fetching = '0' then
+        base_reg <= unsigned(base(31 downto 2)) & "00";
+        pending  <= '1';
+        failed   <= '0';
+      end if;
+
+      left := stale;
+      if stale /= 0 and readdatavalid = '1' then
+        left := left - 1;
+      end if;
+      if released = '1' then
+        held <= '0';
+        left := left + held_burst;
+      end if;
+      stale <= left;
+
+      if pending = '1' and hold = '0' and stale = 0 and held = '0' then
+        pending   <= '0';
+        fetching  <= '1';
+        total     <= CHANNELS * row;
+        row_reg   <= row;
+        requested <= 0;
+        received  <= 0;
+        channel   <= 0;
+        word      <= 0;
+      end if;
+
+      if accepted = '1' then
+        requested <= requested + burst;
+      end if;
+
+      if waiting = '0' or accepted = '1' or released = '1' or readdatavalid = '1' then
+        idle <= 0;
+      elsif idle < TIMEOUT then
+        idle <= idle + 1;
+      end if;
+
+      if arrived = '1' then
+        if word < row_reg - 1 then
+          word <= word + 1;
+        elsif channel < CHANNELS - 1 then
+          channel <= channel + 1;
+          word    <= 0;
+        end if;
+        received <= received + 1;
+        if received = total - 1 then
+          fetching <= '0';
+          done     <= '1';
+        end if;
+      end if;
+
+      -- the words asked for and not yet come, this clock's command and
+      -- word included, are still on their way; a command the port hasn't
+      -- taken stays on the bus until it does
+      if give_up = '1' then
+        if fetching = '1' then
+          owed := requested - received;
+          if accepted = '1' then
+            owed := owed + burst;
+          end if;
+          if arrived = '1' then
+            owed := owed - 1;
+          end if;
+          stale <= owed;
+          if read_int = '1' and accepted = '0' then
+            held         <= '1';
+            held_address <= std_logic_vector(base_reg + to_unsigned(requested * 4, 32));
+            held_burst   <= burst;
+          end if;
+        end if;
+        pending  <= '0';
+        fetching <= '0';
+        done     <= '0';
+        failed   <= '1';
+      end if;
+    end if;
+  end process;
+
+end architecture rtl;
@@ -0,0 +1,98 @@
+-- altera vhdl_input_version vhdl_2008
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+
+-- Converts colours written as hue, saturation and value (bits 23-16, 15-8
+-- and 7-0, 8 bits each) to red, green and blue. The hue goes once round
+-- the colour wheel from 0 to 255, red at 0, green at 85, blue at 170, and
+-- hue_offset is added to it first, so one write turns every colour. Hue
+-- 6h / 256 picks one of six sectors and 6h mod 256 the point in it; the
+-- divisions by 255 are exact. hsv_to_rgb() in sw/de10nano_hal.hpp does
+-- the same sums. The output follows the input four clocks later.
+entity hsv_to_rgb is
+  generic (
+    CHANNELS : integer
+  );
+  port (
+    clk        : in std_logic;
+    hue_offset : in unsigned(7 downto 0);
+    -- channel c in bits 24c+23 downto 24c
+    hsv_in     : in std_logic_vector(24 * CHANNELS - 1 downto 0);
+    rgb_out    : out std_logic_vector(24 * CHANNELS - 1 downto 0)
+  );
+end entity hsv_to_rgb;
+
+architecture rtl of hsv_to_rgb is
+
+  -- x / 255 rounded down, for x up to 255 * 255
+  function div255(x : unsigned(15 downto 0)) return unsigned is
+    variable sum : unsigned(16 downto 0);
+  begin
+    sum := ('0' & x) + x(15 downto 8) + 1;
+    return sum(15 downto 8);
+  end function;
+
+begin
+
+  CHANNEL : for c in 0 to CHANNELS - 1 generate
+    -- stage 1: sector and the fraction of the way through it
+    signal sector   : natural range 0 to 5 := 0;
+    signal fraction : unsigned(7 downto 0) := (others => '0');
+    signal sat      : unsigned(7 downto 0) := (others => '0');
+    signal val      : unsigned(7 downto 0) := (others => '0');
+    -- stage 2: how far each of the falling and rising colours is cut
+    signal sector2  : natural range 0 to 5 := 0;
+    signal val2     : unsigned(7 downto 0) := (others => '0');
+    signal cut_p    : unsigned(7 downto 0) := (others => '0');
+    signal cut_q    : unsigned(7 downto 0) := (others => '0');
+    signal cut_t    : unsigned(7 downto 0) := (others => '0');
+    -- stage 3: the three levels below val
+    signal sector3  : natural range 0 to 5 := 0;
+    signal val3     : unsigned(7 downto 0) := (others => '0');
+    signal p        : unsigned(7 downto 0) := (others => '0');
+    signal q        : unsigned(7 downto 0) := (others => '0');
+    signal t        : unsigned(7 downto 0) := (others => '0');
+  begin
+
+    convert : process (clk)
+      variable hue    : unsigned(7 downto 0);
+      variable scaled : unsigned(10 downto 0);
+      variable rgb    : std_logic_vector(23 downto 0);
+    begin
+      if rising_edge(clk) then
+        hue      := unsigned(hsv_in(24 * c + 23 downto 24 * c + 16)) + hue_offset;
+        scaled   := resize(hue, 11) * 6;
+        sector   <= to_integer(scaled(10 downto 8));
+        fraction <= scaled(7 downto 0);
+        sat      <= unsigned(hsv_in(24 * c + 15 downto 24 * c + 8));
+        val      <= unsigned(hsv_in(24 * c + 7 downto 24 * c));
+
+        sector2 <= sector;
+        val2    <= val;
+        cut_p   <= sat;
+        cut_q   <= div255(sat * fraction);
+        cut_t   <= div255(sat * (255 - fraction));
+
+        sector3 <= sector2;
+        val3    <= val2;
+        p       <= div255(val2 * (255 - cut_p));
+        q       <= div255(val2 * (255 - cut_q));
+        t       <= div255(val2 * (255 - cut_t));
+
+        case sector3 is
+          when 0      => rgb := std_logic_vector(val3 & t & p);
+          when 1      => rgb := std_logic_vector(q & val3 & p);
+          when 2      => rgb := std_logic_vector(p & val3 & t);
+          when 3      => rgb := std_logic_vector(p & q & val3);
+          when 4      => rgb := std_logic_vector(t & p & val3);
+          when others => rgb := std_logic_vector(val3 & p & q);
+        end case;
+        rgb_out(24 * c + 23 downto 24 * c) <= rgb;
+      end if;
+    end process;
+
+  end generate;
+
+end architecture rtl;
@@ -0,0 +1,146 @@
+-- altera vhdl_input_version vhdl_2008
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+
+-- Animations computed per pixel as the driver asks for it, so they run at
+-- the full frame rate with no bus traffic. Every LED has a position along
+-- the pattern, phase + LED * scale, in 1/65536 of a cycle; phase moves on
+-- by speed at every frame_done. The patterns are
+--   1 rainbow:  hue follows the position; saturation and value come from
+--               bits 15-8 and 7-0 of colour
+--   2 gradient: colour to colour2 and back once a cycle
+--   3 plasma:   hue from two waves, one at half the spatial frequency and
+--               moving the other way twice as fast; saturation and value as
+--               for the rainbow
+--   4 comet:    a head of colour going round the strip once a cycle, with a
+--               tail fading into colour2 by scale / 256 per LED
+-- Rainbow and plasma colours are hue, saturation and value, which hsv
+-- says; the others are blends of colour and colour2 as written. The same
+-- pattern is shown on every channel.
+entity pattern_generator is
+  generic (
+    LED_COUNT : integer -- LEDs on each channel
+  );
+  port (
+    clk         : in std_logic;
+    rst         : in std_logic;
+    -- end of a frame, from ws2811_driver
+    frame_done  : in std_logic;
+    -- settings, only to be changed between frames; 0 shows no pattern
+    pattern     : in natural range 0 to 7;
+    speed       : in signed(15 downto 0);
+    scale       : in unsigned(15 downto 0);
+    colour      : in std_logic_vector(23 downto 0);
+    colour2     : in std_logic_vector(23 downto 0);
+    -- pixel to compute; the colour follows three clocks later
+    pixel_index : in natural range 0 to LED_COUNT - 1;
+    colour_out  : out std_logic_vector(23 downto 0);
+    hsv         : out std_logic
+  );
+end entity pattern_generator;
+
+architecture rtl of pattern_generator is
+
+  constant PATTERN_RAINBOW  : natural := 1;
+  constant PATTERN_GRADIENT : natural := 2;
+  constant PATTERN_PLASMA   : natural := 3;
+  constant PATTERN_COMET    : natural := 4;
+
+  -- 0 up to 255 over the first half of a cycle and back down over the other
+  function triangle(u : unsigned(7 downto 0)) return unsigned is
+  begin
+    if u(7) = '0' then
+      return u(6 downto 0) & '0';
+    end if;
+    return not u(6 downto 0) & '1';
+  end function;
+
+  -- a + (b - a) * w / 256 for each colour, with w = 255 counted as 256
+  function blend(a, b : std_logic_vector(23 downto 0); w : unsigned(7 downto 0)) return std_logic_vector is
+    variable weight : unsigned(8 downto 0);
+    variable sum    : unsigned(16 downto 0);
+    variable result : std_logic_vector(23 downto 0);
+  begin
+    weight := ('0' & w) + w(7 downto 7);
+    for k in 0 to 2 loop
+      sum := unsigned(a(8 * k + 7 downto 8 * k)) * (256 - weight) +
+             unsigned(b(8 * k + 7 downto 8 * k)) * weight;
+      result(8 * k + 7 downto 8 * k) := std_logic_vector(sum(15 downto 8));
+    end loop;
+    return result;
+  end function;
+
+  signal phase : unsigned(15 downto 0) := (others => '0');
+  -- LED at the comet's head
+  signal head  : natural range 0 to LED_COUNT - 1 := 0;
+
+  -- stage 1: where the pixel is in the pattern
+  signal position  : unsigned(15 downto 0) := (others => '0');
+  signal position2 : unsigned(15 downto 0) := (others => '0');
+  signal distance  : natural range 0 to LED_COUNT - 1 := 0;
+  -- stage 2: hue, or how far from colour2 to colour
+  signal level     : unsigned(7 downto 0) := (others => '0');
+
+begin
+
+  pattern_phase : process (clk, rst)
+    variable head_product : unsigned(31 downto 0);
+  begin
+    if rst = '1' then
+      phase <= (others => '0');
+      head  <= 0;
+    elsif rising_edge(clk) then
+      if frame_done = '1' then
+        phase <= unsigned(signed(phase) + speed);
+      end if;
+      head_product := phase * to_unsigned(LED_COUNT, 16);
+      head         <= to_integer(head_product(31 downto 16));
+    end if;
+  end process;
+
+  pattern_pixel : process (clk)
+    variable product : unsigned(31 downto 0);
+  begin
+    if rising_edge(clk) then
+      product   := to_unsigned(pixel_index, 16) * scale;
+      position  <= product(15 downto 0) + phase;
+      position2 <= product(16 downto 1) - (phase(14 downto 0) & '0');
+      if head >= pixel_index then
+        distance <= head - pixel_index;
+      else
+        distance <= head + LED_COUNT - pixel_index;
+      end if;
+
+      case pattern is
+        when PATTERN_GRADIENT =>
+          level <= triangle(position(15 downto 8));
+        when PATTERN_PLASMA =>
+          level <= triangle(position(15 downto 8)) + triangle(position2(15 downto 8));
+        when PATTERN_COMET =>
+          product := to_unsigned(distance, 16) * scale;
+          if product(31 downto 8) > 255 then
+            level <= (others => '0');
+          else
+            level <= 255 - product(15 downto 8);
+          end if;
+        when others =>
+          level <= position(15 downto 8);
+      end case;
+
+      case pattern is
+        when PATTERN_RAINBOW | PATTERN_PLASMA =>
+          colour_out <= std_logic_vector(level) & colour(15 downto 0);
+          hsv        <= '1';
+        when PATTERN_GRADIENT =>
+          colour_out <= blend(colour, colour2, level);
+          hsv        <= '0';
+        when others =>
+          colour_out <= blend(colour2, colour, level);
+          hsv        <= '0';
+      end case;
+    end if;
+  end process;
+
+end architecture rtl;
@@ -0,0 +1,44 @@
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+
+-- Single-clock RAM with a read/write port for the Avalon bus and a read-only
+-- port for the pixel pipeline. Both reads are registered, so Quartus maps
+-- the array onto M10K blocks instead of logic.
+entity pixel_ram is
+  generic (
+    ADDR_WIDTH : natural;
+    DATA_WIDTH : natural
+  );
+  port (
+    clk     : in std_logic;
+    -- port a: read/write
+    a_addr  : in unsigned(ADDR_WIDTH - 1 downto 0);
+    a_write : in std_logic;
+    a_wdata : in std_logic_vector(DATA_WIDTH - 1 downto 0);
+    a_rdata : out std_logic_vector(DATA_WIDTH - 1 downto 0);
+    -- port b: read only
+    b_addr  : in unsigned(ADDR_WIDTH - 1 downto 0);
+    b_rdata : out std_logic_vector(DATA_WIDTH - 1 downto 0)
+  );
+end entity pixel_ram;
+
+architecture rtl of pixel_ram is
+
+  type ram_type is array (0 to 2**ADDR_WIDTH - 1) of std_logic_vector(DATA_WIDTH - 1 downto 0);
+  signal ram : ram_type := (others => (others => '0'));
+
+begin
+
+  RAM_PORTS : process (clk)
+  begin
+    if rising_edge(clk) then
+      if a_write = '1' then
+        ram(to_integer(a_addr)) <= a_wdata;
+      end if;
+      a_rdata <= ram(to_integer(a_addr));
+      b_rdata <= ram(to_integer(b_addr));
+    end if;
+  end process;
+
+end architecture rtl;
@@ -0,0 +1,205 @@
+-- altera vhdl_input_version vhdl_2008
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+
+-- Avalon-ST sink for pixels streamed by another block, such as a DMA
+-- engine, with a FIFO in front of the pixel path. Every beat is one pixel
+-- for every channel, channel c in bits 24c+23 downto 24c, and a frame is
+-- a packet: the beat with startofpacket set is LED 0, the beats after it
+-- the LEDs after it in wire order. endofpacket is not needed and ignored.
+-- With enable set the driver takes one beat per LED. From the end of a
+-- frame beats are dropped until one with startofpacket reaches the head,
+-- so a producer that sends too many or starts mid-frame is back in step
+-- by the next frame. An LED taken while the FIFO is empty, or while the
+-- head is already the next frame's first pixel, gets black and counts as
+-- an underflow; clocks with valid high and ready low count as
+-- backpressure. Without enable every beat is accepted and thrown away, so
+-- a producer never hangs while the strip shows something else.
+entity pixel_stream is
+  generic (
+    LED_COUNT   : integer; -- LEDs on each channel
+    CHANNELS    : integer;
+    DEPTH_WIDTH : natural  -- the FIFO holds 2**DEPTH_WIDTH beats
+  );
+  port (
+    clk                : in std_logic;
+    rst                : in std_logic;
+    enable             : in std_logic;
+    -- Avalon-ST sink
+    data               : in std_logic_vector(24 * CHANNELS - 1 downto 0);
+    valid              : in std_logic;
+    ready              : out std_logic;
+    startofpacket      : in std_logic;
+    endofpacket        : in std_logic;
+    -- end of a frame, and the LED the driver takes on pixel_taken
+    frame_done         : in std_logic;
+    pixel_index        : in natural range 0 to LED_COUNT - 1;
+    pixel_taken        : in std_logic;
+    -- the pixel the driver takes next, black if there is none
+    colour             : out std_logic_vector(24 * CHANNELS - 1 downto 0);
+    -- beats in the FIFO, and the counters; a clear sets its counter to 0
+    level              : out unsigned(DEPTH_WIDTH downto 0);
+    underflow          : out unsigned(31 downto 0);
+    backpressure       : out unsigned(31 downto 0);
+    clear_underflow    : in std_logic;
+    clear_backpressure : in std_logic
+  );
+end entity pixel_stream;
+
+architecture rtl of pixel_stream is
+
+  component pixel_ram is
+    generic (
+      ADDR_WIDTH : natural;
+      DATA_WIDTH : natural
+    );
+    port (
+      clk     : in std_logic;
+      a_addr  : in unsigned(ADDR_WIDTH - 1 downto 0);
+      a_write : in std_logic;
+      a_wdata : in std_logic_vector(DATA_WIDTH - 1 downto 0);
+      a_rdata : out std_logic_vector(DATA_WIDTH - 1 downto 0);
+      b_addr  : in unsigned(ADDR_WIDTH - 1 downto 0);
+      b_rdata : out std_logic_vector(DATA_WIDTH - 1 downto 0)
+    );
+  end component;
+
+  constant DEPTH : natural := 2**DEPTH_WIDTH;
+
+  -- The pointers have one bit more than the address, so full and empty
+  -- differ. written is write_ptr a clock late, once the beat is in the RAM.
+  signal write_ptr : unsigned(DEPTH_WIDTH downto 0) := (others => '0');
+  signal written   : unsigned(DEPTH_WIDTH downto 0) := (others => '0');
+  signal read_ptr  : unsigned(DEPTH_WIDTH downto 0) := (others => '0');
+
+  signal push      : std_logic;
+  signal pop       : std_logic;
+  signal ready_int : std_logic;
+
+  -- RAM words are the beat with startofpacket on top
+  signal wdata     : std_logic_vector(24 * CHANNELS downto 0);
+  signal head      : std_logic_vector(24 * CHANNELS downto 0);
+  signal unused    : std_logic_vector(24 * CHANNELS downto 0);
+
+  -- The head is only looked at once the RAM has answered for read_ptr,
+  -- two clocks after it moved
+  signal settle     : natural range 0 to 2 := 0;
+  signal head_valid : std_logic := '0';
+  signal head_start : std_logic;
+  -- dropping beats until the next frame's first one
+  signal dropping   : std_logic := '1';
+  -- the head is the pixel the driver is about to take
+  signal head_shown : std_logic;
+
+  signal underflow_count    : unsigned(31 downto 0) := (others => '0');
+  signal backpressure_count : unsigned(31 downto 0) := (others => '0');
+
+begin
+
+  ready_int <= '1' when rst = '0' and (enable = '0' or write_ptr - read_ptr < DEPTH) else '0';
+  ready     <= ready_int;
+  push      <= valid and ready_int and enable;
+  wdata     <= startofpacket & data;
+
+  FIFO_RAM : pixel_ram
+  generic map(
+    ADDR_WIDTH => DEPTH_WIDTH,
+    DATA_WIDTH => 24 * CHANNELS + 1
+  )
+  port map
+  (
+    clk     => clk,
+    a_addr  => write_ptr(DEPTH_WIDTH - 1 downto 0),
+    a_write => push,
+    a_wdata => wdata,
+    a_rdata => unused,
+    b_addr  => read_ptr(DEPTH_WIDTH - 1 downto 0),
+    b_rdata => head
+  );
+
+  head_start <= head(24 * CHANNELS);
+  head_shown <= '1' when head_valid = '1' and dropping = '0' and
+                         (head_start = '0' or pixel_index = 0) else '0';
+
+  pop <= '1' when head_valid = '1' and dropping = '1' and head_start = '0' else
+         pixel_taken and enable when head_shown = '1' else
+         '0';
+
+  colour <= head(24 * CHANNELS - 1 downto 0) when head_shown = '1' else (others => '0');
+  level  <= write_ptr - read_ptr;
+
+  fifo_pointers : process (clk, rst)
+  begin
+    if rst = '1' then
+      write_ptr  <= (others => '0');
+      written    <= (others => '0');
+      read_ptr   <= (others => '0');
+      settle     <= 0;
+      head_valid <= '0';
+    elsif rising_edge(clk) then
+      if push = '1' then
+        write_ptr <= write_ptr + 1;
+      end if;
+      written <= write_ptr;
+
+      if enable = '0' then
+        -- empty, so nothing old is shown when streaming starts again
+        read_ptr   <= write_ptr;
+        settle     <= 2;
+        head_valid <= '0';
+      elsif pop = '1' then
+        read_ptr   <= read_ptr + 1;
+        settle     <= 2;
+        head_valid <= '0';
+      else
+        if settle > 0 then
+          settle <= settle - 1;
+        end if;
+        if settle = 0 and read_ptr /= written then
+          head_valid <= '1';
+        else
+          head_valid <= '0';
+        end if;
+      end if;
+    end if;
+  end process;
+
+  -- a new frame starts at the next startofpacket
+  frame_sync : process (clk, rst)
+  begin
+    if rst = '1' then
+      dropping <= '1';
+    elsif rising_edge(clk) then
+      if frame_done = '1' or enable = '0' then
+        dropping <= '1';
+      elsif head_valid = '1' and head_start = '1' then
+        dropping <= '0';
+      end if;
+    end if;
+  end process;
+
+  stream_counters : process (clk, rst)
+  begin
+    if rst = '1' then
+      underflow_count    <= (others => '0');
+      backpressure_count <= (others => '0');
+    elsif rising_edge(clk) then
+      if clear_underflow = '1' then
+        underflow_count <= (others => '0');
+      elsif enable = '1' and pixel_taken = '1' and head_shown = '0' then
+        underflow_count <= underflow_count + 1;
+      end if;
+      if clear_backpressure = '1' then
+        backpressure_count <= (others => '0');
+      elsif valid = '1' and ready_int = '0' then
+        backpressure_count <= backpressure_count + 1;
+      end if;
+    end if;
+  end process;
+
+  underflow    <= underflow_count;
+  backpressure <= backpressure_count;
+
+end architecture rtl;
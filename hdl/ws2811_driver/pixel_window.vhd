@@ -0,0 +1,191 @@
+-- altera vhdl_input_version vhdl_2008
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+
+-- Burst-capable Avalon slave over the back page of the framebuffer, as one
+-- linear run of words: word n is word n mod row of channel n / row, where
+-- row is the words a channel takes in the current mode. So a frame for
+-- every channel is one contiguous upload, with no gaps between banks.
+-- Writes take a word a clock, bursts of up to 2**(BURST_WIDTH - 1) words
+-- included. A read burst is taken as one command and answered with a word
+-- a clock on readdatavalid, two clocks later; one is answered at a time.
+-- Words past the last channel read as 0 and ignore writes, and so does a
+-- write that doesn't have every byte enabled, which a wider bridge sends
+-- for the unused half of its data path. While busy is high the
+-- framebuffer is taken and the window waits.
+entity pixel_window is
+  generic (
+    CHANNELS      : integer;
+    FB_ADDR_WIDTH : natural; -- words in each channel's bank, as address bits
+    BURST_WIDTH   : natural
+  );
+  port (
+    clk           : in std_logic;
+    rst           : in std_logic;
+    -- avalon memory-mapped slave, one word per address
+    read          : in std_logic;
+    write         : in std_logic;
+    address       : in std_logic_vector(12 downto 0);
+    burstcount    : in std_logic_vector(BURST_WIDTH - 1 downto 0);
+    writedata     : in std_logic_vector(31 downto 0);
+    byteenable    : in std_logic_vector(3 downto 0);
+    readdata      : out std_logic_vector(31 downto 0);
+    readdatavalid : out std_logic;
+    waitrequest   : out std_logic;
+    -- words of a channel's bank in use in the current mode
+    row           : in natural range 1 to 2**FB_ADDR_WIDTH;
+    busy          : in std_logic;
+    -- framebuffer port; reads answer on fb_rdata (channel c in bits
+    -- 32c+31 downto 32c) a clock after fb_read
+    fb_read       : out std_logic;
+    fb_write      : out std_logic;
+    fb_channel    : out natural range 0 to CHANNELS - 1;
+    fb_word       : out unsigned(FB_ADDR_WIDTH - 1 downto 0);
+    fb_wdata      : out std_logic_vector(31 downto 0);
+    fb_rdata      : in std_logic_vector(32 * CHANNELS - 1 downto 0)
+  );
+end entity pixel_window;
+
+architecture rtl of pixel_window is
+
+  constant MAX_BURST : natural := 2**(BURST_WIDTH - 1);
+
+  -- The channel and word of address, and of the next word of a burst;
+  -- start_ok and next_ok are low past the last channel
+  signal start_channel : natural range 0 to CHANNELS - 1;
+  signal start_word    : natural range 0 to 2**FB_ADDR_WIDTH - 1;
+  signal start_ok      : std_logic;
+  signal next_channel  : natural range 0 to CHANNELS - 1 := 0;
+  signal next_word     : natural range 0 to 2**FB_ADDR_WIDTH - 1 := 0;
+  signal next_ok       : std_logic := '0';
+
+  -- beats of the current burst still to come, write and read
+  signal write_left : natural range 0 to MAX_BURST - 1 := 0;
+  signal read_left  : natural range 0 to MAX_BURST := 0;
+
+  -- the word this clock's access goes to
+  signal access_channel : natural range 0 to CHANNELS - 1;
+  signal access_word    : natural range 0 to 2**FB_ADDR_WIDTH - 1;
+  signal access_ok      : std_logic;
+
+  signal write_beat : std_logic;
+  signal read_beat  : std_logic;
+  signal wait_int   : std_logic;
+
+  -- the read answered next clock
+  signal returning      : std_logic := '0';
+  signal return_channel : natural range 0 to CHANNELS - 1 := 0;
+  signal return_ok      : std_logic := '0';
+
+begin
+
+  -- which channel address falls in
+  address_split : process (address, row)
+    variable linear  : natural range 0 to 2**13 - 1;
+    variable channel : natural range 0 to CHANNELS - 1;
+  begin
+    linear  := to_integer(unsigned(address));
+    channel := 0;
+    for c in 1 to CHANNELS - 1 loop
+      if linear >= c * row then
+        channel := c;
+      end if;
+    end loop;
+    start_channel <= channel;
+    if linear - channel * row < row then
+      start_word <= linear - channel * row;
+      start_ok   <= '1';
+    else
+      start_word <= 0;
+      start_ok   <= '0';
+    end if;
+  end process;
+
+  -- writes wait for the framebuffer, and everything waits for a read burst
+  wait_int    <= '1' when busy = '1' or read_left /= 0 or returning = '1' else '0';
+  waitrequest <= wait_int;
+
+  write_beat <= write and not wait_int;
+  read_beat  <= '1' when read_left /= 0 and busy = '0' else '0';
+
+  -- the first beat of a write burst goes to address, the rest follow on
+  access_channel <= next_channel when read_left /= 0 or write_left /= 0 else start_channel;
+  access_word    <= next_word when read_left /= 0 or write_left /= 0 else start_word;
+  access_ok      <= next_ok when read_left /= 0 or write_left /= 0 else start_ok;
+
+  fb_write   <= write_beat and access_ok when byteenable = "1111" else '0';
+  fb_read    <= read_beat and access_ok;
+  fb_channel <= access_channel;
+  fb_word    <= to_unsigned(access_word, FB_ADDR_WIDTH);
+  fb_wdata   <= writedata;
+
+  bursts : process (clk, rst)
+  begin
+    if rst = '1' then
+      write_left <= 0;
+      read_left  <= 0;
+      next_ok    <= '0';
+      returning  <= '0';
+    elsif rising_edge(clk) then
+      if write_beat = '1' or read_beat = '1' then
+        -- move on to the word after this one
+        if access_ok = '0' then
+          next_ok <= '0';
+        elsif access_word < row - 1 then
+          next_channel <= access_channel;
+          next_word    <= access_word + 1;
+          next_ok      <= '1';
+        elsif access_channel < CHANNELS - 1 then
+          next_channel <= access_channel + 1;
+          next_word    <= 0;
+          next_ok      <= '1';
+        else
+          next_ok <= '0';
+        end if;
+      end if;
+
+      if write_beat = '1' then
+        if write_left /= 0 then
+          write_left <= write_left - 1;
+        elsif to_integer(unsigned(burstcount)) > 1 then
+          write_left <= to_integer(unsigned(burstcount)) - 1;
+        end if;
+      end if;
+
+      if read_left /= 0 then
+        if read_beat = '1' then
+          read_left <= read_left - 1;
+        end if;
+      elsif read = '1' and wait_int = '0' then
+        -- the command; the words are read from the next clock on
+        next_channel <= start_channel;
+        next_word    <= start_word;
+        next_ok      <= start_ok;
+        if to_integer(unsigned(burstcount)) > 1 then
+          read_left <= to_integer(unsigned(burstcount));
+        else
+          read_left <= 1;
+        end if;
+      end if;
+
+      returning      <= read_beat;
+      return_channel <= access_channel;
+      return_ok      <= access_ok;
+    end if;
+  end process;
+
+  readdatavalid <= returning;
+
+  read_select : process (fb_rdata, return_channel, return_ok)
+  begin
+    readdata <= (others => '0');
+    for c in 0 to CHANNELS - 1 loop
+      if return_ok = '1' and return_channel = c then
+        readdata <= fb_rdata(32 * c + 31 downto 32 * c);
+      end if;
+    end loop;
+  end process;
+
+end architecture rtl;
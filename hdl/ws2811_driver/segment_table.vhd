@@ -0,0 +1,131 @@
+-- altera vhdl_input_version vhdl_2008
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+
+-- SEGMENTS runs of one colour painted over the pixels, so zones, bars and
+-- markers take a few register writes instead of a framebuffer upload. Every
+-- segment has four registers, at word 4k of its bus window:
+--   0 start: first LED, counting along the channels one after the other
+--   1 length: LEDs painted from start on; 0 turns the segment off
+--   2 colour: 24-bit colour
+--   3 unused, reads as 0
+-- Where segments overlap the lowest numbered one wins. The table is copied
+-- at frame_done and frame_load, so a frame never shows half of an update.
+entity segment_table is
+  generic (
+    LED_COUNT : integer; -- LEDs on each channel
+    CHANNELS  : integer;
+    SEGMENTS  : integer
+  );
+  port (
+    clk         : in std_logic;
+    rst         : in std_logic;
+    -- register window, one word per address
+    write       : in std_logic;
+    address     : in natural range 0 to 4 * SEGMENTS - 1;
+    writedata   : in std_logic_vector(31 downto 0);
+    readdata    : out std_logic_vector(31 downto 0);
+    -- end of a frame, from ws2811_driver
+    frame_done  : in std_logic;
+    -- a frame was asked for, from ws2811_driver with on-demand refresh
+    frame_load  : in std_logic;
+    -- pixel to look up; hit and colour follow one clock later
+    pixel_index : in natural range 0 to LED_COUNT - 1;
+    hit         : out std_logic_vector(CHANNELS - 1 downto 0);
+    color       : out std_logic_vector(24 * CHANNELS - 1 downto 0)
+  );
+end entity segment_table;
+
+architecture rtl of segment_table is
+
+  constant TOTAL : natural := LED_COUNT * CHANNELS;
+
+  constant FIELD_START  : natural := 0;
+  constant FIELD_LENGTH : natural := 1;
+  constant FIELD_COLOR  : natural := 2;
+
+  type index_array is array (0 to SEGMENTS - 1) of natural range 0 to TOTAL;
+  type word_array is array (0 to SEGMENTS - 1) of std_logic_vector(31 downto 0);
+
+  -- registers
+  signal start  : index_array := (others => 0);
+  signal length : index_array := (others => 0);
+  signal colour : word_array := (others => (others => '0'));
+
+  -- copies taken at the end of every frame
+  signal start_shown  : index_array := (others => 0);
+  signal length_shown : index_array := (others => 0);
+  signal colour_shown : word_array := (others => (others => '0'));
+
+begin
+
+  -- starts and lengths are clipped to the end of the last channel
+  segment_registers : process (clk, rst)
+  begin
+    if rst = '1' then
+      start  <= (others => 0);
+      length <= (others => 0);
+      colour <= (others => (others => '0'));
+    elsif rising_edge(clk) and write = '1' then
+      case address mod 4 is
+        when FIELD_START =>
+          if unsigned(writedata) < TOTAL then
+            start(address / 4) <= to_integer(unsigned(writedata));
+          else
+            start(address / 4) <= TOTAL;
+          end if;
+        when FIELD_LENGTH =>
+          if unsigned(writedata) < TOTAL then
+            length(address / 4) <= to_integer(unsigned(writedata));
+          else
+            length(address / 4) <= TOTAL;
+          end if;
+        when FIELD_COLOR =>
+          colour(address / 4) <= x"00" & writedata(23 downto 0);
+        when others => null;
+      end case;
+    end if;
+  end process;
+
+  with address mod 4 select readdata <=
+    std_logic_vector(to_unsigned(start(address / 4), 32)) when FIELD_START,
+    std_logic_vector(to_unsigned(length(address / 4), 32)) when FIELD_LENGTH,
+    colour(address / 4) when FIELD_COLOR,
+    (others => '0') when others;
+
+  frame_latch : process (clk, rst)
+  begin
+    if rst = '1' then
+      start_shown  <= (others => 0);
+      length_shown <= (others => 0);
+      colour_shown <= (others => (others => '0'));
+    elsif rising_edge(clk) and (frame_done = '1' or frame_load = '1') then
+      start_shown  <= start;
+      length_shown <= length;
+      colour_shown <= colour;
+    end if;
+  end process;
+
+  -- Checked from the last segment to the first, so the first one that
+  -- covers the pixel sets the colour
+  lookup : process (clk)
+    variable index : natural range 0 to TOTAL - 1;
+  begin
+    if rising_edge(clk) then
+      for c in 0 to CHANNELS - 1 loop
+        index := c * LED_COUNT + pixel_index;
+        hit(c) <= '0';
+        color(24 * c + 23 downto 24 * c) <= (others => '0');
+        for k in SEGMENTS - 1 downto 0 loop
+          if index >= start_shown(k) and index - start_shown(k) < length_shown(k) then
+            hit(c) <= '1';
+            color(24 * c + 23 downto 24 * c) <= colour_shown(k)(23 downto 0);
+          end if;
+        end loop;
+      end loop;
+    end if;
+  end process;
+
+end architecture rtl;
@@ -0,0 +1,235 @@
+-- altera vhdl_input_version vhdl_2008
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+
+-- SPRITES runs of lit LEDs drawn over the strip, each moved along by the
+-- hardware so software only has to set a speed. Every sprite has four
+-- registers, at word 4k of its bus window:
+--   0 position: first LED of the sprite, counting along the channels one
+--     after the other (0 to LED_COUNT * CHANNELS - 1); moving sprites wrap
+--   1 length: LEDs lit from position on (wrapping); 0 hides the sprite
+--   2 colour: 24-bit colour
+--   3 period: bits 29-0 step period (0 stands still), in microseconds or,
+--     with bit 30 set, in frames; bit 31 steps backwards
+-- Sprite 0 is drawn on top. What is drawn is copied at frame_done and
+-- frame_load, so a frame never shows a sprite half way through a step.
+entity sprite_engine is
+  generic (
+    LED_COUNT : integer; -- LEDs on each channel
+    CHANNELS  : integer;
+    SPRITES   : integer;
+    CLK_HZ    : integer := 50_000_000
+  );
+  port (
+    clk         : in std_logic;
+    rst         : in std_logic;
+    -- register window, one word per address
+    write       : in std_logic;
+    address     : in natural range 0 to 4 * SPRITES - 1;
+    writedata   : in std_logic_vector(31 downto 0);
+    readdata    : out std_logic_vector(31 downto 0);
+    -- end of a frame, from ws2811_driver
+    frame_done  : in std_logic;
+    -- a frame was asked for, from ws2811_driver with on-demand refresh
+    frame_load  : in std_logic;
+    -- pixel requested by the driver; hit and colour follow one clock later
+    pixel_index : in natural range 0 to LED_COUNT - 1;
+    hit         : out std_logic_vector(CHANNELS - 1 downto 0);
+    color       : out std_logic_vector(24 * CHANNELS - 1 downto 0);
+    -- where sprite 0 is drawn, and whether it is drawn at all
+    position0   : out std_logic_vector(31 downto 0);
+    visible0    : out std_logic;
+    -- pulses when a sprite that is drawn steps; high while a sprite that is
+    -- drawn steps every so many frames, so it needs frames to move at all
+    moved       : out std_logic;
+    frame_paced : out std_logic
+  );
+end entity sprite_engine;
+
+architecture rtl of sprite_engine is
+
+  constant TOTAL : natural := LED_COUNT * CHANNELS;
+
+  constant FIELD_POSITION : natural := 0;
+  constant FIELD_LENGTH   : natural := 1;
+  constant FIELD_COLOR    : natural := 2;
+  constant FIELD_PERIOD   : natural := 3;
+
+  constant PERIOD_FRAMES  : natural := 30;
+  constant PERIOD_REVERSE : natural := 31;
+
+  type position_array is array (0 to SPRITES - 1) of natural range 0 to TOTAL - 1;
+  type length_array is array (0 to SPRITES - 1) of natural range 0 to TOTAL;
+  type word_array is array (0 to SPRITES - 1) of std_logic_vector(31 downto 0);
+  type count_array is array (0 to SPRITES - 1) of unsigned(29 downto 0);
+
+  -- registers
+  signal position : position_array := (others => 0);
+  signal length   : length_array := (others => 0);
+  signal colour   : word_array := (others => (others => '0'));
+  signal period   : word_array := (others => (others => '0'));
+
+  -- ticks since the last step
+  signal elapsed  : count_array := (others => (others => '0'));
+
+  -- microsecond tick
+  signal prescale : natural range 0 to CLK_HZ / 1_000_000 - 1 := 0;
+  signal us_tick  : std_logic := '0';
+
+  -- copies taken at the end of every frame
+  signal position_shown : position_array := (others => 0);
+  signal length_shown   : length_array := (others => 0);
+  signal colour_shown   : word_array := (others => (others => '0'));
+
+begin
+
+  microsecond_tick : process (clk, rst)
+  begin
+    if rst = '1' then
+      prescale <= 0;
+      us_tick  <= '0';
+    elsif rising_edge(clk) then
+      us_tick <= '0';
+      if prescale = CLK_HZ / 1_000_000 - 1 then
+        prescale <= 0;
+        us_tick  <= '1';
+      else
+        prescale <= prescale + 1;
+      end if;
+    end if;
+  end process;
+
+  -- Bus writes and stepping. Writing position or period restarts the step.
+  sprite_registers : process (clk, rst)
+    variable tick : std_logic;
+  begin
+    if rst = '1' then
+      position <= (others => 0);
+      length   <= (others => 0);
+      colour   <= (others => (others => '0'));
+      period   <= (others => (others => '0'));
+      elapsed  <= (others => (others => '0'));
+      moved    <= '0';
+    elsif rising_edge(clk) then
+      moved <= '0';
+      for k in 0 to SPRITES - 1 loop
+        if period(k)(PERIOD_FRAMES) = '1' then
+          tick := frame_done;
+        else
+          tick := us_tick;
+        end if;
+
+        if unsigned(period(k)(29 downto 0)) = 0 then
+          elapsed(k) <= (others => '0');
+        elsif tick = '1' then
+          if elapsed(k) >= unsigned(period(k)(29 downto 0)) - 1 then
+            elapsed(k) <= (others => '0');
+            if length(k) /= 0 then
+              moved <= '1';
+            end if;
+            if period(k)(PERIOD_REVERSE) = '1' then
+              if position(k) = 0 then
+                position(k) <= TOTAL - 1;
+              else
+                position(k) <= position(k) - 1;
+              end if;
+            elsif position(k) = TOTAL - 1 then
+              position(k) <= 0;
+            else
+              position(k) <= position(k) + 1;
+            end if;
+          else
+            elapsed(k) <= elapsed(k) + 1;
+          end if;
+        end if;
+      end loop;
+
+      -- a write wins over a step on the same clock edge
+      if write = '1' then
+        case address mod 4 is
+          when FIELD_POSITION =>
+            -- positions past the end start at 0
+            if unsigned(writedata) < TOTAL then
+              position(address / 4) <= to_integer(unsigned(writedata));
+            else
+              position(address / 4) <= 0;
+            end if;
+            elapsed(address / 4) <= (others => '0');
+          when FIELD_LENGTH =>
+            if unsigned(writedata) < TOTAL then
+              length(address / 4) <= to_integer(unsigned(writedata));
+            else
+              length(address / 4) <= TOTAL;
+            end if;
+          when FIELD_COLOR =>
+            colour(address / 4) <= x"00" & writedata(23 downto 0);
+          when others =>
+            period(address / 4) <= writedata;
+            elapsed(address / 4) <= (others => '0');
+        end case;
+      end if;
+    end if;
+  end process;
+
+  with address mod 4 select readdata <=
+    std_logic_vector(to_unsigned(position(address / 4), 32)) when FIELD_POSITION,
+    std_logic_vector(to_unsigned(length(address / 4), 32)) when FIELD_LENGTH,
+    colour(address / 4) when FIELD_COLOR,
+    period(address / 4) when others;
+
+  frame_latch : process (clk, rst)
+  begin
+    if rst = '1' then
+      position_shown <= (others => 0);
+      length_shown   <= (others => 0);
+      colour_shown   <= (others => (others => '0'));
+    elsif rising_edge(clk) and (frame_done = '1' or frame_load = '1') then
+      position_shown <= position;
+      length_shown   <= length;
+      colour_shown   <= colour;
+    end if;
+  end process;
+
+  -- The pixel is covered by a sprite if it is less than length LEDs past
+  -- the sprite's position, going round the end of the strip
+  hit_test : process (clk)
+    variable index  : natural range 0 to TOTAL - 1;
+    variable offset : integer range -TOTAL to TOTAL;
+  begin
+    if rising_edge(clk) then
+      for c in 0 to CHANNELS - 1 loop
+        index := c * LED_COUNT + pixel_index;
+        hit(c) <= '0';
+        color(24 * c + 23 downto 24 * c) <= (others => '0');
+        for k in SPRITES - 1 downto 0 loop
+          offset := index - position_shown(k);
+          if offset < 0 then
+            offset := offset + TOTAL;
+          end if;
+          if offset < length_shown(k) then
+            hit(c) <= '1';
+            color(24 * c + 23 downto 24 * c) <= colour_shown(k)(23 downto 0);
+          end if;
+        end loop;
+      end loop;
+    end if;
+  end process;
+
+  pacing : process (length, period)
+    variable paced : std_logic;
+  begin
+    paced := '0';
+    for k in 0 to SPRITES - 1 loop
+      if length(k) /= 0 and period(k)(PERIOD_FRAMES) = '1' and unsigned(period(k)(29 downto 0)) /= 0 then
+        paced := '1';
+      end if;
+    end loop;
+    frame_paced <= paced;
+  end process;
+
+  position0 <= std_logic_vector(to_unsigned(position_shown(0), 32));
+  visible0  <= '1' when length_shown(0) /= 0 else '0';
+
+end architecture rtl;
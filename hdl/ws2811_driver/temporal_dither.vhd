@@ -0,0 +1,115 @@
+-- altera vhdl_input_version vhdl_2008
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+use IEEE.math_real.all;
+
+-- Turns 16 bits per colour into the 8 the LEDs take. With enable set, the
+-- low byte every LED gets rounded off is carried into its next frame, so
+-- over a few frames the LED averages out to the 16-bit colour; without it
+-- the low byte is dropped. The carried bytes are kept per LED, in M10K, and
+-- move on once a frame, when the driver takes the LED's pixel.
+entity temporal_dither is
+  generic (
+    LED_COUNT : integer; -- LEDs on each channel
+    CHANNELS  : integer
+  );
+  port (
+    clk         : in std_logic;
+    enable      : in std_logic;
+    -- LED the driver is about to take, and the clock it takes it on
+    pixel_index : in natural range 0 to LED_COUNT - 1;
+    pixel_taken : in std_logic;
+    -- channel c in bits 48c+47 downto 48c; the output follows one clock later
+    pixel_in    : in std_logic_vector(48 * CHANNELS - 1 downto 0);
+    pixel_out   : out std_logic_vector(24 * CHANNELS - 1 downto 0)
+  );
+end entity temporal_dither;
+
+architecture rtl of temporal_dither is
+
+  function addr_width(n : natural) return natural is
+  begin
+    if n <= 2 then
+      return 1;
+    end if;
+    return natural(ceil(log2(real(n))));
+  end function;
+
+  constant ADDR_WIDTH : natural := addr_width(LED_COUNT);
+
+  component pixel_ram is
+    generic (
+      ADDR_WIDTH : natural;
+      DATA_WIDTH : natural
+    );
+    port (
+      clk     : in std_logic;
+      a_addr  : in unsigned(ADDR_WIDTH - 1 downto 0);
+      a_write : in std_logic;
+      a_wdata : in std_logic_vector(DATA_WIDTH - 1 downto 0);
+      a_rdata : out std_logic_vector(DATA_WIDTH - 1 downto 0);
+      b_addr  : in unsigned(ADDR_WIDTH - 1 downto 0);
+      b_rdata : out std_logic_vector(DATA_WIDTH - 1 downto 0)
+    );
+  end component;
+
+  signal address : unsigned(ADDR_WIDTH - 1 downto 0);
+
+begin
+
+  address <= to_unsigned(pixel_index, ADDR_WIDTH);
+
+  CHANNEL : for c in 0 to CHANNELS - 1 generate
+    -- low bytes carried from the last frame, and the ones to carry into
+    -- the next, red in bits 23-16
+    signal carried : std_logic_vector(23 downto 0);
+    signal carry   : std_logic_vector(23 downto 0) := (others => '0');
+    signal unused  : std_logic_vector(23 downto 0);
+  begin
+
+    -- The driver takes the pixel on the clock edge the carry is written,
+    -- so both come from the same pixel_in and carried
+    CARRY_RAM : pixel_ram
+    generic map(
+      ADDR_WIDTH => ADDR_WIDTH,
+      DATA_WIDTH => 24
+    )
+    port map
+    (
+      clk     => clk,
+      a_addr  => address,
+      a_write => pixel_taken,
+      a_wdata => carry,
+      a_rdata => carried,
+      b_addr  => address,
+      b_rdata => unused
+    );
+
+    dither : process (clk)
+      variable sum : unsigned(8 downto 0);
+      variable top : unsigned(7 downto 0);
+    begin
+      if rising_edge(clk) then
+        for k in 0 to 2 loop
+          top := unsigned(pixel_in(48 * c + 16 * k + 15 downto 48 * c + 16 * k + 8));
+          sum := ('0' & unsigned(pixel_in(48 * c + 16 * k + 7 downto 48 * c + 16 * k))) +
+                 unsigned(carried(8 * k + 7 downto 8 * k));
+          if enable = '0' then
+            pixel_out(24 * c + 8 * k + 7 downto 24 * c + 8 * k) <= std_logic_vector(top);
+            carry(8 * k + 7 downto 8 * k) <= (others => '0');
+          elsif sum(8) = '1' and top /= 255 then
+            pixel_out(24 * c + 8 * k + 7 downto 24 * c + 8 * k) <= std_logic_vector(top + 1);
+            carry(8 * k + 7 downto 8 * k) <= std_logic_vector(sum(7 downto 0));
+          else
+            pixel_out(24 * c + 8 * k + 7 downto 24 * c + 8 * k) <= std_logic_vector(top);
+            carry(8 * k + 7 downto 8 * k) <= std_logic_vector(sum(7 downto 0));
+          end if;
+        end loop;
+      end if;
+    end process;
+
+  end generate;
+
+end architecture rtl;
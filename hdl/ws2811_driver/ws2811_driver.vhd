@@ -1,95 +1,203 @@
+-- altera vhdl_input_version vhdl_2008
+
 library ieee;
 use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 
+-- Streams pixel_count (at most LED_COUNT) 24-bit pixels per channel out of a
+-- pixel source (normally a RAM); LEDs past pixel_count keep their colour.
+-- All CHANNELS strips are clocked out in lockstep: every bit takes the same
+-- slot of max(T0H + T0L, T1H + T1L) cycles on every channel, and each
+-- channel is high for T0H or T1H of it depending on its own bit.
+-- Pixels are sent in wire order: pixel 0 is the LED nearest the FPGA. The
+-- driver asks for a pixel by putting its index on pixel_index and samples
+-- pixel_data (channel c in bits 24c+23 downto 24c) one full pixel time (24
+-- bits) later, so the source may take a few clock cycles to answer.
+-- pixel_taken is high for the clock at the end of which pixel_data is
+-- sampled for the pixel on pixel_index.
+-- frame_done pulses for one clock when the last bit of a frame has been
+-- sent and the latch period starts; pixel 0 of the next frame is not
+-- sampled until the latch period is over.
+-- With on_demand set, the driver waits after the latch period until start
+-- is high, pulses frame_load and sends the next frame PRIME_CYCLES later,
+-- which gives the pixel source time to answer for pixel 0. Without it the
+-- frames follow one another. frame_start pulses as the first bit of every
+-- frame goes out.
+-- The bit timings, the latch period and pixel_count must only change while
+-- frame_done or frame_load is being pulsed.
 entity ws2811_driver is
     generic (
-        CLK_PERIOD : time; -- Clock period in nanoseconds
-        LED_COUNT    : integer  -- Number of LEDs in the chain
+        LED_COUNT    : integer;  -- Number of LEDs in each chain
+        CHANNELS     : integer := 1  -- Number of chains driven in parallel
     );
     port (
         clk           : in std_logic;  -- Input clock
         rst           : in std_logic;  -- Synchronous rst
-        data_array    : in std_logic_vector((24 * LED_COUNT) - 1 downto 0); -- RGB values for all LEDs
-        strip_output  : out std_logic  -- WS2811 strip_output signal
+        t0h           : in unsigned(15 downto 0); -- High for "0"
+        t0l           : in unsigned(15 downto 0); -- Low for "0"
+        t1h           : in unsigned(15 downto 0); -- High for "1"
+        t1l           : in unsigned(15 downto 0); -- Low for "1"
+        latch_period  : in unsigned(15 downto 0); -- Low between frames
+        pixel_count   : in natural range 1 to LED_COUNT; -- Pixels per frame
+        on_demand     : in std_logic; -- Wait for start between frames
+        start         : in std_logic; -- Send a frame, with on_demand
+        pixel_index   : out natural range 0 to LED_COUNT - 1; -- Pixel to fetch next
+        pixel_data    : in std_logic_vector(24 * CHANNELS - 1 downto 0); -- RGB values of pixel_index
+        pixel_taken   : out std_logic; -- pixel_data is sampled at the end of this clock
+        frame_done    : out std_logic; -- Pulses at the start of the latch period
+        frame_load    : out std_logic; -- Pulses when a frame is asked for, with on_demand
+        frame_start   : out std_logic; -- Pulses as the first bit goes out
+        strip_output  : out std_logic_vector(CHANNELS - 1 downto 0)  -- WS2811 strip_output signals
     );
 end ws2811_driver;
 
 architecture behavioral of ws2811_driver is
 
-    -- Timing constants for high-speed mode in clock cycles
-    constant T0H : integer := integer(500 ns / CLK_PERIOD);  -- High for "0"
-    constant T0L : integer := integer(2000 ns / CLK_PERIOD); -- Low for "0"
-    constant T1H : integer := integer(1200 ns / CLK_PERIOD);  -- High for "1"
-    constant T1L : integer := integer(1300 ns / CLK_PERIOD);  -- Low for "1"
-    constant LED_BITS     : integer := (24 * LED_COUNT);       -- Total number of bits for all LEDs
-    constant rst_PERIOD : integer := integer(100 us / CLK_PERIOD); -- rst time
+    -- LATCH holds the lines low between frames, IDLE waits for start with
+    -- on_demand, PRIME gives the pixel source time to answer for pixel 0
+    -- after a wait, LOAD fetches the first pixel
+    type state_type is (LATCH, IDLE, PRIME, LOAD, SEND);
+
+    constant PRIME_CYCLES    : integer := 32;
 
     -- Internal signals
-    signal bit_counter       : integer range 0 to LED_BITS - 1 := 0;
-    signal phase_counter     : integer := 0;
-    signal rst_counter       : integer := 0;
-    signal strip_output_reg  : std_logic := '0';
-    signal sending_high      : boolean := true;
-    signal current_bit       : std_logic := '0'; -- Now a signal
-	 
+    signal state             : state_type := LATCH;
+    signal shift_reg         : std_logic_vector(24 * CHANNELS - 1 downto 0) := (others => '0');
+    signal bit_counter       : integer range 0 to 23 := 0;
+    signal pixel_counter     : integer range 0 to LED_COUNT - 1 := 0;
+    signal last_pixel        : boolean := false;
+    signal phase_counter     : integer range 0 to 2**17 - 1 := 0;
+    signal bit_period        : integer range 0 to 2**17 - 1;
+    signal strip_output_reg  : std_logic_vector(CHANNELS - 1 downto 0) := (others => '0');
+    signal frame_done_reg    : std_logic := '0';
+    signal frame_load_reg    : std_logic := '0';
+    signal frame_start_reg   : std_logic := '0';
+
 begin
+    -- Every bit takes the longer of the two bit times
+    bit_period <= maximum(to_integer(t0h) + to_integer(t0l), to_integer(t1h) + to_integer(t1l));
+
     process(clk)
     begin
         if rising_edge(clk) then
             if rst = '1' then
                 -- rst all counters
+                state <= LATCH;
                 bit_counter <= 0;
+                pixel_counter <= 0;
+                last_pixel <= false;
                 phase_counter <= 0;
-                rst_counter <= 0;
-                strip_output_reg <= '0';
-                sending_high <= true;
+                frame_done_reg <= '0';
+                frame_load_reg <= '0';
+                frame_start_reg <= '0';
             else
-                if rst_counter < rst_PERIOD then
-                    -- Handle rst period
-                    rst_counter <= rst_counter + 1;
-                    strip_output_reg <= '0'; -- Keep strip_output low during rst
-                elsif bit_counter < LED_BITS then
-                    -- Sending bits
-                    current_bit <= data_array(LED_BITS - 1 - bit_counter);
-                    if sending_high then
-                        -- Handle high phase of the bit
-                        if (current_bit = '1' and phase_counter < T1H) or
-                           (current_bit = '0' and phase_counter < T0H) then
+                frame_done_reg <= '0';
+                frame_load_reg <= '0';
+                frame_start_reg <= '0';
+                case state is
+                    when LATCH =>
+                        -- Keep strip_output low for the latch period
+                        if phase_counter < to_integer(latch_period) - 1 then
                             phase_counter <= phase_counter + 1;
                         else
-                            sending_high <= false; -- Transition to low
                             phase_counter <= 0;
-                            strip_output_reg <= '0';
+                            if on_demand = '1' then
+                                state <= IDLE;
+                            else
+                                state <= LOAD;
+                            end if;
                         end if;
-                    else
-                        -- Handle low phase of the bit
-                        if (current_bit = '1' and phase_counter < T1L) or
-                           (current_bit = '0' and phase_counter < T0L) then
+
+                    when IDLE =>
+                        -- The line has been low for long enough already
+                        if on_demand = '0' or start = '1' then
+                            frame_load_reg <= '1';
+                            state <= PRIME;
+                        end if;
+
+                    when PRIME =>
+                        if phase_counter < PRIME_CYCLES - 1 then
                             phase_counter <= phase_counter + 1;
                         else
-                            -- Move to the next bit
-                            bit_counter <= bit_counter + 1;
                             phase_counter <= 0;
-                            sending_high <= true; -- Start next bit high
-                            strip_output_reg <= '1';
+                            state <= LOAD;
                         end if;
-                    end if;
+
+                    when LOAD =>
+                        -- Pixel 0 was requested at the end of the last frame
+                        shift_reg <= pixel_data;
+                        last_pixel <= pixel_counter = pixel_count - 1;
+                        if pixel_counter = pixel_count - 1 then
+                            pixel_counter <= 0;
+                        else
+                            pixel_counter <= pixel_counter + 1;
+                        end if;
+                        bit_counter <= 0;
+                        frame_start_reg <= '1';
+                        state <= SEND;
+
+                    when SEND =>
+                        if phase_counter < bit_period - 1 then
+                            phase_counter <= phase_counter + 1;
+                        else
+                            phase_counter <= 0;
+                            if bit_counter < 23 then
+                                -- Move to the next bit
+                                bit_counter <= bit_counter + 1;
+                                for c in 0 to CHANNELS - 1 loop
+                                    shift_reg(24 * c + 23 downto 24 * c) <= shift_reg(24 * c + 22 downto 24 * c) & '0';
+                                end loop;
+                            elsif last_pixel then
+                                -- All pixels sent, latch the frame
+                                frame_done_reg <= '1';
+                                state <= LATCH;
+                            else
+                                -- Move straight on to the next pixel
+                                shift_reg <= pixel_data;
+                                last_pixel <= pixel_counter = pixel_count - 1;
+                                if pixel_counter = pixel_count - 1 then
+                                    pixel_counter <= 0;
+                                else
+                                    pixel_counter <= pixel_counter + 1;
+                                end if;
+                                bit_counter <= 0;
+                            end if;
+                        end if;
+                end case;
+            end if;
+        end if;
+    end process;
+
+    -- Each channel is high at the start of the slot, for as long as its
+    -- current bit asks for. Registered, so every edge is one clock late.
+    output_register : process(clk)
+    begin
+        if rising_edge(clk) then
+            for c in 0 to CHANNELS - 1 loop
+                if rst = '0' and state = SEND and
+                   ((shift_reg(24 * c + 23) = '1' and phase_counter < to_integer(t1h)) or
+                    (shift_reg(24 * c + 23) = '0' and phase_counter < to_integer(t0h))) then
+                    strip_output_reg(c) <= '1';
                 else
-                    -- All bits sent, start/rst rst period
-                    if rst_counter < rst_PERIOD then
-                        rst_counter <= rst_counter + 1;
-                        strip_output_reg <= '0'; -- Keep low during rst
-                    else
-                        rst_counter <= 0; -- rst for the next frame
-                        bit_counter <= 0; -- Restart sending bits
-                    end if;
+                    strip_output_reg(c) <= '0';
                 end if;
-            end if;
+            end loop;
         end if;
     end process;
 
-    -- Connect the strip_output signal
+    -- The pixel after the one being shifted out
+    pixel_index <= pixel_counter;
+
+    -- The same conditions that load shift_reg above
+    pixel_taken <= '1' when rst = '0' and (state = LOAD or
+                            (state = SEND and phase_counter >= bit_period - 1 and
+                             bit_counter = 23 and not last_pixel)) else '0';
+
+    frame_done <= frame_done_reg;
+    frame_load <= frame_load_reg;
+    frame_start <= frame_start_reg;
+
+    -- Connect the strip_output signals
     strip_output <= strip_output_reg;
 
 end behavioral;
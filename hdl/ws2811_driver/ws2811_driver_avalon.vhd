@@ -3,34 +3,175 @@
 library IEEE;
 use IEEE.std_logic_1164.all;
 use IEEE.numeric_std.all;
+use IEEE.math_real.all;
 
 library std;
 use std.standard;
 
 entity ws_2811_driver_avalon is
+  generic (
+    LED_COUNT : integer := 250; --Number of LEDs in each WS2811 chain
+    CHANNELS  : integer := 1;   --Number of chains driven in parallel (up to 8)
+    SPRITES   : integer := 4;   --Number of hardware sprites (up to 16)
+    SEGMENTS  : integer := 8;   --Number of colour segments (up to 16)
+    DEEP_COLOUR : integer := 1; --1: room in the framebuffer for 16-bit colours
+    STREAM_DEPTH : integer := 512 --Beats the stream FIFO holds (a power of 2)
+  );
   port (
     clk : in std_ulogic;
     rst : in std_ulogic;
     -- avalon memory-mapped slave interface
     avs_read      : in std_logic;
     avs_write     : in std_logic;
-    avs_address   : in std_logic_vector(1 downto 0);
+    avs_address   : in std_logic_vector(13 downto 0);
     avs_readdata  : out std_logic_vector(31 downto 0);
     avs_writedata : in std_logic_vector(31 downto 0);
+    avs_waitrequest : out std_logic;
+    -- second avalon slave: the back page as one linear run of words,
+    -- with bursts, see pixel_window.vhd
+    avp_read          : in std_logic;
+    avp_write         : in std_logic;
+    avp_address       : in std_logic_vector(12 downto 0);
+    avp_burstcount    : in std_logic_vector(7 downto 0);
+    avp_writedata     : in std_logic_vector(31 downto 0);
+    avp_byteenable    : in std_logic_vector(3 downto 0);
+    avp_readdata      : out std_logic_vector(31 downto 0);
+    avp_readdatavalid : out std_logic;
+    avp_waitrequest   : out std_logic;
+    -- avalon memory-mapped master fetching frames from memory, see
+    -- frame_fetch.vhd
+    avm_address       : out std_logic_vector(31 downto 0);
+    avm_read          : out std_logic;
+    avm_burstcount    : out std_logic_vector(4 downto 0);
+    avm_readdata      : in std_logic_vector(31 downto 0);
+    avm_readdatavalid : in std_logic;
+    avm_waitrequest   : in std_logic;
+    -- avalon streaming sink, one pixel per channel a beat, a frame a packet
+    asi_data          : in std_logic_vector(24 * CHANNELS - 1 downto 0);
+    asi_valid         : in std_logic;
+    asi_ready         : out std_logic;
+    asi_startofpacket : in std_logic;
+    asi_endofpacket   : in std_logic;
+    -- frame-done interrupt
+    irq           : out std_logic;
+    -- position of the moving led, for hit detection in the stop button
+    strip_index_out     : out std_logic_vector(31 downto 0);
     -- external I/O; export to top-level
-    strip_output        : out std_logic
+    strip_output        : out std_logic_vector(CHANNELS - 1 downto 0)
   );
 end entity ws_2811_driver_avalon;
 
 architecture arch of ws_2811_driver_avalon is
 
+  -- Bits needed to address n words (at least one)
+  function addr_width(n : natural) return natural is
+  begin
+    if n <= 2 then
+      return 1;
+    end if;
+    return natural(ceil(log2(real(n))));
+  end function;
+
   -- Generic constants for WS2811 driver
   constant CLK_PERIOD : time := 20 ns; -- Clock period for 50 MHz clock
-  constant LED_COUNT  : integer := 250; --Number of LEDs in the WS2811 chain
-    
-  -- Signals for the ws2811 driver
-  signal data_array  : std_logic_vector((24 * LED_COUNT) - 1 downto 0);
-  
+
+  -- WS2811 400 kHz timings in clock cycles, used until software changes them
+  constant T0H_RESET   : natural := integer(500 ns / CLK_PERIOD);  -- High for "0"
+  constant T0L_RESET   : natural := integer(2000 ns / CLK_PERIOD); -- Low for "0"
+  constant T1H_RESET   : natural := integer(1200 ns / CLK_PERIOD); -- High for "1"
+  constant T1L_RESET   : natural := integer(1300 ns / CLK_PERIOD); -- Low for "1"
+  constant LATCH_RESET : natural := integer(100 us / CLK_PERIOD);  -- Latch time
+
+  -- The framebuffer occupies the upper half of the address space (byte
+  -- offset 0x8000), one 32-bit word per LED with the colour in bits 23-0.
+  -- Each channel has its own bank of 2**FB_ADDR_WIDTH words, so LED i of
+  -- channel c is at word c * 2**FB_ADDR_WIDTH + i; all banks must fit in
+  -- the 8192 words of the window.
+  -- It is double buffered: the bus sees the back page, the strip shows the
+  -- front page, and a commit swaps them at the end of a frame.
+  constant FB_ADDR_WIDTH : natural := addr_width((1 + DEEP_COLOUR) * LED_COUNT);
+  constant CH_ADDR_WIDTH : natural := natural(ceil(log2(real(CHANNELS))));
+  constant FB_SELECT     : natural := 13;
+
+  -- word addresses of the registers
+  constant REG_RGB_SINGLE  : natural := 0;
+  constant REG_RGB_ALL     : natural := 1;
+  constant REG_STRIP_INDEX : natural := 2;
+  constant REG_CTRL        : natural := 3;
+  constant REG_LED_COUNT   : natural := 4;
+  constant REG_COMMIT      : natural := 5;
+  constant REG_IRQ_CTRL    : natural := 6;
+  constant REG_FRAME_COUNT : natural := 7;
+  constant REG_T0H         : natural := 8;
+  constant REG_T0L         : natural := 9;
+  constant REG_T1H         : natural := 10;
+  constant REG_T1L         : natural := 11;
+  constant REG_LATCH       : natural := 12;
+  constant REG_ACTIVE      : natural := 13;
+  constant REG_CHANNELS    : natural := 14;
+  constant REG_STRIDE      : natural := 15;
+  constant REG_SPRITES     : natural := 16;
+  constant REG_ROTATE      : natural := 17;
+  constant REG_ROTATE_STEP : natural := 18;
+  constant REG_SEGMENTS    : natural := 19;
+  constant REG_RLE_POS     : natural := 20;
+  constant REG_RLE_DATA    : natural := 21;
+  constant REG_BRIGHTNESS  : natural := 22;
+  constant REG_LATENCY     : natural := 23;
+  constant REG_LATENCY_MAX : natural := 24;
+  constant REG_HUE_OFFSET  : natural := 25;
+  -- the pattern generator, see pattern_generator.vhd
+  constant REG_PATTERN        : natural := 26;
+  constant REG_PATTERN_SPEED  : natural := 27;
+  constant REG_PATTERN_SCALE  : natural := 28;
+  constant REG_PATTERN_COLOR  : natural := 29;
+  constant REG_PATTERN_COLOR2 : natural := 30;
+  -- the stream sink's counters and FIFO level, see pixel_stream.vhd
+  constant REG_STREAM_UNDERFLOW    : natural := 31;
+  constant REG_STREAM_BACKPRESSURE : natural := 32;
+  constant REG_STREAM_LEVEL        : natural := 33;
+  -- the frame fetch, see frame_fetch.vhd; bit 0 of dma_addr commits the
+  -- page once it has been fetched, and a write to dma_status gives the
+  -- fetch up
+  constant REG_DMA_ADDR    : natural := 34;
+  constant REG_DMA_STATUS  : natural := 35;
+  constant DMA_COMMIT      : natural := 0;
+  -- clock cycles (1.3 ms) the memory port may keep a fetch waiting
+  constant FETCH_TIMEOUT   : natural := 2**16;
+  -- free-running counters for profiling, next to frame_count: bits sent
+  -- on each strip, register slave reads and writes, and clock cycles the
+  -- register slave held off an access while the framebuffer was taken
+  constant REG_PERF_BITS   : natural := 36;
+  constant REG_PERF_READS  : natural := 37;
+  constant REG_PERF_WRITES : natural := 38;
+  constant REG_PERF_STALLS : natural := 39;
+  -- four words per sprite from byte offset 0x100, see sprite_engine.vhd
+  constant SPRITE_BASE     : natural := 64;
+  -- four words per segment from byte offset 0x200, see segment_table.vhd
+  constant SEGMENT_BASE    : natural := 128;
+  -- 256 palette colours from byte offset 0x400
+  constant PALETTE_BASE    : natural := 256;
+  -- 256 gamma table words from byte offset 0x800, see colour_correction.vhd
+  constant GAMMA_BASE      : natural := 512;
+
+  -- ctrl register bits
+  constant CTRL_FRAMEBUFFER : natural := 0; -- 1: show the framebuffer
+  constant CTRL_REVERSE     : natural := 1; -- 1: LED 0 shows the last pixel
+  constant CTRL_MIRROR      : natural := 2; -- 1: second half mirrors the first
+  constant CTRL_INDEXED     : natural := 3; -- 1: framebuffer holds palette indices
+  constant CTRL_GAMMA       : natural := 4; -- 1: colours go through the gamma table
+  constant CTRL_DEEP        : natural := 5; -- 1: framebuffer holds 16-bit colours
+  constant CTRL_DITHER      : natural := 6; -- 1: dither 16-bit colours over frames
+  constant CTRL_ON_DEMAND   : natural := 7; -- 1: send a frame only when something changed
+  constant CTRL_HSV         : natural := 8; -- 1: colours are hue, saturation and value
+  constant CTRL_STREAM      : natural := 9; -- 1: show the pixels streamed to the sink
+
+  -- pattern register: numbers past the last pattern show none
+  constant PATTERN_LAST     : natural := 4;
+
+  -- rotate_step register: bits 15-0 frames per step, bit 31 steps backwards
+  constant ROTATE_REVERSE   : natural := 31;
+
   -- Avalon bus signals
   -- Color of the majority of leds
   signal rgb_all        : std_logic_vector(31 downto 0) := (30 => '1', others => '0');
@@ -38,73 +179,1289 @@ architecture arch of ws_2811_driver_avalon is
   signal rgb_single     : std_logic_vector(31 downto 0) := (30 => '1', others => '0');
   -- Sets which led is the single led
   signal strip_index    : std_logic_vector(31 downto 0) := (30 => '1', others => '0');
-  -- Convert strip_index to integer using only the least significant LED_COUNT bits
-  signal strip_index_int : integer range 0 to LED_COUNT-1 := 0;
+  -- Selects where the pixels come from
+  signal ctrl           : std_logic_vector(31 downto 0) := (others => '0');
+
+  -- Bit timings and latch period in clock cycles (16 bits)
+  signal t0h            : unsigned(15 downto 0) := to_unsigned(T0H_RESET, 16);
+  signal t0l            : unsigned(15 downto 0) := to_unsigned(T0L_RESET, 16);
+  signal t1h            : unsigned(15 downto 0) := to_unsigned(T1H_RESET, 16);
+  signal t1l            : unsigned(15 downto 0) := to_unsigned(T1L_RESET, 16);
+  signal latch          : unsigned(15 downto 0) := to_unsigned(LATCH_RESET, 16);
+  -- Number of leds sent per frame; 0 or more than LED_COUNT sends them all
+  signal active_count   : std_logic_vector(31 downto 0) := (others => '0');
+  -- Pixel shown on LED 0, stepped every rotate_step frames
+  signal rotate         : natural range 0 to LED_COUNT - 1 := 0;
+  signal rotate_step    : std_logic_vector(31 downto 0) := (others => '0');
+  signal rotate_elapsed : unsigned(15 downto 0) := (others => '0');
+  -- Every colour is scaled by brightness / 256
+  signal brightness     : natural range 0 to 256 := 256;
+  -- Added to every hue in HSV mode
+  signal hue_offset     : unsigned(7 downto 0) := (others => '0');
+  -- Pattern drawn over the framebuffer or legacy pixels, 0 for none
+  signal pattern        : natural range 0 to 7 := 0;
+  signal pattern_speed  : signed(15 downto 0) := (others => '0');
+  signal pattern_scale  : unsigned(15 downto 0) := (others => '0');
+  signal pattern_color  : std_logic_vector(23 downto 0) := (others => '0');
+  signal pattern_color2 : std_logic_vector(23 downto 0) := (others => '0');
+
+  -- Copies of the registers above taken at the end of every frame, so a
+  -- frame never shows half of an update
+  signal rgb_all_shown     : std_logic_vector(31 downto 0) := (others => '0');
+  signal rgb_single_shown  : std_logic_vector(31 downto 0) := (others => '0');
+  signal strip_index_shown : std_logic_vector(31 downto 0) := (others => '0');
+  signal ctrl_shown        : std_logic_vector(31 downto 0) := (others => '0');
+  signal t0h_shown         : unsigned(15 downto 0) := to_unsigned(T0H_RESET, 16);
+  signal t0l_shown         : unsigned(15 downto 0) := to_unsigned(T0L_RESET, 16);
+  signal t1h_shown         : unsigned(15 downto 0) := to_unsigned(T1H_RESET, 16);
+  signal t1l_shown         : unsigned(15 downto 0) := to_unsigned(T1L_RESET, 16);
+  signal latch_shown       : unsigned(15 downto 0) := to_unsigned(LATCH_RESET, 16);
+  signal pixel_count       : natural range 1 to LED_COUNT := LED_COUNT;
+  signal rotate_shown      : natural range 0 to LED_COUNT - 1 := 0;
+  signal brightness_shown  : natural range 0 to 256 := 256;
+  signal hue_offset_shown  : unsigned(7 downto 0) := (others => '0');
+  signal pattern_shown        : natural range 0 to 7 := 0;
+  signal pattern_speed_shown  : signed(15 downto 0) := (others => '0');
+  signal pattern_scale_shown  : unsigned(15 downto 0) := (others => '0');
+  signal pattern_color_shown  : std_logic_vector(23 downto 0) := (others => '0');
+  signal pattern_color2_shown : std_logic_vector(23 downto 0) := (others => '0');
+
+  -- Page flipping and the frame-done interrupt. New register values are
+  -- taken at frame_done, and with on-demand refresh also at frame_load,
+  -- just before a frame that was asked for.
+  signal frame_done   : std_logic;
+  signal frame_load   : std_logic;
+  signal frame_start  : std_logic;
+  signal frame_switch : std_logic;
+  signal front_page   : std_logic := '0';
+  signal commit       : std_logic := '0';
+  signal frame_count  : unsigned(31 downto 0) := (others => '0');
+  signal irq_enable   : std_logic := '0';
+  signal irq_pending  : std_logic := '0';
+
+  -- A register write that changes what is shown, or a sprite step, makes
+  -- the picture dirty until the next frame_switch, which leaves the change
+  -- waiting for its frame to start. The clocks from the write to the first
+  -- bit of that frame are the refresh latency.
+  signal refresh_write : std_logic;
+  signal changed       : std_logic;
+  signal dirty         : std_logic := '0';
+  signal waiting       : std_logic := '0';
+  signal frame_wanted  : std_logic;
+  signal dirty_count   : unsigned(31 downto 0) := (others => '0');
+  signal wait_count    : unsigned(31 downto 0) := (others => '0');
+  signal latency       : unsigned(31 downto 0) := (others => '0');
+  signal latency_max   : unsigned(31 downto 0) := (others => '0');
+
+  -- Run-length decoder: each word written to rle_data paints bits 31-24
+  -- plus one leds from rle_pos on with the colour in bits 23-0, one led a
+  -- clock, into the back page. rle_pos counts along the channels one after
+  -- the other and stops at the end of the last one.
+  constant TOTAL_LEDS  : natural := LED_COUNT * CHANNELS;
+  signal rle_pos       : natural range 0 to TOTAL_LEDS := 0;
+  signal rle_left      : natural range 0 to 255 := 0;
+  signal rle_colour    : std_logic_vector(23 downto 0) := (others => '0');
+  signal rle_busy      : std_logic := '0';
+  signal rle_channel   : natural range 0 to CHANNELS - 1;
+  signal rle_led       : natural range 0 to LED_COUNT - 1;
+
+  -- The bus waits while the decoder has the framebuffer, and for the one
+  -- cycle a registered read takes
+  signal stall         : std_logic;
+  signal read_ack      : std_logic := '0';
+  signal waitrequest   : std_logic;
+
+  signal perf_bits   : unsigned(31 downto 0) := (others => '0');
+  signal perf_reads  : unsigned(31 downto 0) := (others => '0');
+  signal perf_writes : unsigned(31 downto 0) := (others => '0');
+  signal perf_stalls : unsigned(31 downto 0) := (others => '0');
+
+  -- Bus side of the framebuffer, shared by the decoder, the pixel window
+  -- and the register slave, in that order
+  signal fb_a_addr     : unsigned(FB_ADDR_WIDTH downto 0);
+  signal fb_wdata      : std_logic_vector(31 downto 0);
+
+  -- The pixel window's accesses to the framebuffer, and the words a
+  -- channel takes in the current mode
+  signal window_read    : std_logic;
+  signal window_write   : std_logic;
+  signal window_channel : natural range 0 to CHANNELS - 1;
+  signal window_word    : unsigned(FB_ADDR_WIDTH - 1 downto 0);
+  signal window_wdata   : std_logic_vector(31 downto 0);
+  signal window_rdata   : std_logic_vector(32 * CHANNELS - 1 downto 0);
+  signal window_row     : natural range 1 to 2**FB_ADDR_WIDTH;
+  signal window_busy    : std_logic;
+
+  -- The frame fetch: the address it reads from, and its framebuffer writes
+  signal dma_addr      : std_logic_vector(31 downto 0) := (others => '0');
+  signal fetch_start   : std_logic;
+  signal fetch_abort   : std_logic;
+  signal fetch_busy    : std_logic;
+  signal fetch_done    : std_logic;
+  signal fetch_error   : std_logic;
+  signal fetch_write   : std_logic;
+  signal fetch_channel : natural range 0 to CHANNELS - 1;
+  signal fetch_word    : unsigned(FB_ADDR_WIDTH - 1 downto 0);
+  signal fetch_wdata   : std_logic_vector(31 downto 0);
+
+  -- Register read data and whether the last read was from the framebuffer
+  -- or the palette, and for the framebuffer whether the fetch had it
+  signal reg_readdata : std_logic_vector(31 downto 0);
+  signal fb_read      : std_logic := '0';
+  signal fb_read_lost : std_logic := '0';
+  signal palette_read : std_logic := '0';
+  signal gamma_read   : std_logic := '0';
+
+  -- one colour, or one framebuffer word, per channel
+  type pixel_array is array (natural range <>) of std_logic_vector(23 downto 0);
+  type word_array is array (natural range <>) of std_logic_vector(31 downto 0);
+
+  -- Sprites drawn over the pixels, and the bus window onto their registers
+  signal sprite_select   : std_logic;
+  signal sprite_write    : std_logic;
+  signal sprite_address  : natural range 0 to 4 * SPRITES - 1;
+  signal sprite_readdata : std_logic_vector(31 downto 0);
+  signal sprite_hit      : std_logic_vector(CHANNELS - 1 downto 0);
+  signal sprite_color    : std_logic_vector(24 * CHANNELS - 1 downto 0);
+  signal sprite0_index   : std_logic_vector(31 downto 0);
+  signal sprite0_visible : std_logic;
+  signal sprite_moved    : std_logic;
+  signal sprite_paced    : std_logic;
+
+  -- Colour segments painted over the framebuffer or legacy pixels
+  signal segment_select   : std_logic;
+  signal segment_write    : std_logic;
+  signal segment_address  : natural range 0 to 4 * SEGMENTS - 1;
+  signal segment_readdata : std_logic_vector(31 downto 0);
+  signal segment_hit      : std_logic_vector(CHANNELS - 1 downto 0);
+  signal segment_color    : std_logic_vector(24 * CHANNELS - 1 downto 0);
+
+  -- The pattern generator's colour, the same on every channel, and
+  -- whether it is hue, saturation and value
+  signal pattern_colour : std_logic_vector(23 downto 0);
+  signal pattern_hsv    : std_logic;
+
+  -- Pixels from the streaming sink, in wire order
+  constant STREAM_WIDTH : natural := addr_width(STREAM_DEPTH);
+  signal stream_colour       : std_logic_vector(24 * CHANNELS - 1 downto 0);
+  signal stream_level        : unsigned(STREAM_WIDTH downto 0);
+  signal stream_underflow    : unsigned(31 downto 0);
+  signal stream_backpressure : unsigned(31 downto 0);
+  -- writes to the counters clear them
+  signal stream_underflow_clear    : std_logic;
+  signal stream_backpressure_clear : std_logic;
+
+  -- Brightness and the gamma table, applied to the finished pixels
+  signal gamma_select   : std_logic;
+  signal gamma_write    : std_logic;
+  signal gamma_readdata : std_logic_vector(31 downto 0);
+
+  -- Framebuffer ports; the bus addresses one channel's bank at a time
+  signal fb_channel      : natural range 0 to 2**CH_ADDR_WIDTH - 1;
+  signal fb_read_channel : natural range 0 to 2**CH_ADDR_WIDTH - 1 := 0;
+  signal fb_rdata        : word_array(0 to CHANNELS - 1);
+  signal fb_word         : word_array(0 to CHANNELS - 1);
+  signal fb_address      : unsigned(FB_ADDR_WIDTH downto 0);
+
+  -- In indexed mode every framebuffer word holds four 8-bit palette
+  -- indices, LED 4n + b in bits 8b+7 downto 8b, and the palette holds
+  -- the colours; there is one copy of the palette per channel, all
+  -- written together
+  signal palette_select : std_logic;
+  signal palette_write  : std_logic;
+  signal palette_rdata  : pixel_array(0 to CHANNELS - 1);
+  signal index_byte     : natural range 0 to 3 := 0;
+  signal fb_pixel       : pixel_array(0 to CHANNELS - 1);
+
+  -- In deep mode LED i takes two framebuffer words, 2i with red in bits
+  -- 31-16 and green in bits 15-0, and 2i + 1 with blue in bits 15-0. They
+  -- are read on alternate clocks; deep_phase_read is the word the
+  -- framebuffer output belongs to.
+  signal deep_phase      : std_logic := '0';
+  signal deep_phase_read : std_logic := '0';
+
+  -- Pixel requested by the driver, the pixel of the framebuffer or legacy
+  -- registers it shows after rotation and mirroring, and its colour on
+  -- every channel
+  signal pixel_index  : natural range 0 to LED_COUNT - 1;
+  signal source_index : natural range 0 to LED_COUNT - 1 := 0;
+  signal pixel_taken  : std_logic;
+  -- 8-bit colours of the layers, as written and after HSV conversion,
+  -- and whether each channel shows a 16-bit framebuffer colour instead
+  signal layer_colour : std_logic_vector(24 * CHANNELS - 1 downto 0);
+  signal hsv_colour   : std_logic_vector(24 * CHANNELS - 1 downto 0);
+  signal rgb_colour   : std_logic_vector(24 * CHANNELS - 1 downto 0);
+  signal deep_shown   : std_logic_vector(CHANNELS - 1 downto 0);
+  -- 16 bits per colour up to the dither stage
+  signal layer_pixel  : std_logic_vector(48 * CHANNELS - 1 downto 0);
+  signal corrected    : std_logic_vector(48 * CHANNELS - 1 downto 0);
+  signal pixel_data   : std_logic_vector(24 * CHANNELS - 1 downto 0);
+  signal legacy_pixel : pixel_array(0 to CHANNELS - 1) := (others => (others => '0'));
 
   -- Define Components
   component ws2811_driver is
     generic (
-      CLK_PERIOD : time;
-      LED_COUNT  : integer
+      LED_COUNT  : integer;
+      CHANNELS   : integer
     );
     port (
       clk          : in std_logic;
       rst          : in std_logic;
-      data_array   : in std_logic_vector((24 * LED_COUNT) - 1 downto 0);
-      strip_output : out std_logic
+      t0h          : in unsigned(15 downto 0);
+      t0l          : in unsigned(15 downto 0);
+      t1h          : in unsigned(15 downto 0);
+      t1l          : in unsigned(15 downto 0);
+      latch_period : in unsigned(15 downto 0);
+      pixel_count  : in natural range 1 to LED_COUNT;
+      on_demand    : in std_logic;
+      start        : in std_logic;
+      pixel_index  : out natural range 0 to LED_COUNT - 1;
+      pixel_data   : in std_logic_vector(24 * CHANNELS - 1 downto 0);
+      pixel_taken  : out std_logic;
+      frame_done   : out std_logic;
+      frame_load   : out std_logic;
+      frame_start  : out std_logic;
+      strip_output : out std_logic_vector(CHANNELS - 1 downto 0)
+    );
+  end component;
+
+  component pixel_ram is
+    generic (
+      ADDR_WIDTH : natural;
+      DATA_WIDTH : natural
+    );
+    port (
+      clk     : in std_logic;
+      a_addr  : in unsigned(ADDR_WIDTH - 1 downto 0);
+      a_write : in std_logic;
+      a_wdata : in std_logic_vector(DATA_WIDTH - 1 downto 0);
+      a_rdata : out std_logic_vector(DATA_WIDTH - 1 downto 0);
+      b_addr  : in unsigned(ADDR_WIDTH - 1 downto 0);
+      b_rdata : out std_logic_vector(DATA_WIDTH - 1 downto 0)
+    );
+  end component;
+
+  component sprite_engine is
+    generic (
+      LED_COUNT : integer;
+      CHANNELS  : integer;
+      SPRITES   : integer;
+      CLK_HZ    : integer := 50_000_000
+    );
+    port (
+      clk         : in std_logic;
+      rst         : in std_logic;
+      write       : in std_logic;
+      address     : in natural range 0 to 4 * SPRITES - 1;
+      writedata   : in std_logic_vector(31 downto 0);
+      readdata    : out std_logic_vector(31 downto 0);
+      frame_done  : in std_logic;
+      frame_load  : in std_logic;
+      pixel_index : in natural range 0 to LED_COUNT - 1;
+      hit         : out std_logic_vector(CHANNELS - 1 downto 0);
+      color       : out std_logic_vector(24 * CHANNELS - 1 downto 0);
+      position0   : out std_logic_vector(31 downto 0);
+      visible0    : out std_logic;
+      moved       : out std_logic;
+      frame_paced : out std_logic
+    );
+  end component;
+
+  component segment_table is
+    generic (
+      LED_COUNT : integer;
+      CHANNELS  : integer;
+      SEGMENTS  : integer
+    );
+    port (
+      clk         : in std_logic;
+      rst         : in std_logic;
+      write       : in std_logic;
+      address     : in natural range 0 to 4 * SEGMENTS - 1;
+      writedata   : in std_logic_vector(31 downto 0);
+      readdata    : out std_logic_vector(31 downto 0);
+      frame_done  : in std_logic;
+      frame_load  : in std_logic;
+      pixel_index : in natural range 0 to LED_COUNT - 1;
+      hit         : out std_logic_vector(CHANNELS - 1 downto 0);
+      color       : out std_logic_vector(24 * CHANNELS - 1 downto 0)
+    );
+  end component;
+
+  component pattern_generator is
+    generic (
+      LED_COUNT : integer
+    );
+    port (
+      clk         : in std_logic;
+      rst         : in std_logic;
+      frame_done  : in std_logic;
+      pattern     : in natural range 0 to 7;
+      speed       : in signed(15 downto 0);
+      scale       : in unsigned(15 downto 0);
+      colour      : in std_logic_vector(23 downto 0);
+      colour2     : in std_logic_vector(23 downto 0);
+      pixel_index : in natural range 0 to LED_COUNT - 1;
+      colour_out  : out std_logic_vector(23 downto 0);
+      hsv         : out std_logic
+    );
+  end component;
+
+  component pixel_stream is
+    generic (
+      LED_COUNT   : integer;
+      CHANNELS    : integer;
+      DEPTH_WIDTH : natural
+    );
+    port (
+      clk                : in std_logic;
+      rst                : in std_logic;
+      enable             : in std_logic;
+      data               : in std_logic_vector(24 * CHANNELS - 1 downto 0);
+      valid              : in std_logic;
+      ready              : out std_logic;
+      startofpacket      : in std_logic;
+      endofpacket        : in std_logic;
+      frame_done         : in std_logic;
+      pixel_index        : in natural range 0 to LED_COUNT - 1;
+      pixel_taken        : in std_logic;
+      colour             : out std_logic_vector(24 * CHANNELS - 1 downto 0);
+      level              : out unsigned(DEPTH_WIDTH downto 0);
+      underflow          : out unsigned(31 downto 0);
+      backpressure       : out unsigned(31 downto 0);
+      clear_underflow    : in std_logic;
+      clear_backpressure : in std_logic
     );
   end component;
 
+  component pixel_window is
+    generic (
+      CHANNELS      : integer;
+      FB_ADDR_WIDTH : natural;
+      BURST_WIDTH   : natural
+    );
+    port (
+      clk           : in std_logic;
+      rst           : in std_logic;
+      read          : in std_logic;
+      write         : in std_logic;
+      address       : in std_logic_vector(12 downto 0);
+      burstcount    : in std_logic_vector(BURST_WIDTH - 1 downto 0);
+      writedata     : in std_logic_vector(31 downto 0);
+      byteenable    : in std_logic_vector(3 downto 0);
+      readdata      : out std_logic_vector(31 downto 0);
+      readdatavalid : out std_logic;
+      waitrequest   : out std_logic;
+      row           : in natural range 1 to 2**FB_ADDR_WIDTH;
+      busy          : in std_logic;
+      fb_read       : out std_logic;
+      fb_write      : out std_logic;
+      fb_channel    : out natural range 0 to CHANNELS - 1;
+      fb_word       : out unsigned(FB_ADDR_WIDTH - 1 downto 0);
+      fb_wdata      : out std_logic_vector(31 downto 0);
+      fb_rdata      : in std_logic_vector(32 * CHANNELS - 1 downto 0)
+    );
+  end component;
+
+  component frame_fetch is
+    generic (
+      CHANNELS      : integer;
+      FB_ADDR_WIDTH : natural;
+      BURST_WIDTH   : natural;
+      TIMEOUT       : positive
+    );
+    port (
+      clk           : in std_logic;
+      rst           : in std_logic;
+      start         : in std_logic;
+      abort         : in std_logic;
+      base          : in std_logic_vector(31 downto 0);
+      row           : in natural range 1 to 2**FB_ADDR_WIDTH;
+      hold          : in std_logic;
+      busy          : out std_logic;
+      done          : out std_logic;
+      failed        : out std_logic;
+      address       : out std_logic_vector(31 downto 0);
+      read          : out std_logic;
+      burstcount    : out std_logic_vector(BURST_WIDTH - 1 downto 0);
+      readdata      : in std_logic_vector(31 downto 0);
+      readdatavalid : in std_logic;
+      waitrequest   : in std_logic;
+      fb_write      : out std_logic;
+      fb_channel    : out natural range 0 to CHANNELS - 1;
+      fb_word       : out unsigned(FB_ADDR_WIDTH - 1 downto 0);
+      fb_wdata      : out std_logic_vector(31 downto 0)
+    );
+  end component;
+
+  component colour_correction is
+    generic (
+      CHANNELS : integer
+    );
+    port (
+      clk        : in std_logic;
+      write      : in std_logic;
+      address    : in unsigned(7 downto 0);
+      writedata  : in std_logic_vector(31 downto 0);
+      readdata   : out std_logic_vector(31 downto 0);
+      gamma      : in std_logic;
+      brightness : in natural range 0 to 256;
+      pixel_in   : in std_logic_vector(48 * CHANNELS - 1 downto 0);
+      pixel_out  : out std_logic_vector(48 * CHANNELS - 1 downto 0)
+    );
+  end component;
+
+  component temporal_dither is
+    generic (
+      LED_COUNT : integer;
+      CHANNELS  : integer
+    );
+    port (
+      clk         : in std_logic;
+      enable      : in std_logic;
+      pixel_index : in natural range 0 to LED_COUNT - 1;
+      pixel_taken : in std_logic;
+      pixel_in    : in std_logic_vector(48 * CHANNELS - 1 downto 0);
+      pixel_out   : out std_logic_vector(24 * CHANNELS - 1 downto 0)
+    );
+  end component;
+
+  component hsv_to_rgb is
+    generic (
+      CHANNELS : integer
+    );
+    port (
+      clk        : in std_logic;
+      hue_offset : in unsigned(7 downto 0);
+      hsv_in     : in std_logic_vector(24 * CHANNELS - 1 downto 0);
+      rgb_out    : out std_logic_vector(24 * CHANNELS - 1 downto 0)
+    );
+  end component;
+
+  -- 8-bit colours as 16-bit ones, with nothing to dither
+  function deepen(colour : std_logic_vector(23 downto 0)) return std_logic_vector is
+  begin
+    return colour(23 downto 16) & x"00" & colour(15 downto 8) & x"00" & colour(7 downto 0) & x"00";
+  end function;
+
 begin
-  
+
   -- ws2811 driver instatiation
   DRIVER1 : ws2811_driver
   generic map(
-    CLK_PERIOD => CLK_PERIOD,
-    LED_COUNT  => LED_COUNT
+    LED_COUNT  => LED_COUNT,
+    CHANNELS   => CHANNELS
   )
   port map
   (
-    clk        => clk,
-    rst        => rst,
-    data_array => data_array,
-    strip_output     => strip_output
+    clk          => clk,
+    rst          => rst,
+    t0h          => t0h_shown,
+    t0l          => t0l_shown,
+    t1h          => t1h_shown,
+    t1l          => t1l_shown,
+    latch_period => latch_shown,
+    pixel_count  => pixel_count,
+    on_demand    => ctrl(CTRL_ON_DEMAND),
+    start        => frame_wanted,
+    pixel_index  => pixel_index,
+    pixel_data   => pixel_data,
+    pixel_taken  => pixel_taken,
+    frame_done   => frame_done,
+    frame_load   => frame_load,
+    frame_start  => frame_start,
+    strip_output => strip_output
+  );
+
+  sprite_select  <= '1' when avs_address(FB_SELECT) = '0' and
+                            to_integer(unsigned(avs_address)) >= SPRITE_BASE and
+                            to_integer(unsigned(avs_address)) < SPRITE_BASE + 4 * SPRITES else '0';
+  sprite_write   <= avs_write and sprite_select;
+  sprite_address <= to_integer(unsigned(avs_address)) - SPRITE_BASE when sprite_select = '1' else 0;
+
+  SPRITE_LAYER : sprite_engine
+  generic map(
+    LED_COUNT => LED_COUNT,
+    CHANNELS  => CHANNELS,
+    SPRITES   => SPRITES,
+    CLK_HZ    => integer(1 sec / CLK_PERIOD)
+  )
+  port map
+  (
+    clk         => clk,
+    rst         => rst,
+    write       => sprite_write,
+    address     => sprite_address,
+    writedata   => avs_writedata,
+    readdata    => sprite_readdata,
+    frame_done  => frame_done,
+    frame_load  => frame_load,
+    pixel_index => pixel_index,
+    hit         => sprite_hit,
+    color       => sprite_color,
+    position0   => sprite0_index,
+    visible0    => sprite0_visible,
+    moved       => sprite_moved,
+    frame_paced => sprite_paced
+  );
+
+  segment_select  <= '1' when avs_address(FB_SELECT) = '0' and
+                             to_integer(unsigned(avs_address)) >= SEGMENT_BASE and
+                             to_integer(unsigned(avs_address)) < SEGMENT_BASE + 4 * SEGMENTS else '0';
+  segment_write   <= avs_write and segment_select;
+  segment_address <= to_integer(unsigned(avs_address)) - SEGMENT_BASE when segment_select = '1' else 0;
+
+  -- segments belong to the picture, so they follow rotation and mirroring
+  SEGMENT_LAYER : segment_table
+  generic map(
+    LED_COUNT => LED_COUNT,
+    CHANNELS  => CHANNELS,
+    SEGMENTS  => SEGMENTS
+  )
+  port map
+  (
+    clk         => clk,
+    rst         => rst,
+    write       => segment_write,
+    address     => segment_address,
+    writedata   => avs_writedata,
+    readdata    => segment_readdata,
+    frame_done  => frame_done,
+    frame_load  => frame_load,
+    pixel_index => source_index,
+    hit         => segment_hit,
+    color       => segment_color
+  );
+
+  -- patterns belong to the picture too, and move on once a frame sent
+  PATTERN_LAYER : pattern_generator
+  generic map(
+    LED_COUNT => LED_COUNT
+  )
+  port map
+  (
+    clk         => clk,
+    rst         => rst,
+    frame_done  => frame_done,
+    pattern     => pattern_shown,
+    speed       => pattern_speed_shown,
+    scale       => pattern_scale_shown,
+    colour      => pattern_color_shown,
+    colour2     => pattern_color2_shown,
+    pixel_index => source_index,
+    colour_out  => pattern_colour,
+    hsv         => pattern_hsv
+  );
+
+  stream_underflow_clear    <= avs_write when to_integer(unsigned(avs_address)) = REG_STREAM_UNDERFLOW else '0';
+  stream_backpressure_clear <= avs_write when to_integer(unsigned(avs_address)) = REG_STREAM_BACKPRESSURE else '0';
+
+  -- Streamed pixels go straight to the driver in the order they come, so
+  -- they don't follow reverse, mirror or rotation
+  STREAM_SINK : pixel_stream
+  generic map(
+    LED_COUNT   => LED_COUNT,
+    CHANNELS    => CHANNELS,
+    DEPTH_WIDTH => STREAM_WIDTH
+  )
+  port map
+  (
+    clk                => clk,
+    rst                => rst,
+    enable             => ctrl_shown(CTRL_STREAM),
+    data               => asi_data,
+    valid              => asi_valid,
+    ready              => asi_ready,
+    startofpacket      => asi_startofpacket,
+    endofpacket        => asi_endofpacket,
+    frame_done         => frame_done,
+    pixel_index        => pixel_index,
+    pixel_taken        => pixel_taken,
+    colour             => stream_colour,
+    level              => stream_level,
+    underflow          => stream_underflow,
+    backpressure       => stream_backpressure,
+    clear_underflow    => stream_underflow_clear,
+    clear_backpressure => stream_backpressure_clear
   );
 
-  -- Process to turn on an individal led depending on index
-  process(strip_index, rgb_single, rgb_all)
-    variable i : integer;
+  assert FB_ADDR_WIDTH + CH_ADDR_WIDTH <= FB_SELECT
+    report "CHANNELS banks of LED_COUNT words don't fit in the framebuffer window"
+    severity failure;
+
+  SINGLE_CHANNEL : if CH_ADDR_WIDTH = 0 generate
+    fb_channel <= 0;
+  end generate;
+
+  MULTI_CHANNEL : if CH_ADDR_WIDTH > 0 generate
+    fb_channel <= to_integer(unsigned(avs_address(FB_ADDR_WIDTH + CH_ADDR_WIDTH - 1 downto FB_ADDR_WIDTH)));
+  end generate;
+
+  -- Which pixel each led shows: reversed, then with the second half of the
+  -- strip mirroring the first, then rotated. The same on every channel.
+  -- The driver waits a whole pixel time before sampling, so the extra
+  -- register in front of the framebuffer costs nothing.
+  source_mapping : process (clk)
+    variable index : natural range 0 to LED_COUNT - 1;
+    variable moved : natural range 0 to 2 * LED_COUNT - 2;
+  begin
+    if rising_edge(clk) then
+      index := pixel_index;
+      if ctrl_shown(CTRL_REVERSE) = '1' then
+        index := LED_COUNT - 1 - index;
+      end if;
+      if ctrl_shown(CTRL_MIRROR) = '1' and index > (LED_COUNT - 1) / 2 then
+        index := LED_COUNT - 1 - index;
+      end if;
+      moved := index + rotate_shown;
+      if moved >= LED_COUNT then
+        source_index <= moved - LED_COUNT;
+      else
+        source_index <= moved;
+      end if;
+    end if;
+  end process;
+
+  -- Four leds share a word in indexed mode, and each takes two in deep mode
+  fb_address <= front_page & to_unsigned(source_index / 4, FB_ADDR_WIDTH) when ctrl_shown(CTRL_INDEXED) = '1' else
+                front_page & to_unsigned(source_index, FB_ADDR_WIDTH - 1) & deep_phase when ctrl_shown(CTRL_DEEP) = '1' else
+                front_page & to_unsigned(source_index, FB_ADDR_WIDTH);
+
+  deep_read : process (clk)
   begin
-    -- Convert index to int
-	 strip_index_int <= to_integer(unsigned(strip_index));
-	 
-    -- Clear the entire data array first
-    data_array <= (others => '0');
+    if rising_edge(clk) then
+      deep_phase      <= not deep_phase;
+      deep_phase_read <= deep_phase;
+    end if;
+  end process;
+
+  -- which index of the word just read belongs to the led
+  index_select : process (clk)
+  begin
+    if rising_edge(clk) then
+      index_byte <= source_index mod 4;
+    end if;
+  end process;
+
+  palette_select <= '1' when avs_address(FB_SELECT) = '0' and
+                             to_integer(unsigned(avs_address(FB_SELECT - 1 downto 8))) = PALETTE_BASE / 256 else '0';
+  palette_write  <= avs_write and palette_select;
+
+  -- The framebuffer, rle_pos and rle_data wait until a run has been
+  -- painted, and the framebuffer also while the pixel window has it. They
+  -- don't wait for a frame fetch, which is only over when the memory port
+  -- says so: its writes are dropped and framebuffer reads give 0
+  stall <= '1' when (avs_read = '1' or avs_write = '1') and
+                    ((rle_busy = '1' and (avs_address(FB_SELECT) = '1' or
+                                          to_integer(unsigned(avs_address)) = REG_RLE_POS or
+                                          to_integer(unsigned(avs_address)) = REG_RLE_DATA)) or
+                     ((window_read = '1' or window_write = '1') and avs_address(FB_SELECT) = '1')) else '0';
 
-    -- Default: Set all LEDs to full red
-    for i in 0 to LED_COUNT - 1 loop
-      data_array(((i+1) * 24 - 1) downto (i * 24)) <= rgb_all(23 downto 0);
+  waitrequest     <= stall or (avs_read and not read_ack);
+  avs_waitrequest <= waitrequest;
+
+  -- counted when the access completes, so a read waiting a cycle is one
+  perf_counters : process (clk, rst)
+  begin
+    if rst = '1' then
+      perf_bits   <= (others => '0');
+      perf_reads  <= (others => '0');
+      perf_writes <= (others => '0');
+      perf_stalls <= (others => '0');
+    elsif rising_edge(clk) then
+      if pixel_taken = '1' then
+        perf_bits <= perf_bits + 24;
+      end if;
+      if avs_read = '1' and waitrequest = '0' then
+        perf_reads <= perf_reads + 1;
+      end if;
+      if avs_write = '1' and waitrequest = '0' then
+        perf_writes <= perf_writes + 1;
+      end if;
+      if stall = '1' then
+        perf_stalls <= perf_stalls + 1;
+      end if;
+    end if;
+  end process;
+
+  -- reads take one wait cycle, so the registered read data is ready
+  read_wait : process (clk, rst)
+  begin
+    if rst = '1' then
+      read_ack <= '0';
+    elsif rising_edge(clk) then
+      read_ack <= avs_read and not read_ack and not stall;
+    end if;
+  end process;
+
+  -- the channel and led of rle_pos
+  rle_split : process (rle_pos)
+    variable channel : natural range 0 to CHANNELS - 1;
+  begin
+    channel := 0;
+    for c in 1 to CHANNELS - 1 loop
+      if rle_pos >= c * LED_COUNT then
+        channel := c;
+      end if;
     end loop;
+    rle_channel <= channel;
+    if rle_pos - channel * LED_COUNT < LED_COUNT then
+      rle_led <= rle_pos - channel * LED_COUNT;
+    else
+      rle_led <= 0;
+    end if;
+  end process;
+
+  rle_decoder : process (clk, rst)
+  begin
+    if rst = '1' then
+      rle_pos    <= 0;
+      rle_left   <= 0;
+      rle_colour <= (others => '0');
+      rle_busy   <= '0';
+    elsif rising_edge(clk) then
+      if rle_busy = '1' then
+        -- the led at rle_pos is being written this clock
+        rle_pos <= rle_pos + 1;
+        if rle_left = 0 or rle_pos = TOTAL_LEDS - 1 then
+          rle_busy <= '0';
+        else
+          rle_left <= rle_left - 1;
+        end if;
+      elsif fetch_busy = '0' and avs_write = '1' and to_integer(unsigned(avs_address)) = REG_RLE_POS then
+        if unsigned(avs_writedata) < TOTAL_LEDS then
+          rle_pos <= to_integer(unsigned(avs_writedata));
+        else
+          rle_pos <= TOTAL_LEDS;
+        end if;
+      elsif fetch_busy = '0' and avs_write = '1' and to_integer(unsigned(avs_address)) = REG_RLE_DATA then
+        rle_left   <= to_integer(unsigned(avs_writedata(31 downto 24)));
+        rle_colour <= avs_writedata(23 downto 0);
+        if rle_pos < TOTAL_LEDS then
+          rle_busy <= '1';
+        end if;
+      end if;
+    end if;
+  end process;
+
+  fb_a_addr <= not front_page & to_unsigned(rle_led, FB_ADDR_WIDTH) when rle_busy = '1' else
+               not front_page & fetch_word when fetch_busy = '1' else
+               not front_page & window_word when window_read = '1' or window_write = '1' else
+               unsigned(not front_page & avs_address(FB_ADDR_WIDTH - 1 downto 0));
+  fb_wdata  <= x"00" & rle_colour when rle_busy = '1' else
+               fetch_wdata when fetch_busy = '1' else
+               window_wdata when window_write = '1' else
+               avs_writedata;
+
+  -- a channel's leds take a quarter of a word each in indexed mode, and
+  -- two words each in deep mode
+  window_row <= (LED_COUNT + 3) / 4 when ctrl(CTRL_INDEXED) = '1' else
+                2 * LED_COUNT when ctrl(CTRL_DEEP) = '1' else
+                LED_COUNT;
+
+  -- the decoder and the frame fetch have the framebuffer first
+  window_busy <= rle_busy or fetch_busy;
+
+  WINDOW : pixel_window
+  generic map(
+    CHANNELS      => CHANNELS,
+    FB_ADDR_WIDTH => FB_ADDR_WIDTH,
+    BURST_WIDTH   => 8
+  )
+  port map
+  (
+    clk           => clk,
+    rst           => rst,
+    read          => avp_read,
+    write         => avp_write,
+    address       => avp_address,
+    burstcount    => avp_burstcount,
+    writedata     => avp_writedata,
+    byteenable    => avp_byteenable,
+    readdata      => avp_readdata,
+    readdatavalid => avp_readdatavalid,
+    waitrequest   => avp_waitrequest,
+    row           => window_row,
+    busy          => window_busy,
+    fb_read       => window_read,
+    fb_write      => window_write,
+    fb_channel    => window_channel,
+    fb_word       => window_word,
+    fb_wdata      => window_wdata,
+    fb_rdata      => window_rdata
+  );
+
+  fetch_start <= avs_write when to_integer(unsigned(avs_address)) = REG_DMA_ADDR else '0';
+  fetch_abort <= avs_write when to_integer(unsigned(avs_address)) = REG_DMA_STATUS else '0';
+
+  -- a fetch waits for a run being painted, and runs written while a fetch
+  -- is on are dropped
+  FETCH : frame_fetch
+  generic map(
+    CHANNELS      => CHANNELS,
+    FB_ADDR_WIDTH => FB_ADDR_WIDTH,
+    BURST_WIDTH   => 5,
+    TIMEOUT       => FETCH_TIMEOUT
+  )
+  port map
+  (
+    clk           => clk,
+    rst           => rst,
+    start         => fetch_start,
+    abort         => fetch_abort,
+    base          => avs_writedata,
+    row           => window_row,
+    hold          => rle_busy,
+    busy          => fetch_busy,
+    done          => fetch_done,
+    failed        => fetch_error,
+    address       => avm_address,
+    read          => avm_read,
+    burstcount    => avm_burstcount,
+    readdata      => avm_readdata,
+    readdatavalid => avm_readdatavalid,
+    waitrequest   => avm_waitrequest,
+    fb_write      => fetch_write,
+    fb_channel    => fetch_channel,
+    fb_word       => fetch_word,
+    fb_wdata      => fetch_wdata
+  );
+
+  CHANNEL : for c in 0 to CHANNELS - 1 generate
+    signal fb_write  : std_logic;
+    signal index     : unsigned(7 downto 0);
+    signal deep_high : std_logic_vector(31 downto 0) := (others => '0');
+    signal deep_low  : std_logic_vector(15 downto 0) := (others => '0');
+  begin
+
+    -- Two pages of one 32-bit word per LED in M10K; the bus uses port a on
+    -- the back page, the driver port b on the front page
+    FRAMEBUFFER : pixel_ram
+    generic map(
+      ADDR_WIDTH => FB_ADDR_WIDTH + 1,
+      DATA_WIDTH => 32
+    )
+    port map
+    (
+      clk     => clk,
+      a_addr  => fb_a_addr,
+      a_write => fb_write,
+      a_wdata => fb_wdata,
+      a_rdata => fb_rdata(c),
+      b_addr  => fb_address,
+      b_rdata => fb_word(c)
+    );
+
+    fb_write <= '1' when rle_busy = '1' and rle_channel = c else
+                '1' when fetch_write = '1' and fetch_channel = c else
+                '1' when window_busy = '0' and window_write = '1' and window_channel = c else
+                avs_write and avs_address(FB_SELECT) when window_busy = '0' and window_read = '0' and
+                                                          window_write = '0' and fb_channel = c else
+                '0';
+
+    window_rdata(32 * c + 31 downto 32 * c) <= fb_rdata(c);
+
+    with index_byte select index <=
+      unsigned(fb_word(c)(7 downto 0))   when 0,
+      unsigned(fb_word(c)(15 downto 8))  when 1,
+      unsigned(fb_word(c)(23 downto 16)) when 2,
+      unsigned(fb_word(c)(31 downto 24)) when others;
+
+    -- 256 colours; changes show from the next led sent
+    PALETTE : pixel_ram
+    generic map(
+      ADDR_WIDTH => 8,
+      DATA_WIDTH => 24
+    )
+    port map
+    (
+      clk     => clk,
+      a_addr  => unsigned(avs_address(7 downto 0)),
+      a_write => palette_write,
+      a_wdata => avs_writedata(23 downto 0),
+      a_rdata => palette_rdata(c),
+      b_addr  => index,
+      b_rdata => fb_pixel(c)
+    );
+
+    -- Without the framebuffer, every led shows rgb_all except the one at
+    -- strip_index, which counts along the channels one after the other;
+    -- registered so it lines up with the framebuffer read
+    legacy_pixel_source : process (clk)
+    begin
+      if rising_edge(clk) then
+        if unsigned(strip_index_shown) = to_unsigned(c * LED_COUNT + source_index, 32) then
+          legacy_pixel(c) <= rgb_single_shown(23 downto 0);
+        else
+          legacy_pixel(c) <= rgb_all_shown(23 downto 0);
+        end if;
+      end if;
+    end process;
 
-    -- Set specific LED with a different color
-    if strip_index_int < LED_COUNT then
-      data_array(((strip_index_int+1) * 24 - 1) downto (strip_index_int * 24)) <= rgb_single(23 downto 0);
+    deep_words : process (clk)
+    begin
+      if rising_edge(clk) then
+        if deep_phase_read = '0' then
+          deep_high <= fb_word(c);
+        else
+          deep_low <= fb_word(c)(15 downto 0);
+        end if;
+      end if;
+    end process;
+
+    -- sprites are drawn over segments, segments over the pattern, and the
+    -- pattern over both the framebuffer and the legacy registers
+    layer_colour(24 * c + 23 downto 24 * c) <= sprite_color(24 * c + 23 downto 24 * c) when sprite_hit(c) = '1' else
+                                               segment_color(24 * c + 23 downto 24 * c) when segment_hit(c) = '1' else
+                                               pattern_colour when pattern_shown /= 0 else
+                                               stream_colour(24 * c + 23 downto 24 * c) when ctrl_shown(CTRL_STREAM) = '1' else
+                                               fb_pixel(c) when ctrl_shown(CTRL_FRAMEBUFFER) = '1' and ctrl_shown(CTRL_INDEXED) = '1' else
+                                               fb_word(c)(23 downto 0) when ctrl_shown(CTRL_FRAMEBUFFER) = '1' else
+                                               legacy_pixel(c);
+
+    deep_shown(c) <= '1' when sprite_hit(c) = '0' and segment_hit(c) = '0' and pattern_shown = 0 and
+                              ctrl_shown(CTRL_STREAM) = '0' and ctrl_shown(CTRL_FRAMEBUFFER) = '1' and ctrl_shown(CTRL_INDEXED) = '0' and
+                              ctrl_shown(CTRL_DEEP) = '1' else '0';
+
+    -- rainbow and plasma patterns are converted whether or not HSV mode is on
+    rgb_colour(24 * c + 23 downto 24 * c) <= hsv_colour(24 * c + 23 downto 24 * c) when ctrl_shown(CTRL_HSV) = '1' else
+                                             hsv_colour(24 * c + 23 downto 24 * c) when sprite_hit(c) = '0' and segment_hit(c) = '0' and
+                                                                                        pattern_shown /= 0 and pattern_hsv = '1' else
+                                             layer_colour(24 * c + 23 downto 24 * c);
+
+    -- 16-bit framebuffer colours are always red, green and blue
+    layer_pixel(48 * c + 47 downto 48 * c) <= deep_high & deep_low when deep_shown(c) = '1' else
+                                              deepen(rgb_colour(24 * c + 23 downto 24 * c));
+
+  end generate;
+
+  -- In HSV mode every 8-bit colour is converted before the colour stage,
+  -- four clocks more of the pixel time
+  HSV_STAGE : hsv_to_rgb
+  generic map(
+    CHANNELS => CHANNELS
+  )
+  port map
+  (
+    clk        => clk,
+    hue_offset => hue_offset_shown,
+    hsv_in     => layer_colour,
+    rgb_out    => hsv_colour
+  );
+
+  gamma_select <= '1' when avs_address(FB_SELECT) = '0' and
+                           to_integer(unsigned(avs_address(FB_SELECT - 1 downto 8))) = GAMMA_BASE / 256 else '0';
+  gamma_write  <= avs_write and gamma_select;
+
+  -- brightness, gamma and dithering apply to everything shown, sprites
+  -- included; a few more clocks of the pixel time the driver waits
+  COLOUR_STAGE : colour_correction
+  generic map(
+    CHANNELS => CHANNELS
+  )
+  port map
+  (
+    clk        => clk,
+    write      => gamma_write,
+    address    => unsigned(avs_address(7 downto 0)),
+    writedata  => avs_writedata,
+    readdata   => gamma_readdata,
+    gamma      => ctrl_shown(CTRL_GAMMA),
+    brightness => brightness_shown,
+    pixel_in   => layer_pixel,
+    pixel_out  => corrected
+  );
+
+  DITHER_STAGE : temporal_dither
+  generic map(
+    LED_COUNT => LED_COUNT,
+    CHANNELS  => CHANNELS
+  )
+  port map
+  (
+    clk         => clk,
+    enable      => ctrl_shown(CTRL_DITHER),
+    pixel_index => pixel_index,
+    pixel_taken => pixel_taken,
+    pixel_in    => corrected,
+    pixel_out   => pixel_data
+  );
+
+  -- The driver has sent the last pixel and is holding the line low, so the
+  -- next frame (and new timings) can be switched in without tearing
+  frame_latch : process (clk, rst)
+  begin
+    if rst = '1' then
+      rgb_all_shown     <= (others => '0');
+      rgb_single_shown  <= (others => '0');
+      strip_index_shown <= (others => '0');
+      ctrl_shown        <= (others => '0');
+      t0h_shown         <= to_unsigned(T0H_RESET, 16);
+      t0l_shown         <= to_unsigned(T0L_RESET, 16);
+      t1h_shown         <= to_unsigned(T1H_RESET, 16);
+      t1l_shown         <= to_unsigned(T1L_RESET, 16);
+      latch_shown       <= to_unsigned(LATCH_RESET, 16);
+      pixel_count       <= LED_COUNT;
+      rotate_shown      <= 0;
+      brightness_shown  <= 256;
+      hue_offset_shown  <= (others => '0');
+      pattern_shown        <= 0;
+      pattern_speed_shown  <= (others => '0');
+      pattern_scale_shown  <= (others => '0');
+      pattern_color_shown  <= (others => '0');
+      pattern_color2_shown <= (others => '0');
+    elsif rising_edge(clk) and frame_switch = '1' then
+      rgb_all_shown     <= rgb_all;
+      rgb_single_shown  <= rgb_single;
+      strip_index_shown <= strip_index;
+      ctrl_shown        <= ctrl;
+      t0h_shown         <= t0h;
+      t0l_shown         <= t0l;
+      t1h_shown         <= t1h;
+      t1l_shown         <= t1l;
+      latch_shown       <= latch;
+      rotate_shown      <= rotate;
+      brightness_shown  <= brightness;
+      hue_offset_shown  <= hue_offset;
+      pattern_shown        <= pattern;
+      pattern_speed_shown  <= pattern_speed;
+      pattern_scale_shown  <= pattern_scale;
+      pattern_color_shown  <= pattern_color;
+      pattern_color2_shown <= pattern_color2;
+      -- stopping early is fine; leds past the end keep their last colour
+      if unsigned(active_count) = 0 or unsigned(active_count) > LED_COUNT then
+        pixel_count     <= LED_COUNT;
+      else
+        pixel_count     <= to_integer(unsigned(active_count));
+      end if;
     end if;
   end process;
 
+  -- A write of 1 to commit flips the pages at the end of the current frame.
+  -- A commit on the same clock edge as the end of a frame waits for the next.
+  page_flip : process (clk, rst)
+  begin
+    if rst = '1' then
+      front_page  <= '0';
+      commit      <= '0';
+      frame_count <= (others => '0');
+    elsif rising_edge(clk) then
+      if frame_done = '1' then
+        frame_count <= frame_count + 1;
+      end if;
+      if frame_switch = '1' and commit = '1' then
+        front_page <= not front_page;
+      end if;
+
+      if avs_write = '1' and to_integer(unsigned(avs_address)) = REG_COMMIT and avs_writedata(0) = '1' then
+        commit <= '1';
+      elsif fetch_done = '1' and dma_addr(DMA_COMMIT) = '1' then
+        commit <= '1';
+      elsif frame_switch = '1' then
+        commit <= '0';
+      end if;
+    end if;
+  end process;
+
+  frame_switch <= frame_done or frame_load;
+  -- rotation, dithering, patterns and sprites stepped in frames only go on
+  -- while frames are sent, so they keep asking for them, and so does a
+  -- stream, which never waits
+  frame_wanted <= '1' when dirty = '1' or waiting = '1' or sprite_paced = '1' or
+                           ctrl_shown(CTRL_DITHER) = '1' or ctrl_shown(CTRL_STREAM) = '1' or
+                           unsigned(rotate_step(15 downto 0)) /= 0 or
+                           (pattern_shown /= 0 and pattern_speed_shown /= 0) else '0';
+  changed      <= refresh_write or sprite_moved or fetch_done;
+
+  -- Writes to the back page, the run registers and dma_addr only show
+  -- after a commit, and the interrupt and counter registers don't show
+  -- at all
+  refresh_write <= avs_write when avs_address(FB_SELECT) = '0' and
+                                  to_integer(unsigned(avs_address)) /= REG_IRQ_CTRL and
+                                  to_integer(unsigned(avs_address)) /= REG_RLE_POS and
+                                  to_integer(unsigned(avs_address)) /= REG_RLE_DATA and
+                                  to_integer(unsigned(avs_address)) /= REG_LATENCY_MAX and
+                                  to_integer(unsigned(avs_address)) /= REG_STREAM_UNDERFLOW and
+                                  to_integer(unsigned(avs_address)) /= REG_STREAM_BACKPRESSURE and
+                                  to_integer(unsigned(avs_address)) /= REG_DMA_ADDR and
+                                  to_integer(unsigned(avs_address)) /= REG_DMA_STATUS else '0';
+
+  -- With on-demand refresh, dirty or waiting asks the driver for a frame.
+  -- A write on the same clock edge as frame_switch misses the copy, so it
+  -- stays dirty for the frame after.
+  refresh_latency : process (clk, rst)
+  begin
+    if rst = '1' then
+      dirty       <= '0';
+      waiting     <= '0';
+      dirty_count <= (others => '0');
+      wait_count  <= (others => '0');
+      latency     <= (others => '0');
+      latency_max <= (others => '0');
+    elsif rising_edge(clk) then
+      dirty_count <= dirty_count + 1;
+      wait_count  <= wait_count + 1;
+
+      -- only the oldest change waiting is timed
+      if frame_switch = '1' and dirty = '1' and waiting = '0' then
+        waiting    <= '1';
+        wait_count <= dirty_count + 1;
+      elsif frame_start = '1' and waiting = '1' then
+        waiting <= '0';
+        latency <= wait_count + 1;
+        if wait_count + 1 > latency_max then
+          latency_max <= wait_count + 1;
+        end if;
+      end if;
+
+      if changed = '1' then
+        dirty <= '1';
+        if dirty = '0' or frame_switch = '1' then
+          dirty_count <= (others => '0');
+        end if;
+      elsif frame_switch = '1' then
+        dirty <= '0';
+      end if;
+
+      if avs_write = '1' and to_integer(unsigned(avs_address)) = REG_LATENCY_MAX then
+        latency_max <= (others => '0');
+      end if;
+    end if;
+  end process;
+
+  -- rotate steps by one led every rotate_step frames, so a whole pattern
+  -- scrolls without any bus traffic. Writing either register restarts the
+  -- count; a write on the same clock edge as a step wins.
+  rotation : process (clk, rst)
+  begin
+    if rst = '1' then
+      rotate         <= 0;
+      rotate_step    <= (others => '0');
+      rotate_elapsed <= (others => '0');
+    elsif rising_edge(clk) then
+      if frame_done = '1' and unsigned(rotate_step(15 downto 0)) /= 0 then
+        if rotate_elapsed >= unsigned(rotate_step(15 downto 0)) - 1 then
+          rotate_elapsed <= (others => '0');
+          if rotate_step(ROTATE_REVERSE) = '1' then
+            if rotate = 0 then
+              rotate <= LED_COUNT - 1;
+            else
+              rotate <= rotate - 1;
+            end if;
+          elsif rotate = LED_COUNT - 1 then
+            rotate <= 0;
+          else
+            rotate <= rotate + 1;
+          end if;
+        else
+          rotate_elapsed <= rotate_elapsed + 1;
+        end if;
+      end if;
+
+      if avs_write = '1' and to_integer(unsigned(avs_address)) = REG_ROTATE then
+        -- offsets past the end of the strip start at 0
+        if unsigned(avs_writedata) < LED_COUNT then
+          rotate <= to_integer(unsigned(avs_writedata));
+        else
+          rotate <= 0;
+        end if;
+        rotate_elapsed <= (others => '0');
+      end if;
+      if avs_write = '1' and to_integer(unsigned(avs_address)) = REG_ROTATE_STEP then
+        rotate_step    <= avs_writedata(31) & "000000000000000" & avs_writedata(15 downto 0);
+        rotate_elapsed <= (others => '0');
+      end if;
+    end if;
+  end process;
+
+  -- the end of a frame sets the pending bit; a write of 1 to bit 1 clears it.
+  -- a frame ending on the same clock edge as the clear wins.
+  interrupt_control : process (clk, rst)
+  begin
+    if rst = '1' then
+      irq_enable  <= '0';
+      irq_pending <= '0';
+    elsif rising_edge(clk) then
+      if avs_write = '1' and to_integer(unsigned(avs_address)) = REG_IRQ_CTRL then
+        irq_enable <= avs_writedata(0);
+      end if;
+
+      if frame_done = '1' then
+        irq_pending <= '1';
+      elsif avs_write = '1' and to_integer(unsigned(avs_address)) = REG_IRQ_CTRL and avs_writedata(1) = '1' then
+        irq_pending <= '0';
+      end if;
+    end if;
+  end process;
+
+  irq <= irq_pending and irq_enable;
+
   -- Process to read the register from the avalon bus
   avalon_register_read : process (clk)
   begin
     if rising_edge(clk) and avs_read = '1' then
-      case avs_address is
-        when "00" => avs_readdata   <= rgb_single;
-        when "01" => avs_readdata   <= rgb_all;
-        when "10" => avs_readdata   <= strip_index;
-        when others => avs_readdata <= (others => '0');
+      fb_read <= avs_address(FB_SELECT);
+      fb_read_lost <= fetch_busy;
+      palette_read <= palette_select;
+      gamma_read <= gamma_select;
+      fb_read_channel <= fb_channel;
+      case to_integer(unsigned(avs_address)) is
+        when REG_RGB_SINGLE  => reg_readdata <= rgb_single;
+        when REG_RGB_ALL     => reg_readdata <= rgb_all;
+        when REG_STRIP_INDEX => reg_readdata <= strip_index;
+        when REG_CTRL        => reg_readdata <= ctrl;
+        when REG_LED_COUNT   => reg_readdata <= std_logic_vector(to_unsigned(LED_COUNT, 32));
+        when REG_COMMIT      => reg_readdata <= (1 => front_page, 0 => commit, others => '0');
+        when REG_IRQ_CTRL    => reg_readdata <= (1 => irq_pending, 0 => irq_enable, others => '0');
+        when REG_FRAME_COUNT => reg_readdata <= std_logic_vector(frame_count);
+        when REG_T0H         => reg_readdata <= x"0000" & std_logic_vector(t0h);
+        when REG_T0L         => reg_readdata <= x"0000" & std_logic_vector(t0l);
+        when REG_T1H         => reg_readdata <= x"0000" & std_logic_vector(t1h);
+        when REG_T1L         => reg_readdata <= x"0000" & std_logic_vector(t1l);
+        when REG_LATCH       => reg_readdata <= x"0000" & std_logic_vector(latch);
+        when REG_ACTIVE      => reg_readdata <= active_count;
+        when REG_CHANNELS    => reg_readdata <= std_logic_vector(to_unsigned(CHANNELS, 32));
+        when REG_STRIDE      => reg_readdata <= std_logic_vector(to_unsigned(2**FB_ADDR_WIDTH, 32));
+        when REG_SPRITES     => reg_readdata <= std_logic_vector(to_unsigned(SPRITES, 32));
+        when REG_ROTATE      => reg_readdata <= std_logic_vector(to_unsigned(rotate, 32));
+        when REG_ROTATE_STEP => reg_readdata <= rotate_step;
+        when REG_SEGMENTS    => reg_readdata <= std_logic_vector(to_unsigned(SEGMENTS, 32));
+        when REG_RLE_POS     => reg_readdata <= std_logic_vector(to_unsigned(rle_pos, 32));
+        when REG_BRIGHTNESS  => reg_readdata <= std_logic_vector(to_unsigned(brightness, 32));
+        when REG_LATENCY     => reg_readdata <= std_logic_vector(latency);
+        when REG_LATENCY_MAX => reg_readdata <= std_logic_vector(latency_max);
+        when REG_HUE_OFFSET  => reg_readdata <= x"000000" & std_logic_vector(hue_offset);
+        when REG_PATTERN        => reg_readdata <= std_logic_vector(to_unsigned(pattern, 32));
+        when REG_PATTERN_SPEED  => reg_readdata <= std_logic_vector(resize(pattern_speed, 32));
+        when REG_PATTERN_SCALE  => reg_readdata <= x"0000" & std_logic_vector(pattern_scale);
+        when REG_PATTERN_COLOR  => reg_readdata <= x"00" & pattern_color;
+        when REG_PATTERN_COLOR2 => reg_readdata <= x"00" & pattern_color2;
+        when REG_STREAM_UNDERFLOW    => reg_readdata <= std_logic_vector(stream_underflow);
+        when REG_STREAM_BACKPRESSURE => reg_readdata <= std_logic_vector(stream_backpressure);
+        when REG_STREAM_LEVEL        => reg_readdata <= std_logic_vector(resize(stream_level, 32));
+        when REG_DMA_ADDR    => reg_readdata <= dma_addr;
+        when REG_DMA_STATUS  => reg_readdata <= (1 => fetch_error, 0 => fetch_busy, others => '0');
+        when REG_PERF_BITS   => reg_readdata <= std_logic_vector(perf_bits);
+        when REG_PERF_READS  => reg_readdata <= std_logic_vector(perf_reads);
+        when REG_PERF_WRITES => reg_readdata <= std_logic_vector(perf_writes);
+        when REG_PERF_STALLS => reg_readdata <= std_logic_vector(perf_stalls);
+        when SPRITE_BASE to SPRITE_BASE + 4 * SPRITES - 1 => reg_readdata <= sprite_readdata;
+        when SEGMENT_BASE to SEGMENT_BASE + 4 * SEGMENTS - 1 => reg_readdata <= segment_readdata;
+        when others => reg_readdata <= (others => '0');
       end case;
     end if;
   end process;
-  
+
+  -- the framebuffer's, palette's and gamma table's registered outputs are
+  -- valid in the same cycle as reg_readdata; banks past the last channel,
+  -- and the framebuffer while a fetch has it, read as 0
+  avs_readdata <= fb_rdata(fb_read_channel) when fb_read = '1' and fb_read_lost = '0' and
+                                                 fb_read_channel < CHANNELS else
+                  (others => '0') when fb_read = '1' else
+                  x"00" & palette_rdata(0) when palette_read = '1' else
+                  gamma_readdata when gamma_read = '1' else
+                  reg_readdata;
+
   -- Process to write to registers on avalon bus
   avalon_register_write : process (clk, rst)
   begin
@@ -112,14 +1469,68 @@ begin
       rgb_single  <= (others => '0');
       rgb_all     <= (others => '0');
       strip_index <= (others => '0');
+      ctrl        <= (others => '0');
+      t0h         <= to_unsigned(T0H_RESET, 16);
+      t0l         <= to_unsigned(T0L_RESET, 16);
+      t1h         <= to_unsigned(T1H_RESET, 16);
+      t1l         <= to_unsigned(T1L_RESET, 16);
+      latch       <= to_unsigned(LATCH_RESET, 16);
+      active_count <= (others => '0');
+      brightness  <= 256;
+      hue_offset  <= (others => '0');
+      pattern        <= 0;
+      pattern_speed  <= (others => '0');
+      pattern_scale  <= (others => '0');
+      pattern_color  <= (others => '0');
+      pattern_color2 <= (others => '0');
+      dma_addr       <= (others => '0');
     elsif rising_edge(clk) and avs_write = '1' then
-      case avs_address is
-        when "00"   => rgb_single  <= avs_writedata(31 downto 0);
-        when "01"   => rgb_all     <= avs_writedata(31 downto 0);
-        when "10"   => strip_index <= avs_writedata(31 downto 0);
+      case to_integer(unsigned(avs_address)) is
+        when REG_RGB_SINGLE  => rgb_single  <= avs_writedata(31 downto 0);
+        when REG_RGB_ALL     => rgb_all     <= avs_writedata(31 downto 0);
+        when REG_STRIP_INDEX => strip_index <= avs_writedata(31 downto 0);
+        -- deep mode needs the room DEEP_COLOUR makes in the framebuffer
+        when REG_CTRL        =>
+          ctrl <= avs_writedata(31 downto 0);
+          if DEEP_COLOUR = 0 then
+            ctrl(CTRL_DEEP) <= '0';
+          end if;
+        when REG_T0H         => t0h         <= unsigned(avs_writedata(15 downto 0));
+        when REG_T0L         => t0l         <= unsigned(avs_writedata(15 downto 0));
+        when REG_T1H         => t1h         <= unsigned(avs_writedata(15 downto 0));
+        when REG_T1L         => t1l         <= unsigned(avs_writedata(15 downto 0));
+        when REG_LATCH       => latch       <= unsigned(avs_writedata(15 downto 0));
+        when REG_ACTIVE      => active_count <= avs_writedata(31 downto 0);
+        -- values past 256 are full brightness
+        when REG_BRIGHTNESS  =>
+          if unsigned(avs_writedata) < 256 then
+            brightness <= to_integer(unsigned(avs_writedata));
+          else
+            brightness <= 256;
+          end if;
+        when REG_HUE_OFFSET  => hue_offset  <= unsigned(avs_writedata(7 downto 0));
+        when REG_PATTERN        =>
+          if unsigned(avs_writedata) <= PATTERN_LAST then
+            pattern <= to_integer(unsigned(avs_writedata));
+          else
+            pattern <= 0;
+          end if;
+        when REG_PATTERN_SPEED  => pattern_speed  <= signed(avs_writedata(15 downto 0));
+        when REG_PATTERN_SCALE  => pattern_scale  <= unsigned(avs_writedata(15 downto 0));
+        when REG_PATTERN_COLOR  => pattern_color  <= avs_writedata(23 downto 0);
+        when REG_PATTERN_COLOR2 => pattern_color2 <= avs_writedata(23 downto 0);
+        -- a write while a fetch is on its way is ignored, like the fetch
+        when REG_DMA_ADDR    =>
+          if fetch_busy = '0' then
+            dma_addr <= avs_writedata(31 downto 2) & '0' & avs_writedata(DMA_COMMIT);
+          end if;
         when others => null; -- ignore writes to unused registers
       end case;
     end if;
   end process;
 
-end architecture arch;
\ No newline at end of file
+  -- the position of the led that is actually lit: sprite 0 once it is
+  -- shown, the single led of the legacy registers before that
+  strip_index_out <= sprite0_index when sprite0_visible = '1' else strip_index_shown;
+
+end architecture arch;
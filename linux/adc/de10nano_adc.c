@@ -7,6 +7,7 @@
 #include <linux/mutex.h>
 #include <linux/miscdevice.h>
 #include <linux/fs.h>
+#include <linux/mm.h>
 
 // ADC channel register addresses
 static u32 CH0 = 0x0;
@@ -32,6 +33,8 @@ static unsigned long VOLTAGE_SCALE_MV = 1;
 /**
  * struct adc_dev - Private led patterns device struct.
  * @base_addr: Pointer to the component's base address 
+ * @phys_addr: Physical address of the component, used by mmap
+ * @phys_size: Size of the component's memory region
  * @hps_led_control: Pointer to the hps_led_control register 
  * @base_period: Pointer to the base_period register 
  * @led_reg: Pointer to the led_reg register 
@@ -42,6 +45,8 @@ static unsigned long VOLTAGE_SCALE_MV = 1;
  */
 struct adc_dev {
 	void __iomem *base_addr;
+	phys_addr_t phys_addr;
+	resource_size_t phys_size;
 	bool auto_update;
 	struct miscdevice miscdev;
 	struct mutex lock;
@@ -157,6 +162,29 @@ static ssize_t adc_write(struct file *file, const char __user *buf,
 	return ret;
 }
 
+/**
+ * adc_mmap() - Mmap method for the adc char device
+ * @file: Pointer to the char device file struct.
+ * @vma: User-space mapping being created.
+ *
+ * Maps the component's registers into user space so they can be accessed
+ * without a system call per access. The mapping is uncached and covers the
+ * whole page the component lives in. Unlike adc_read(), values read through
+ * the mapping are not masked with ADC_VALUE_BITMASK.
+ *
+ * Return: 0 on success, negative error value otherwise.
+ */
+static int adc_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct adc_dev *priv = container_of(file->private_data,
+	                              struct adc_dev, miscdev);
+
+	vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+
+	// vm_iomap_memory checks the requested size and offset against the region.
+	return vm_iomap_memory(vma, priv->phys_addr, priv->phys_size);
+}
+
 /** 
  *  adc_fops - File operations supported by the  
  *                          adc driver
@@ -167,12 +195,14 @@ static ssize_t adc_write(struct file *file, const char __user *buf,
  * @write: The write function.
  * @llseek: We use the kernel's default_llseek() function; this allows 
  *          users to change what position they are writing/reading to/from.
+ * @mmap: The mmap function.
  */
 static const struct file_operations  adc_fops = {
 	.owner = THIS_MODULE,
 	.read = adc_read,
 	.write = adc_write,
 	.llseek = default_llseek,
+	.mmap = adc_mmap,
 };
 
 /**
@@ -342,6 +372,7 @@ ATTRIBUTE_GROUPS(adc);
 static int adc_probe(struct platform_device *pdev)
 {
 	struct adc_dev *priv;
+	struct resource *res;
 	size_t ret;
 
 	/*
@@ -363,12 +394,16 @@ static int adc_probe(struct platform_device *pdev)
 	 * into the kernel's virtual address space because we don't have access
 	 * to physical memory locations.
 	 */
-	priv->base_addr = devm_platform_ioremap_resource(pdev, 0);
+	priv->base_addr = devm_platform_get_and_ioremap_resource(pdev, 0, &res);
 	if (IS_ERR(priv->base_addr)) {
 		pr_err("Failed to request/remap platform device resource\n");
 		return PTR_ERR(priv->base_addr);
 	}
 
+	// Remember the physical region so mmap can hand it to user space.
+	priv->phys_addr = res->start;
+	priv->phys_size = resource_size(res);
+
 	// Initialize the misc device parameters
 	priv->miscdev.minor = MISC_DYNAMIC_MINOR;
 	priv->miscdev.name = "adc";
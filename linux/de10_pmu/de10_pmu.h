@@ -0,0 +1,266 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef DE10_PMU_H
+#define DE10_PMU_H
+
+/*
+* perf_event PMU over the free-running counters in an FPGA component's
+* registers, shared by the drivers in linux/. A driver describes its
+* counters in a table and registers one PMU named after the component, so
+*
+*     perf stat -a -e de10_ws2811/frames/ -- sleep 10
+*
+* counts next to the CPU's own events. The counters belong to the whole
+* system rather than to a task or a CPU: events are counted on CPU 0 only
+* (the PMU's cpumask) and can't sample. Counters are read when perf reads
+* the event, and a wrap between two reads is taken into account, but not
+* two wraps, so a 32-bit counter of clock cycles at 50 MHz has to be read
+* at least every 85 s (perf stat -I).
+*/
+
+#include <linux/perf_event.h>
+#include <linux/device.h>
+#include <linux/sysfs.h>
+#include <linux/io.h>
+
+/**
+* struct de10_pmu_counter - One counter in a component's registers.
+* @name: Event name, e.g. "frames" for de10_ws2811/frames/.
+* @offset: Byte offset of the register.
+* @shift: Bit the counter starts at in the register.
+* @width: Bits in the counter; it wraps from 2^@width - 1 to 0.
+*/
+struct de10_pmu_counter {
+const char *name;
+u32 offset;
+u8 shift;
+u8 width;
+};
+
+/**
+* struct de10_pmu - A component's PMU.
+* @pmu: The PMU registered with perf.
+* @base: The component's registers.
+* @counters: The counters; event n (config n) is @counters[n].
+* @count: Number of counters.
+* @registered: perf_pmu_register() succeeded.
+* @events_group: The events/ directory, one file per counter.
+* @groups: The PMU's sysfs attribute groups.
+*/
+struct de10_pmu {
+struct pmu pmu;
+void __iomem *base;
+const struct de10_pmu_counter *counters;
+unsigned int count;
+bool registered;
+struct attribute_group events_group;
+const struct attribute_group *groups[4];
+};
+
+#define to_de10_pmu(p) container_of(p, struct de10_pmu, pmu)
+
+static ssize_t de10_pmu_format_show(struct device *dev,
+struct device_attribute *attr, char *buf)
+{
+return sysfs_emit(buf, "config:0-7\n");
+}
+
+static ssize_t de10_pmu_cpumask_show(struct device *dev,
+struct device_attribute *attr, char *buf)
+{
+return sysfs_emit(buf, "0\n");
+}
+
+static struct device_attribute de10_pmu_format_event =
+__ATTR(event, 0444, de10_pmu_format_show, NULL);
+static struct device_attribute de10_pmu_cpumask =
+__ATTR(cpumask, 0444, de10_pmu_cpumask_show, NULL);
+
+static struct attribute *de10_pmu_format_attrs[] = {
+&de10_pmu_format_event.attr,
+NULL,
+};
+
+static struct attribute *de10_pmu_cpumask_attrs[] = {
+&de10_pmu_cpumask.attr,
+NULL,
+};
+
+static const struct attribute_group de10_pmu_format_group = {
+.name = "format",
+.attrs = de10_pmu_format_attrs,
+};
+
+static const struct attribute_group de10_pmu_cpumask_group = {
+.attrs = de10_pmu_cpumask_attrs,
+};
+
+/**
+* de10_pmu_read_counter() - Read an event's counter from the component.
+* @event: The event.
+*
+* Return: The counter's value, 0 to 2^width - 1.
+*/
+static u64 de10_pmu_read_counter(struct perf_event *event)
+{
+struct de10_pmu *p = to_de10_pmu(event->pmu);
+const struct de10_pmu_counter *c = &p->counters[event->hw.idx];
+
+return (ioread32(p->base + c->offset) >> c->shift) & GENMASK_ULL(c->width - 1, 0);
+}
+
+/**
+* de10_pmu_update() - Add what the counter moved on since the last read.
+* @event: The event.
+*/
+static void de10_pmu_update(struct perf_event *event)
+{
+struct de10_pmu *p = to_de10_pmu(event->pmu);
+const struct de10_pmu_counter *c = &p->counters[event->hw.idx];
+u64 prev;
+u64 now;
+
+do {
+prev = local64_read(&event->hw.prev_count);
+now = de10_pmu_read_counter(event);
+} while (local64_cmpxchg(&event->hw.prev_count, prev, now) != prev);
+
+local64_add((now - prev) & GENMASK_ULL(c->width - 1, 0), &event->count);
+}
+
+static int de10_pmu_event_init(struct perf_event *event)
+{
+struct de10_pmu *p = to_de10_pmu(event->pmu);
+
+if (event->attr.type != event->pmu->type) {
+return -ENOENT;
+}
+// system-wide counters: no sampling and no per-task counting
+if (is_sampling_event(event) || (event->attach_state & PERF_ATTACH_TASK) ||
+event->cpu < 0) {
+return -EOPNOTSUPP;
+}
+if (event->attr.config >= p->count) {
+return -EINVAL;
+}
+
+event->cpu = 0;
+event->hw.idx = event->attr.config;
+
+return 0;
+}
+
+static void de10_pmu_start(struct perf_event *event, int flags)
+{
+local64_set(&event->hw.prev_count, de10_pmu_read_counter(event));
+event->hw.state = 0;
+}
+
+static void de10_pmu_stop(struct perf_event *event, int flags)
+{
+if (event->hw.state & PERF_HES_STOPPED) {
+return;
+}
+de10_pmu_update(event);
+event->hw.state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
+}
+
+static int de10_pmu_add(struct perf_event *event, int flags)
+{
+event->hw.state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+if (flags & PERF_EF_START) {
+de10_pmu_start(event, PERF_EF_RELOAD);
+}
+return 0;
+}
+
+static void de10_pmu_del(struct perf_event *event, int flags)
+{
+de10_pmu_stop(event, PERF_EF_UPDATE);
+}
+
+static void de10_pmu_read(struct perf_event *event)
+{
+de10_pmu_update(event);
+}
+
+/**
+* de10_pmu_register() - Register a component's PMU with perf.
+* @p: The PMU, zeroed, in the driver's private data.
+* @dev: The component's device; the sysfs files are allocated against it.
+* @name: PMU name, e.g. "de10_ws2811".
+* @base: The component's registers.
+* @counters: The counters, which must outlive the PMU.
+* @count: Number of counters, up to 256.
+*
+* Return: 0, or a negative error value.
+*/
+static int de10_pmu_register(struct de10_pmu *p, struct device *dev,
+const char *name, void __iomem *base,
+const struct de10_pmu_counter *counters, unsigned int count)
+{
+struct perf_pmu_events_attr *events;
+struct attribute **attrs;
+unsigned int i;
+int ret;
+
+events = devm_kcalloc(dev, count, sizeof(*events), GFP_KERNEL);
+attrs = devm_kcalloc(dev, count + 1, sizeof(*attrs), GFP_KERNEL);
+if (!events || !attrs) {
+return -ENOMEM;
+}
+for (i = 0; i < count; i++) {
+sysfs_attr_init(&events[i].attr.attr);
+events[i].attr.attr.name = counters[i].name;
+events[i].attr.attr.mode = 0444;
+events[i].attr.show = perf_event_sysfs_show;
+events[i].id = i;
+events[i].event_str = devm_kasprintf(dev, GFP_KERNEL, "event=0x%x", i);
+if (!events[i].event_str) {
+return -ENOMEM;
+}
+attrs[i] = &events[i].attr.attr;
+}
+
+p->base = base;
+p->counters = counters;
+p->count = count;
+p->events_group.name = "events";
+p->events_group.attrs = attrs;
+p->groups[0] = &de10_pmu_format_group;
+p->groups[1] = &de10_pmu_cpumask_group;
+p->groups[2] = &p->events_group;
+p->groups[3] = NULL;
+
+p->pmu = (struct pmu) {
+.module = THIS_MODULE,
+.task_ctx_nr = perf_invalid_context,
+.capabilities = PERF_PMU_CAP_NO_EXCLUDE,
+.attr_groups = p->groups,
+.event_init = de10_pmu_event_init,
+.add = de10_pmu_add,
+.del = de10_pmu_del,
+.start = de10_pmu_start,
+.stop = de10_pmu_stop,
+.read = de10_pmu_read,
+};
+
+ret = perf_pmu_register(&p->pmu, name, -1);
+if (ret == 0) {
+p->registered = true;
+}
+return ret;
+}
+
+/**
+* de10_pmu_unregister() - Remove a PMU registered by de10_pmu_register().
+* @p: The PMU; nothing happens if it was never registered.
+*/
+static void de10_pmu_unregister(struct de10_pmu *p)
+{
+if (p->registered) {
+perf_pmu_unregister(&p->pmu);
+p->registered = false;
+}
+}
+
+#endif /* DE10_PMU_H */
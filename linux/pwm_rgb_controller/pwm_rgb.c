@@ -7,34 +7,53 @@
 #include <linux/types.h>            // data types like u32, u16, etc.
 #include <linux/fs.h>               // copy_to_user, etc.
 #include <linux/kstrtox.h>          // kstrtou8, etc.
+#include <linux/mm.h>               // vm_iomap_memory, etc.
+
+#include "../de10_pmu/de10_pmu.h"
 
 #define DUTY_RED_OFFSET 0x0
 #define DUTY_GREEN_OFFSET 0x4
 #define DUTY_BLUE_OFFSET 0x8
 #define BASE_PERIOD_OFFSET 0x12
 
-#define SPAN 16
+// free-running counts of bus reads and writes, for the de10_pwm_rgb PMU
+#define PERF_READS_OFFSET 0x10
+#define PERF_WRITES_OFFSET 0x14
+
+#define SPAN 32
 
 /**
 * struct pwm_rgb_dev - Private rgb pwm controller device struct.
 * @base_addr: Pointer to the component's base address
+* @phys_addr: Physical address of the component, used by mmap
+* @phys_size: Size of the component's memory region
 * @duty_red: Address of the red duty cycle register
 * @duty_green: Address of the green duty cycle register
 * @duty_blue: Address of the blue duty cycle register
 * @base_period: Address of the pwm base period register
 * @miscdev: miscdevice used to create a character device
 * @lock: mutex used to prevent concurrent writes to memory
+* @pmu: The de10_pwm_rgb perf PMU over the component's counters
 *
 * An pwm_rgb_dev struct gets created for each led patterns component.
 */
 struct pwm_rgb_dev {
 void __iomem *base_addr;
+phys_addr_t phys_addr;
+resource_size_t phys_size;
 void __iomem *duty_red;
 void __iomem *duty_green;
 void __iomem *duty_blue;
 void __iomem *base_period;
 struct miscdevice miscdev;
 struct mutex lock;
+struct de10_pmu pmu;
+};
+
+// events of the de10_pwm_rgb PMU, in config order
+static const struct de10_pmu_counter pwm_rgb_counters[] = {
+{ "reads", PERF_READS_OFFSET, 0, 32 },
+{ "writes", PERF_WRITES_OFFSET, 0, 32 },
 };
 
 /**
@@ -375,6 +394,28 @@ mutex_unlock(&priv->lock);
 return ret;
 }
 
+/**
+* pwm_rgb_mmap() - Mmap method for the pwm_rgb char device
+* @file: Pointer to the char device file struct.
+* @vma: User-space mapping being created.
+*
+* Maps the component's registers into user space so they can be accessed
+* without a system call per access. The mapping is uncached and covers the
+* whole page(s) the component lives in.
+*
+* Return: 0 on success, negative error value otherwise.
+*/
+static int pwm_rgb_mmap(struct file *file, struct vm_area_struct *vma)
+{
+struct pwm_rgb_dev *priv = container_of(file->private_data,
+struct pwm_rgb_dev, miscdev);
+
+vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+
+// vm_iomap_memory checks the requested size and offset against the region.
+return vm_iomap_memory(vma, priv->phys_addr, priv->phys_size);
+}
+
 /**
 * pwm_rgb_fops - File operations supported by the
 * pwm_rgb driver
@@ -385,12 +426,14 @@ return ret;
 * @write: The write function.
 * @llseek: We use the kernel's default_llseek() function; this allows
 * users to change what position they are writing/reading to/from.
+* @mmap: The mmap function.
 */
 static const struct file_operations pwm_rgb_fops = {
 .owner = THIS_MODULE,
 .read = pwm_rgb_read,
 .write = pwm_rgb_write,
 .llseek = default_llseek,
+.mmap = pwm_rgb_mmap,
 };
 
 static int pwm_rgb_probe(struct platform_device *pdev)
@@ -399,6 +442,7 @@ static int pwm_rgb_probe(struct platform_device *pdev)
 size_t ret;
 
 struct pwm_rgb_dev *priv;
+struct resource *res;
 /*
 * Allocate kernel memory for the led patterns device and set it to 0.
 * GFP_KERNEL specifies that we are allocating normal kernel RAM;
@@ -417,11 +461,14 @@ return -ENOMEM;
 * into the kernel's virtual address space because we don't have access
 * to physical memory locations.
 */
-priv->base_addr = devm_platform_ioremap_resource(pdev, 0);
+priv->base_addr = devm_platform_get_and_ioremap_resource(pdev, 0, &res);
 if (IS_ERR(priv->base_addr)) {
 pr_err("Failed to request/remap platform device resource\n");
 return PTR_ERR(priv->base_addr);
 }
+// Remember the physical region so mmap can hand it to user space.
+priv->phys_addr = res->start;
+priv->phys_size = resource_size(res);
 // Set the memory addresses for each register.
 priv->duty_red = priv->base_addr + DUTY_RED_OFFSET;
 priv->duty_green = priv->base_addr + DUTY_GREEN_OFFSET;
@@ -451,6 +498,14 @@ return ret;
 * This is so we can access our state container in the other functions.
 */
 platform_set_drvdata(pdev, priv);
+
+// perf is a nice to have, so the device works without it
+ret = de10_pmu_register(&priv->pmu, &pdev->dev, "de10_pwm_rgb", priv->base_addr,
+pwm_rgb_counters, ARRAY_SIZE(pwm_rgb_counters));
+if (ret) {
+pr_warn("Failed to register the de10_pwm_rgb PMU\n");
+}
+
 pr_info("pwm_rgb_probe successful\n");
 return 0;
 }
@@ -471,6 +526,8 @@ iowrite32(0x0, priv->duty_red);
 iowrite32(0x0, priv->duty_green);
 iowrite32(0x0, priv->duty_blue);
 
+de10_pmu_unregister(&priv->pmu);
+
 // Deregister the misc device and remove the /dev/led_patterns file.
 misc_deregister(&priv->miscdev);
 pr_info("pwm_rgb_remove successful\n");
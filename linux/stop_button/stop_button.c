@@ -7,25 +7,112 @@
 #include <linux/types.h>            // data types like u32, u16, etc.
 #include <linux/fs.h>               // copy_to_user, etc.
 #include <linux/kstrtox.h>          // kstrtou8, etc.
+#include <linux/mm.h>               // vm_iomap_memory, etc.
+#include <linux/interrupt.h>        // request_threaded_irq, etc.
+#include <linux/wait.h>             // wait queues
+#include <linux/poll.h>             // poll_table, EPOLLIN, etc.
+#include <linux/ktime.h>            // ktime_get, etc.
+#include <linux/slab.h>             // kzalloc, kfree
+#include <linux/spinlock.h>         // spinlock definitions
+
+#include "stop_button.h"
+#include "../de10_pmu/de10_pmu.h"
 
 #define STOP_BUTTON_OFFSET 0x0
+#define IRQ_CTRL_OFFSET 0x4
+#define STATUS_OFFSET 0x8
+#define HIT_INDEX_OFFSET 0xc
+#define WIN_LO_OFFSET 0x10
+#define WIN_HI_OFFSET 0x14
+
+// irq control register bits
+#define IRQ_ENABLE 0x1
+#define IRQ_PENDING 0x2
+
+// status register bits: latched press and win (write 1 to clear), press count
+#define STATUS_PRESSED 0x1
+#define STATUS_WON 0x2
+#define STATUS_COUNT_SHIFT 16
+
+// free-running counts of bus reads and writes, for the de10_stop_button PMU
+#define PERF_READS_OFFSET 0x18
+#define PERF_WRITES_OFFSET 0x1c
 
-#define SPAN 8
+// press reads like status and clears the latched press and win in the same
+// bus cycle; press_hit is the hit_index that went with the last press read
+#define PRESS_OFFSET 0x20
+#define PRESS_HIT_OFFSET 0x24
+
+#define SPAN 64
 
 /**
 * struct stop_button_dev - Private stop button device struct.
 * @base_addr: Pointer to the component's base address
+* @phys_addr: Physical address of the component, used by mmap
+* @phys_size: Size of the component's memory region
 * @stop_button: Address of the stop button register
+* @irq_ctrl: Address of the interrupt control register
+* @status: Address of the status register
+* @hit_index: Address of the register holding strip_index at the last press
+* @win_lo: Address of the register holding the first winning strip_index
+* @win_hi: Address of the register holding the last winning strip_index
+* @press: Address of the read-to-clear copy of the status register
+* @press_hit: Address of the hit_index latched by the last read of @press
+* @last_count: Press count seen by the last read-and-clear
+* @dev: The platform device's struct device, for sysfs_notify
+* @irq: Interrupt number of the button press interrupt
+* @wait: Wait queue for readers/pollers waiting on a press
+* @event_lock: Spinlock protecting @irq_count, @presses and @press_time
+* @irq_count: Press count seen by the last press interrupt
+* @presses: Number of presses counted by the interrupt handler
+* @press_time: Time at which the last press interrupt was taken
 * @miscdev: miscdevice used to create a character device
 * @lock: mutex used to prevent concurrent writes to memory
+* @pmu: The de10_stop_button perf PMU over the component's counters
 *
 * An stop_button_dev struct gets created for each led patterns component.
 */
 struct stop_button_dev {
 void __iomem *base_addr;
+phys_addr_t phys_addr;
+resource_size_t phys_size;
 void __iomem *stop_button;
+void __iomem *irq_ctrl;
+void __iomem *status;
+void __iomem *hit_index;
+void __iomem *win_lo;
+void __iomem *win_hi;
+void __iomem *press;
+void __iomem *press_hit;
+u16 last_count;
+struct device *dev;
+int irq;
+wait_queue_head_t wait;
+spinlock_t event_lock;
+u16 irq_count;
+u32 presses;
+ktime_t press_time;
 struct miscdevice miscdev;
 struct mutex lock;
+struct de10_pmu pmu;
+};
+
+// events of the de10_stop_button PMU, in config order; presses are the
+// 16-bit count in the top half of the status register
+static const struct de10_pmu_counter stop_button_counters[] = {
+{ "presses", STATUS_OFFSET, STATUS_COUNT_SHIFT, 16 },
+{ "reads", PERF_READS_OFFSET, 0, 32 },
+{ "writes", PERF_WRITES_OFFSET, 0, 32 },
+};
+
+/**
+* struct stop_button_file - Per-open state of the stop_button char device.
+* @priv: The device this file was opened on.
+* @seen: Value of @priv->presses when this file last consumed an event.
+*/
+struct stop_button_file {
+struct stop_button_dev *priv;
+u32 seen;
 };
 
 /**
@@ -81,17 +168,197 @@ iowrite32(stop_button, priv->stop_button);
 return size;
 }
 
+/**
+* hit_index_show() - Return the strip_index captured at the last press
+* to user-space via sysfs.
+* @dev: Device structure for the stop_button_controller component. This
+* device struct is embedded in the stop_button_controller' device struct.
+* @attr: Unused.
+* @buf: Buffer that gets returned to user-space.
+*
+* Return: The number of bytes read.
+*/
+static ssize_t hit_index_show(struct device *dev,
+struct device_attribute *attr, char *buf)
+{
+u32 hit_index;
+struct stop_button_dev *priv = dev_get_drvdata(dev);
+
+hit_index = ioread32(priv->hit_index);
+
+return scnprintf(buf, PAGE_SIZE, "%u\n", hit_index);
+}
+
+/**
+* win_lo_show() - Return the first winning strip_index to user-space via sysfs.
+* @dev: Device structure for the stop_button_controller component.
+* @attr: Unused.
+* @buf: Buffer that gets returned to user-space.
+*
+* Return: The number of bytes read.
+*/
+static ssize_t win_lo_show(struct device *dev,
+struct device_attribute *attr, char *buf)
+{
+u32 win_lo;
+struct stop_button_dev *priv = dev_get_drvdata(dev);
+
+win_lo = ioread32(priv->win_lo);
+
+return scnprintf(buf, PAGE_SIZE, "%u\n", win_lo);
+}
+
+/**
+* win_lo_store() - Store the first winning strip_index.
+* @dev: Device structure for the stop_button_controller component.
+* @attr: Unused.
+* @buf: Buffer that contains the win_lo value being written.
+* @size: The number of bytes being written.
+*
+* Return: The number of bytes stored.
+*/
+static ssize_t win_lo_store(struct device *dev,
+struct device_attribute *attr, const char *buf, size_t size)
+{
+u32 win_lo;
+int ret;
+struct stop_button_dev *priv = dev_get_drvdata(dev);
+
+ret = kstrtouint(buf, 0, &win_lo);
+if (ret < 0) {
+return ret;
+}
+
+iowrite32(win_lo, priv->win_lo);
+
+return size;
+}
+
+/**
+* win_hi_show() - Return the last winning strip_index to user-space via sysfs.
+* @dev: Device structure for the stop_button_controller component.
+* @attr: Unused.
+* @buf: Buffer that gets returned to user-space.
+*
+* Return: The number of bytes read.
+*/
+static ssize_t win_hi_show(struct device *dev,
+struct device_attribute *attr, char *buf)
+{
+u32 win_hi;
+struct stop_button_dev *priv = dev_get_drvdata(dev);
+
+win_hi = ioread32(priv->win_hi);
+
+return scnprintf(buf, PAGE_SIZE, "%u\n", win_hi);
+}
+
+/**
+* win_hi_store() - Store the last winning strip_index.
+* @dev: Device structure for the stop_button_controller component.
+* @attr: Unused.
+* @buf: Buffer that contains the win_hi value being written.
+* @size: The number of bytes being written.
+*
+* Return: The number of bytes stored.
+*/
+static ssize_t win_hi_store(struct device *dev,
+struct device_attribute *attr, const char *buf, size_t size)
+{
+u32 win_hi;
+int ret;
+struct stop_button_dev *priv = dev_get_drvdata(dev);
+
+ret = kstrtouint(buf, 0, &win_hi);
+if (ret < 0) {
+return ret;
+}
+
+iowrite32(win_hi, priv->win_hi);
+
+return size;
+}
+
 // Define sysfs attributes
 static DEVICE_ATTR_RW(stop_button);
+static DEVICE_ATTR_RO(hit_index);
+static DEVICE_ATTR_RW(win_lo);
+static DEVICE_ATTR_RW(win_hi);
 
 // Create an attribute group so the device core can
 // export the attributes for us.
 static struct attribute *stop_button_attrs[] = {
 &dev_attr_stop_button.attr,
+&dev_attr_hit_index.attr,
+&dev_attr_win_lo.attr,
+&dev_attr_win_hi.attr,
 NULL,
 };
 ATTRIBUTE_GROUPS(stop_button);
 
+/**
+* stop_button_event_pending() - Check for a press this file hasn't seen.
+* @sbf: Per-open state of the file.
+*
+* Return: true if a press happened since @sbf last consumed an event.
+*/
+static bool stop_button_event_pending(struct stop_button_file *sbf)
+{
+return READ_ONCE(sbf->priv->presses) != sbf->seen;
+}
+
+/**
+* stop_button_read_event() - Wait for a press and return it to user space.
+* @file: Pointer to the char device file struct.
+* @buf: User-space buffer to copy the struct stop_button_event into.
+* @count: The number of bytes being requested.
+*
+* Blocks until a press this file hasn't seen yet happens, unless the file
+* was opened with O_NONBLOCK. The file offset is not advanced, so repeated
+* reads keep returning events.
+*
+* Return: sizeof(struct stop_button_event) on success, negative error value
+* otherwise.
+*/
+static ssize_t stop_button_read_event(struct file *file, char __user *buf,
+size_t count)
+{
+struct stop_button_file *sbf = file->private_data;
+struct stop_button_dev *priv = sbf->priv;
+struct stop_button_event event = { 0 };
+unsigned long flags;
+int ret;
+
+if (count < sizeof(event)) {
+return -EINVAL;
+}
+
+if (!stop_button_event_pending(sbf)) {
+if (file->f_flags & O_NONBLOCK) {
+return -EAGAIN;
+}
+ret = wait_event_interruptible(priv->wait,
+stop_button_event_pending(sbf));
+if (ret) {
+return ret;
+}
+}
+
+// Take a consistent snapshot of the press count and its timestamp.
+spin_lock_irqsave(&priv->event_lock, flags);
+event.presses = priv->presses;
+event.timestamp_ns = ktime_to_ns(priv->press_time);
+spin_unlock_irqrestore(&priv->event_lock, flags);
+
+sbf->seen = event.presses;
+
+if (copy_to_user(buf, &event, sizeof(event))) {
+return -EFAULT;
+}
+
+return sizeof(event);
+}
+
 /**
 * stop_button_read() - Read method for the stop_button char device
 * @file: Pointer to the char device file struct.
@@ -99,6 +366,9 @@ ATTRIBUTE_GROUPS(stop_button);
 * @count: The number of bytes being requested.
 * @offset: The byte offset in the file being read from.
 *
+* Reading from STOP_BUTTON_EVENT_OFFSET waits for a press; see
+* stop_button_read_event().
+*
 * Return: On success, the number of bytes written is returned and the
 * offset @offset is advanced by this number. On error, a negative error
 * value is returned.
@@ -110,13 +380,16 @@ size_t ret;
 u32 val;
 
 /*
-* Get the device's private data from the file struct's private_data
-* field. The private_data field is equal to the miscdev field in the
-* stop_button_dev struct. container_of returns the
-* stop_button_dev struct that contains the miscdev in private_data.
+* Get the device's private data from the per-open state that
+* stop_button_open() stored in the file struct's private_data field.
 */
-struct stop_button_dev *priv = container_of(file->private_data,
-struct stop_button_dev, miscdev);
+struct stop_button_file *sbf = file->private_data;
+struct stop_button_dev *priv = sbf->priv;
+
+// Reads from the event offset wait for a press instead of reading a register.
+if (*offset == STOP_BUTTON_EVENT_OFFSET) {
+return stop_button_read_event(file, buf, count);
+}
 
 // Check file offset to make sure we are reading from a valid location.
 if (*offset < 0) {
@@ -165,8 +438,8 @@ size_t count, loff_t *offset)
 size_t ret;
 u32 val;
 
-struct stop_button_dev *priv = container_of(file->private_data,
-struct stop_button_dev, miscdev);
+struct stop_button_file *sbf = file->private_data;
+struct stop_button_dev *priv = sbf->priv;
 
 if (*offset < 0) {
 return -EINVAL;
@@ -201,6 +474,154 @@ mutex_unlock(&priv->lock);
 return ret;
 }
 
+/**
+* stop_button_poll() - Poll method for the stop_button char device
+* @file: Pointer to the char device file struct.
+* @wait: Poll table to register our wait queue with.
+*
+* Return: EPOLLIN | EPOLLRDNORM if a press this file hasn't seen is pending.
+*/
+static __poll_t stop_button_poll(struct file *file, poll_table *wait)
+{
+struct stop_button_file *sbf = file->private_data;
+
+poll_wait(file, &sbf->priv->wait, wait);
+
+if (stop_button_event_pending(sbf)) {
+return EPOLLIN | EPOLLRDNORM;
+}
+return 0;
+}
+
+/**
+* stop_button_read_clear() - Read and clear the latched press state.
+* @priv: The stop button device.
+* @state: Filled in with the press state.
+*
+* The press register returns the status and clears the latched bits in the
+* same bus cycle, and latches the hit_index that goes with it into
+* press_hit, so the won bit and the hit index always belong to the presses
+* counted here. A press landing after the read is reported whole by the
+* next call. Whether the button was pressed is decided from the press
+* counter, which also gives the number of presses.
+*/
+static void stop_button_read_clear(struct stop_button_dev *priv,
+struct stop_button_state *state)
+{
+u32 status;
+u16 count;
+
+mutex_lock(&priv->lock);
+
+status = ioread32(priv->press);
+state->hit_index = ioread32(priv->press_hit);
+
+count = status >> STATUS_COUNT_SHIFT;
+state->count = count;
+state->won = !!(status & STATUS_WON);
+// u16 arithmetic handles the counter wrapping
+state->presses = (u16)(count - priv->last_count);
+state->pressed = state->presses != 0;
+priv->last_count = count;
+
+mutex_unlock(&priv->lock);
+}
+
+/**
+* stop_button_ioctl() - Ioctl method for the stop_button char device
+* @file: Pointer to the char device file struct.
+* @cmd: The ioctl command; only STOP_BUTTON_IOC_READ_CLEAR is supported.
+* @arg: User-space pointer to a struct stop_button_state.
+*
+* Return: 0 on success, negative error value otherwise.
+*/
+static long stop_button_ioctl(struct file *file, unsigned int cmd,
+unsigned long arg)
+{
+struct stop_button_file *sbf = file->private_data;
+struct stop_button_state state;
+
+if (cmd != STOP_BUTTON_IOC_READ_CLEAR) {
+return -ENOTTY;
+}
+
+/*
+* The presses we are about to return shouldn't show up as events as well.
+* Mark them seen first, so a press after this point still wakes up poll().
+*/
+sbf->seen = READ_ONCE(sbf->priv->presses);
+stop_button_read_clear(sbf->priv, &state);
+
+if (copy_to_user((void __user *)arg, &state, sizeof(state))) {
+return -EFAULT;
+}
+
+return 0;
+}
+
+/**
+* stop_button_open() - Open method for the stop_button char device
+* @inode: Unused.
+* @file: Pointer to the char device file struct.
+*
+* Allocates the per-open state. Presses that happened before the file was
+* opened are not reported as events.
+*
+* Return: 0 on success, -ENOMEM otherwise.
+*/
+static int stop_button_open(struct inode *inode, struct file *file)
+{
+// misc_open() sets private_data to our miscdev.
+struct stop_button_dev *priv = container_of(file->private_data,
+struct stop_button_dev, miscdev);
+struct stop_button_file *sbf;
+
+sbf = kzalloc(sizeof(*sbf), GFP_KERNEL);
+if (!sbf) {
+return -ENOMEM;
+}
+sbf->priv = priv;
+sbf->seen = READ_ONCE(priv->presses);
+file->private_data = sbf;
+
+return 0;
+}
+
+/**
+* stop_button_release() - Release method for the stop_button char device
+* @inode: Unused.
+* @file: Pointer to the char device file struct.
+*
+* Return: 0.
+*/
+static int stop_button_release(struct inode *inode, struct file *file)
+{
+kfree(file->private_data);
+return 0;
+}
+
+/**
+* stop_button_mmap() - Mmap method for the stop_button char device
+* @file: Pointer to the char device file struct.
+* @vma: User-space mapping being created.
+*
+* Maps the component's registers into user space so they can be accessed
+* without a system call per access. The mapping is uncached and covers the
+* whole page(s) the component lives in.
+*
+* Return: 0 on success, negative error value otherwise.
+*/
+static int stop_button_mmap(struct file *file, struct vm_area_struct *vma)
+{
+struct stop_button_file *sbf = file->private_data;
+struct stop_button_dev *priv = sbf->priv;
+
+vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+
+// vm_iomap_memory checks the requested size and offset against the region.
+return vm_iomap_memory(vma, priv->phys_addr, priv->phys_size);
+}
+
 /**
 * stop_button_fops - File operations supported by the
 * stop_button driver
@@ -211,20 +632,88 @@ return ret;
 * @write: The write function.
 * @llseek: We use the kernel's default_llseek() function; this allows
 * users to change what position they are writing/reading to/from.
+* @mmap: The mmap function.
+* @poll: The poll function; wakes up when the button is pressed.
+* @unlocked_ioctl: The ioctl function; see STOP_BUTTON_IOC_READ_CLEAR.
+* @open: Allocates per-open state.
+* @release: Frees per-open state.
 */
 static const struct file_operations stop_button_fops = {
 .owner = THIS_MODULE,
 .read = stop_button_read,
 .write = stop_button_write,
 .llseek = default_llseek,
+.mmap = stop_button_mmap,
+.poll = stop_button_poll,
+.unlocked_ioctl = stop_button_ioctl,
+.open = stop_button_open,
+.release = stop_button_release,
 };
 
+/**
+* stop_button_isr() - Hard interrupt handler for a button press
+* @irq: Unused.
+* @dev_id: The stop_button_dev that requested the interrupt.
+*
+* Acknowledges the interrupt and records when it happened, as close to the
+* press as possible. Several presses can land before the pending bit is
+* cleared, so the presses are counted from the component's 16-bit press
+* counter rather than one per interrupt. It is read after the acknowledge:
+* a press in between is counted now and raises one more interrupt, which
+* finds nothing new. Waking up readers is left to the threaded handler.
+*
+* Return: IRQ_WAKE_THREAD if our component raised the interrupt.
+*/
+static irqreturn_t stop_button_isr(int irq, void *dev_id)
+{
+struct stop_button_dev *priv = dev_id;
+ktime_t now = ktime_get();
+u16 count;
+
+if (!(ioread32(priv->irq_ctrl) & IRQ_PENDING)) {
+return IRQ_NONE;
+}
+
+// The pending bit is write-1-to-clear; keep the interrupt enabled.
+iowrite32(IRQ_ENABLE | IRQ_PENDING, priv->irq_ctrl);
+
+spin_lock(&priv->event_lock);
+count = ioread32(priv->status) >> STATUS_COUNT_SHIFT;
+priv->press_time = now;
+priv->presses += (u16)(count - priv->irq_count);
+priv->irq_count = count;
+spin_unlock(&priv->event_lock);
+
+return IRQ_WAKE_THREAD;
+}
+
+/**
+* stop_button_isr_thread() - Threaded interrupt handler for a button press
+* @irq: Unused.
+* @dev_id: The stop_button_dev that requested the interrupt.
+*
+* Wakes up blocked readers and pollers of the char device and anyone
+* polling the stop_button sysfs attribute.
+*
+* Return: IRQ_HANDLED.
+*/
+static irqreturn_t stop_button_isr_thread(int irq, void *dev_id)
+{
+struct stop_button_dev *priv = dev_id;
+
+wake_up_interruptible(&priv->wait);
+sysfs_notify(&priv->dev->kobj, NULL, "stop_button");
+
+return IRQ_HANDLED;
+}
+
 static int stop_button_probe(struct platform_device *pdev)
 {
 
 size_t ret;
 
 struct stop_button_dev *priv;
+struct resource *res;
 /*
 * Allocate kernel memory for the led patterns device and set it to 0.
 * GFP_KERNEL specifies that we are allocating normal kernel RAM;
@@ -243,15 +732,50 @@ return -ENOMEM;
 * into the kernel's virtual address space because we don't have access
 * to physical memory locations.
 */
-priv->base_addr = devm_platform_ioremap_resource(pdev, 0);
+priv->base_addr = devm_platform_get_and_ioremap_resource(pdev, 0, &res);
 if (IS_ERR(priv->base_addr)) {
 pr_err("Failed to request/remap platform device resource\n");
 return PTR_ERR(priv->base_addr);
 }
+// Remember the physical region so mmap can hand it to user space.
+priv->phys_addr = res->start;
+priv->phys_size = resource_size(res);
 // Set the memory addresses for each register.
 priv->stop_button = priv->base_addr + STOP_BUTTON_OFFSET;
-// force button to low
+priv->irq_ctrl = priv->base_addr + IRQ_CTRL_OFFSET;
+priv->status = priv->base_addr + STATUS_OFFSET;
+priv->hit_index = priv->base_addr + HIT_INDEX_OFFSET;
+priv->win_lo = priv->base_addr + WIN_LO_OFFSET;
+priv->win_hi = priv->base_addr + WIN_HI_OFFSET;
+priv->press = priv->base_addr + PRESS_OFFSET;
+priv->press_hit = priv->base_addr + PRESS_HIT_OFFSET;
+// force button to low, and drop a press or win left from before
 iowrite32(0x0, priv->stop_button);
+priv->last_count = ioread32(priv->press) >> STATUS_COUNT_SHIFT;
+priv->irq_count = priv->last_count;
+
+priv->dev = &pdev->dev;
+mutex_init(&priv->lock);
+spin_lock_init(&priv->event_lock);
+init_waitqueue_head(&priv->wait);
+
+/*
+* The press interrupt is split: the hard handler acknowledges it and takes
+* the timestamp, the threaded handler does the wakeups. Clear anything
+* left pending before enabling the interrupt in the component.
+*/
+priv->irq = platform_get_irq(pdev, 0);
+if (priv->irq < 0) {
+return priv->irq;
+}
+iowrite32(IRQ_PENDING, priv->irq_ctrl);
+ret = devm_request_threaded_irq(&pdev->dev, priv->irq, stop_button_isr,
+stop_button_isr_thread, 0, "stop_button", priv);
+if (ret) {
+pr_err("Failed to request interrupt\n");
+return ret;
+}
+iowrite32(IRQ_ENABLE, priv->irq_ctrl);
 
 // Initialize the misc device parameters
 priv->miscdev.minor = MISC_DYNAMIC_MINOR;
@@ -263,6 +787,7 @@ priv->miscdev.parent = &pdev->dev;
 ret = misc_register(&priv->miscdev);
 if (ret) {
 pr_err("Failed to register misc device");
+iowrite32(IRQ_PENDING, priv->irq_ctrl);
 return ret;
 }
 
@@ -270,6 +795,14 @@ return ret;
 * This is so we can access our state container in the other functions.
 */
 platform_set_drvdata(pdev, priv);
+
+// perf is a nice to have, so the device works without it
+ret = de10_pmu_register(&priv->pmu, &pdev->dev, "de10_stop_button", priv->base_addr,
+stop_button_counters, ARRAY_SIZE(stop_button_counters));
+if (ret) {
+pr_warn("Failed to register the de10_stop_button PMU\n");
+}
+
 pr_info("stop_button_probe successful\n");
 return 0;
 }
@@ -285,9 +818,13 @@ static int stop_button_remove(struct platform_device *pdev)
 {
 // Get the stop_button's private data from the platform device.
 struct stop_button_dev *priv = platform_get_drvdata(pdev);
+// Stop interrupting before the devm-managed handler is freed.
+iowrite32(IRQ_PENDING, priv->irq_ctrl);
 // Force button low
 iowrite32(0x0, priv->stop_button);
 
+de10_pmu_unregister(&priv->pmu);
+
 // Deregister the misc device and remove the /dev/led_patterns file.
 misc_deregister(&priv->miscdev);
 pr_info("stop_button_remove successful\n");
@@ -0,0 +1,59 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT */
+#ifndef STOP_BUTTON_H
+#define STOP_BUTTON_H
+
+/*
+* Interface between the stop_button driver and user space. This header is
+* included by both linux/stop_button/stop_button.c and the programs in sw/.
+*/
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/*
+* Reading struct stop_button_event from this file offset blocks until the
+* button is pressed (or returns -EAGAIN if the file is O_NONBLOCK). Each open
+* file sees every press once; presses close together can come in one event,
+* and the change in its presses field says how many. poll() reports
+* POLLIN when a press is pending.
+*/
+#define STOP_BUTTON_EVENT_OFFSET 0x100
+
+/**
+* struct stop_button_event - A button press reported by the driver.
+* @timestamp_ns: CLOCK_MONOTONIC time at which the interrupt was taken.
+* @presses: Number of presses since the driver was loaded.
+* @reserved: Always 0.
+*/
+struct stop_button_event {
+	__u64 timestamp_ns;
+	__u32 presses;
+	__u32 reserved;
+};
+
+/**
+* struct stop_button_state - Result of STOP_BUTTON_IOC_READ_CLEAR.
+* @pressed: 1 if the button was pressed since the last read-and-clear.
+* @presses: Number of presses since the last read-and-clear.
+* @count: The component's free-running 16-bit press counter.
+* @won: 1 if a press since the last read-and-clear landed while the moving
+*       led was inside the win window (the win_lo and win_hi registers).
+* @hit_index: strip_index of the moving led, captured by the FPGA on the
+*             same clock edge as the last press.
+*/
+struct stop_button_state {
+	__u32 pressed;
+	__u32 presses;
+	__u32 count;
+	__u32 won;
+	__u32 hit_index;
+};
+
+/*
+* Return the latched press state and clear it in one call. Presses that land
+* while the state is being cleared are counted by the next call, never lost.
+* This also consumes any pending events of the calling file.
+*/
+#define STOP_BUTTON_IOC_READ_CLEAR _IOR('s', 1, struct stop_button_state)
+
+#endif /* STOP_BUTTON_H */
@@ -0,0 +1,66 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT */
+#ifndef WS2811_H
+#define WS2811_H
+
+/*
+* Interface between the ws2811 driver and user space. This header is
+* included by both linux/ws2811_driver/ws2811_driver.c and the programs in sw/.
+*/
+
+#include <linux/types.h>
+
+/*
+* Reading struct ws2811_vsync from this file offset (just past the registers)
+* blocks until the component finishes sending a frame this file hasn't seen
+* (or returns -EAGAIN if the file is O_NONBLOCK). Writing the commit register
+* through the same file marks every frame so far as seen, so the next vsync
+* is the one that shows the committed page. poll() reports POLLIN when an
+* unseen frame has finished.
+*/
+#define WS2811_VSYNC_OFFSET 0x10000
+
+/*
+* Writes from this file offset on go to the framebuffer as one long strip:
+* word n is LED n % led_count of channel n / led_count, wherever the
+* channel's bank is. The window is channels * led_count words long.
+* In indexed mode (the indexed sysfs attribute) the window takes one byte,
+* a palette index, per LED instead, and is channels * led_count bytes long.
+*/
+#define WS2811_STRIP_OFFSET 0x20000
+
+/*
+* Writes from this file offset on are run-length encoded: every 32-bit word
+* is a run of (word >> 24) + 1 LEDs of colour word & 0xffffff, painted
+* along the same long strip as WS2811_STRIP_OFFSET. Byte offset 4n starts
+* painting at LED n, and a write leaves the file offset at the LED after
+* the last one painted. Runs are clipped at the end of the last channel.
+*/
+#define WS2811_RLE_OFFSET 0x30000
+
+/*
+* The frame buffers in memory that the component fetches frames from by
+* itself. mmap() at WS2811_DMA_OFFSET + n * WS2811_DMA_SIZE maps buffer n,
+* laid out like the WS2811_STRIP_OFFSET window (one word per LED, two in
+* deep mode, one byte per LED in indexed mode). Writing a __u32 n at file
+* offset WS2811_DMA_OFFSET starts a fetch of buffer n into the back page,
+* which is committed once it is in; -EBUSY means the previous fetch isn't
+* done yet. Don't change a buffer while it is being fetched.
+*/
+#define WS2811_DMA_OFFSET 0x40000
+#define WS2811_DMA_SIZE 0x8000
+#define WS2811_DMA_BUFFERS 2
+
+/**
+* struct ws2811_vsync - The end of a frame, reported by the driver.
+* @timestamp_ns: CLOCK_MONOTONIC time at which the frame-done interrupt
+*                was taken.
+* @frames: Number of frames sent since the driver was loaded.
+* @reserved: Always 0.
+*/
+struct ws2811_vsync {
+	__u64 timestamp_ns;
+	__u32 frames;
+	__u32 reserved;
+};
+
+#endif /* WS2811_H */
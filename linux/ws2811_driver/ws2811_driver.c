@@ -7,19 +7,171 @@
 #include <linux/types.h>            // data types like u32, u16, etc.
 #include <linux/fs.h>               // copy_to_user, etc.
 #include <linux/kstrtox.h>          // kstrtou8, etc.
+#include <linux/mm.h>               // vm_iomap_memory, etc.
+#include <linux/interrupt.h>        // devm_request_irq, etc.
+#include <linux/wait.h>             // wait queues
+#include <linux/poll.h>             // poll_table, EPOLLIN, etc.
+#include <linux/ktime.h>            // ktime_get, etc.
+#include <linux/slab.h>             // kzalloc, kfree
+#include <linux/spinlock.h>         // spinlock definitions
+#include <linux/dma-mapping.h>      // dma_alloc_coherent, etc.
 
-#define RGB_ALL 0x0
-#define RGB_SINGLE 0x4
+#include "ws2811.h"
+#include "../de10_pmu/de10_pmu.h"
+
+#define RGB_SINGLE 0x0
+#define RGB_ALL 0x4
 #define STRIP_INDEX 0x8
+#define CTRL 0xc
+#define LED_COUNT 0x10
+#define COMMIT 0x14
+#define IRQ_CTRL 0x18
+#define FRAME_COUNT 0x1c
+// bit timings and latch period, in cycles of the component's 50 MHz clock
+#define T0H 0x20
+#define T0L 0x24
+#define T1H 0x28
+#define T1L 0x2c
+#define LATCH 0x30
+// leds sent per frame; 0 sends all of them
+#define ACTIVE_COUNT 0x34
+// number of parallel strips, and words between their framebuffer banks
+#define CHANNELS 0x38
+#define CHANNEL_STRIDE 0x3c
+// number of sprites; sprite k's registers are at SPRITE_BASE + k * SPRITE_STRIDE
+#define SPRITES 0x40
+#define SPRITE_BASE 0x100
+#define SPRITE_STRIDE 0x10
+#define SPRITE_POSITION 0x0
+#define SPRITE_LENGTH 0x4
+#define SPRITE_COLOR 0x8
+#define SPRITE_PERIOD 0xc
+// number of colour segments; segment k's registers are at
+// SEGMENT_BASE + k * SEGMENT_STRIDE
+#define SEGMENTS 0x4c
+#define SEGMENT_BASE 0x200
+#define SEGMENT_STRIDE 0x10
+#define SEGMENT_START 0x0
+#define SEGMENT_LENGTH 0x4
+#define SEGMENT_COLOR 0x8
+// pixel shown on LED 0, and how often the component steps it
+#define ROTATE 0x44
+#define ROTATE_STEP 0x48
+// run-length decoder: RLE_POS is the next led painted, counting along the
+// channels; every word written to RLE_DATA paints bits 31-24 plus one leds
+// with the colour in bits 23-0
+#define RLE_POS 0x50
+#define RLE_DATA 0x54
+// every colour is scaled by brightness / 256 before the gamma table
+#define BRIGHTNESS 0x58
+#define BRIGHTNESS_MAX 256
+// clock cycles from a register write to the first bit of the frame showing
+// it, for the last change and the worst since LATENCY_MAX was written
+#define LATENCY 0x5c
+#define LATENCY_MAX 0x60
+#define CYCLES_PER_US 50
+// added to every hue in HSV mode; 256 is once round the colour wheel
+#define HUE_OFFSET 0x64
+#define HUE_OFFSET_MAX 255
+// pattern generator: the pattern shown over the framebuffer or legacy
+// registers (0 for none), its phase step per frame and per LED in 1/65536
+// of a cycle (16 bits, the step per frame signed), and its two colours
+#define PATTERN 0x68
+#define PATTERN_SPEED 0x6c
+#define PATTERN_SCALE 0x70
+#define PATTERN_COLOR 0x74
+#define PATTERN_COLOR2 0x78
+// stream sink: LEDs sent with no streamed pixel to show and clock cycles
+// a producer was held off (a write clears either), and beats in the FIFO
+#define STREAM_UNDERFLOW 0x7c
+#define STREAM_BACKPRESSURE 0x80
+#define STREAM_LEVEL 0x84
+// frame fetch: bus address of the frame to copy into the back page, with
+// DMA_COMMIT to commit it once copied (written while idle only), and
+// DMA_BUSY set from the write until the copy is done. DMA_ERROR says the
+// last fetch was given up, by a write to DMA_STATUS or because the memory
+// port didn't answer for 1.3 ms; the framebuffer ignores writes and reads
+// 0 while a fetch is on
+#define DMA_ADDR 0x88
+#define DMA_STATUS 0x8c
+#define DMA_COMMIT 0x1
+#define DMA_BUSY 0x1
+#define DMA_ERROR 0x2
+// free-running counters for the de10_ws2811 PMU, with FRAME_COUNT: bits
+// sent on each strip, register reads and writes, and clock cycles an
+// access was held off while the framebuffer was taken
+#define PERF_BITS 0x90
+#define PERF_READS 0x94
+#define PERF_WRITES 0x98
+#define PERF_STALLS 0x9c
+// 256 colours used in indexed mode
+#define PALETTE 0x400
+// 256 words; word v holds what red, green and blue of value v become, in
+// bits 23-16, 15-8 and 7-0
+#define GAMMA 0x800
+// one 32-bit word per LED, colour in bits 23-0; one bank per channel.
+// In indexed mode each word holds the palette indices of four LEDs.
+#define FRAMEBUFFER 0x8000
+
+#define CTRL_FRAMEBUFFER 0x1
+#define CTRL_REVERSE 0x2
+#define CTRL_MIRROR 0x4
+#define CTRL_INDEXED 0x8
+#define CTRL_GAMMA 0x10
+#define CTRL_DEEP 0x20
+#define CTRL_DITHER 0x40
+#define CTRL_ON_DEMAND 0x80
+#define CTRL_HSV 0x100
+#define CTRL_STREAM 0x200
+
+// rotate step register: frames per step in bits 15-0, backwards with
+// ROTATE_BACKWARDS set
+#define ROTATE_STEP_MASK 0xffff
+#define ROTATE_BACKWARDS 0x80000000
+
+// sprite period register: step period in bits 29-0, in frames instead of
+// microseconds with SPRITE_FRAMES set, backwards with SPRITE_REVERSE set
+#define SPRITE_PERIOD_MASK 0x3fffffff
+#define SPRITE_FRAMES 0x40000000
+#define SPRITE_REVERSE 0x80000000
 
-#define SPAN 12
+// irq control register bits
+#define IRQ_ENABLE 0x1
+#define IRQ_PENDING 0x2
+
+#define SPAN 0x10000
+
+// words copied from user space at a time by ws2811_write
+#define WRITE_CHUNK 64
 
 /**
 * struct ws2811_dev - Private rgb pwm controller device struct.
 * @base_addr: Pointer to the component's base address
+* @phys_addr: Physical address of the component, used by mmap
+* @phys_size: Size of the component's memory region
+* @pixel_addr: Pointer to the pixel window, or NULL if the device tree has
+* no second region
+* @pixel_size: Size of the pixel window
+* @dma_buf: CPU addresses of the frame buffers the component fetches from
+* @dma_handle: Bus addresses of the same buffers
+* @pmu: The de10_ws2811 perf PMU over the component's counters
 * @rgb_all: Address of the red duty cycle register
 * @rgb_single: Address of the green duty cycle register
 * @strip_index: Address of the blue duty cycle register
+* @ctrl: Address of the control register
+* @irq_ctrl: Address of the interrupt control register
+* @led_count: Number of LEDs on each channel the component was built for
+* @channels: Number of strips driven in parallel
+* @channel_stride: Words between the framebuffer banks of two channels
+* @sprites: Number of hardware sprites
+* @sprite: Sprite the sprite_* sysfs attributes access
+* @segments: Number of colour segments
+* @segment: Segment the segment_* sysfs attributes access
+* @irq: Interrupt number of the frame-done interrupt
+* @wait: Wait queue for readers/pollers waiting on the end of a frame
+* @vsync_lock: Spinlock protecting @frames and @frame_time
+* @frames: Number of frames seen by the interrupt handler
+* @frame_time: Time at which the last frame-done interrupt was taken
 * @miscdev: miscdevice used to create a character device
 * @lock: mutex used to prevent concurrent writes to memory
 *
@@ -27,13 +179,81 @@
 */
 struct ws2811_dev {
 void __iomem *base_addr;
+phys_addr_t phys_addr;
+resource_size_t phys_size;
+void __iomem *pixel_addr;
+resource_size_t pixel_size;
+void *dma_buf[WS2811_DMA_BUFFERS];
+dma_addr_t dma_handle[WS2811_DMA_BUFFERS];
+struct de10_pmu pmu;
 void __iomem *rgb_all;
 void __iomem *rgb_single;
 void __iomem *strip_index;
+void __iomem *ctrl;
+void __iomem *irq_ctrl;
+u32 led_count;
+u32 channels;
+u32 channel_stride;
+u32 sprites;
+u32 sprite;
+u32 segments;
+u32 segment;
+int irq;
+wait_queue_head_t wait;
+spinlock_t vsync_lock;
+u32 frames;
+ktime_t frame_time;
 struct miscdevice miscdev;
 struct mutex lock;
 };
 
+/**
+* struct ws2811_timing - Bit timings and latch period of an LED type.
+* @name: Name accepted and shown by the timing sysfs attribute.
+* @t0h: High time of a 0 bit, in 20 ns clock cycles.
+* @t0l: Low time of a 0 bit.
+* @t1h: High time of a 1 bit.
+* @t1l: Low time of a 1 bit.
+* @latch: Low time between frames that makes the LEDs show the frame.
+*/
+struct ws2811_timing {
+const char *name;
+u32 t0h;
+u32 t0l;
+u32 t1h;
+u32 t1l;
+u32 latch;
+};
+
+/*
+* Timing presets. ws2811 is the 400 kHz timing the component resets to; the
+* others are 800 kHz parts, which halve the time it takes to send a frame.
+*/
+static const struct ws2811_timing ws2811_timings[] = {
+// 0.5/2.0/1.2/1.3 us, 100 us latch
+{ "ws2811", 25, 100, 60, 65, 5000 },
+// 0.4/0.85/0.8/0.45 us, 300 us latch (newer parts need more than 280 us)
+{ "ws2812b", 20, 43, 40, 23, 15000 },
+// 0.3/0.9/0.6/0.6 us, 80 us latch
+{ "sk6812", 15, 45, 30, 30, 4000 },
+};
+
+// Pattern names accepted and shown by the pattern sysfs attribute, in the
+// order of their numbers in the PATTERN register.
+static const char *const ws2811_patterns[] = {
+"off", "rainbow", "gradient", "plasma", "comet",
+};
+
+/**
+* struct ws2811_file - Per-open state of the ws2811 char device.
+* @priv: The device this file was opened on.
+* @seen: Value of @priv->frames when this file last consumed a vsync.
+*/
+struct ws2811_file {
+struct ws2811_dev *priv;
+u32 seen;
+};
+
 /**
 * rgb_all_show() - Return the rgb_all value
 * to user-space via sysfs.
@@ -193,222 +413,1939 @@ iowrite32(strip_index, priv->strip_index);
 return size;
 }
 
-// Define sysfs attributes
-static DEVICE_ATTR_RW(rgb_all);
-static DEVICE_ATTR_RW(rgb_single);
-static DEVICE_ATTR_RW(strip_index);
-
-// Create an attribute group so the device core can
-// export the attributes for us.
-static struct attribute *ws2811_attrs[] = {
-&dev_attr_rgb_all.attr,
-&dev_attr_rgb_single.attr,
-&dev_attr_strip_index.attr,
-NULL,
-};
-ATTRIBUTE_GROUPS(ws2811);
-
 /**
-* ws2811_read() - Read method for the ws2811 char device
-* @file: Pointer to the char device file struct.
-* @buf: User-space buffer to read the value into.
-* @count: The number of bytes being requested.
-* @offset: The byte offset in the file being read from.
+* ws2811_ctrl_show() - Return a bit of the control register to user-space
+* via sysfs.
+* @dev: Device structure for the ws2811_controller component.
+* @bit: The control register bit.
+* @buf: Buffer that gets returned to user-space.
 *
-* Return: On success, the number of bytes written is returned and the
-* offset @offset is advanced by this number. On error, a negative error
-* value is returned.
+* Return: The number of bytes read.
 */
-static ssize_t ws2811_read(struct file *file, char __user *buf,
-size_t count, loff_t *offset)
+static ssize_t ws2811_ctrl_show(struct device *dev, u32 bit, char *buf)
 {
-size_t ret;
-u32 val;
+struct ws2811_dev *priv = dev_get_drvdata(dev);
 
-/*
-* Get the device's private data from the file struct's private_data
-* field. The private_data field is equal to the miscdev field in the
-* ws2811_dev struct. container_of returns the
-* ws2811_dev struct that contains the miscdev in private_data.
+return scnprintf(buf, PAGE_SIZE, "%u\n", !!(ioread32(priv->ctrl) & bit));
+}
+
+/**
+* ws2811_ctrl_store() - Set or clear a bit of the control register.
+* @dev: Device structure for the ws2811_controller component.
+* @bit: The control register bit.
+* @buf: Buffer that contains a boolean.
+* @size: The number of bytes being written.
+*
+* The component starts using the new value at the end of the current frame.
+* Bits for features the component was built without read back as 0.
+*
+* Return: The number of bytes stored, or -EOPNOTSUPP if the bit didn't set.
 */
-struct ws2811_dev *priv = container_of(file->private_data,
-struct ws2811_dev, miscdev);
+static ssize_t ws2811_ctrl_store(struct device *dev, u32 bit,
+const char *buf, size_t size)
+{
+bool set;
+u32 ctrl;
+int ret;
+struct ws2811_dev *priv = dev_get_drvdata(dev);
 
-// Check file offset to make sure we are reading from a valid location.
-if (*offset < 0) {
-// We can't read from a negative file position.
-return -EINVAL;
+ret = kstrtobool(buf, &set);
+if (ret < 0) {
+return ret;
 }
-if (*offset >= SPAN) {
-// We can't read from a position past the end of our device.
-return 0;
+
+mutex_lock(&priv->lock);
+ctrl = ioread32(priv->ctrl);
+if (set) {
+ctrl |= bit;
 }
-if ((*offset % 0x4) != 0) {
-// Prevent unaligned access.
-pr_warn("ws2811_read: unaligned access\n");
-return -EFAULT;
+else {
+ctrl &= ~bit;
 }
+iowrite32(ctrl, priv->ctrl);
+ctrl = ioread32(priv->ctrl);
+mutex_unlock(&priv->lock);
 
-val = ioread32(priv->base_addr + *offset);
+if (set && !(ctrl & bit)) {
+return -EOPNOTSUPP;
+}
 
-// Copy the value to userspace.
-ret = copy_to_user(buf, &val, sizeof(val));
-if (ret == sizeof(val)) {
-pr_warn("ws2811_read: nothing copied\n");
-return -EFAULT;
+return size;
 }
 
-// Increment the file offset by the number of bytes we read.
-*offset = *offset + sizeof(val);
+// The boolean control attributes only differ in the bit they access:
+// framebuffer shows the framebuffer instead of rgb_all/rgb_single/strip_index,
+// reverse shows the last pixel on LED 0, mirror makes the second half of
+// the strip mirror the first, indexed makes the framebuffer hold
+// palette indices, gamma passes every colour through the gamma table, deep
+// makes the framebuffer hold 16-bit colours, dither spreads the bits
+// below the top 8 over frames, on_demand only sends a frame when a
+// register write changes what is shown, hsv makes every 8-bit colour
+// hue, saturation and value instead of red, green and blue, and stream
+// shows the pixels another FPGA block streams to the component.
+#define WS2811_CTRL_ATTR(_name, _bit) \
+static ssize_t _name##_show(struct device *dev, \
+struct device_attribute *attr, char *buf) \
+{ \
+return ws2811_ctrl_show(dev, _bit, buf); \
+} \
+static ssize_t _name##_store(struct device *dev, \
+struct device_attribute *attr, const char *buf, size_t size) \
+{ \
+return ws2811_ctrl_store(dev, _bit, buf, size); \
+} \
+static DEVICE_ATTR_RW(_name)
 
-return sizeof(val);
-}
+WS2811_CTRL_ATTR(framebuffer, CTRL_FRAMEBUFFER);
+WS2811_CTRL_ATTR(reverse, CTRL_REVERSE);
+WS2811_CTRL_ATTR(mirror, CTRL_MIRROR);
+WS2811_CTRL_ATTR(indexed, CTRL_INDEXED);
+WS2811_CTRL_ATTR(gamma, CTRL_GAMMA);
+WS2811_CTRL_ATTR(deep, CTRL_DEEP);
+WS2811_CTRL_ATTR(dither, CTRL_DITHER);
+WS2811_CTRL_ATTR(on_demand, CTRL_ON_DEMAND);
+WS2811_CTRL_ATTR(hsv, CTRL_HSV);
+WS2811_CTRL_ATTR(stream, CTRL_STREAM);
 
 /**
-* ws2811_write() - Write method for the ws2811 char device
-* @file: Pointer to the char device file struct.
-* @buf: User-space buffer to read the value from.
-* @count: The number of bytes being written.
-* @offset: The byte offset in the file being written to.
+* rotation_show() - Return the pixel shown on LED 0 to user-space via sysfs.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that gets returned to user-space.
 *
-* Return: On success, the number of bytes written is returned and the
-* offset @offset is advanced by this number. On error, a negative error
-* value is returned.
+* Return: The number of bytes read.
 */
-static ssize_t ws2811_write(struct file *file, const char __user *buf,
-size_t count, loff_t *offset)
+static ssize_t rotation_show(struct device *dev,
+struct device_attribute *attr, char *buf)
 {
-size_t ret;
-u32 val;
-
-struct ws2811_dev *priv = container_of(file->private_data,
-struct ws2811_dev, miscdev);
+struct ws2811_dev *priv = dev_get_drvdata(dev);
 
-if (*offset < 0) {
-return -EINVAL;
-}
-if (*offset >= SPAN) {
-return 0;
-}
-if ((*offset % 0x4) != 0) {
-pr_warn("ws2811_write: unaligned access\n");
-return -EFAULT;
+return scnprintf(buf, PAGE_SIZE, "%u\n", ioread32(priv->base_addr + ROTATE));
 }
 
-mutex_lock(&priv->lock);
-
-// Get the value from userspace.
-ret = copy_from_user(&val, buf, sizeof(val));
-if (ret != sizeof(val)) {
-iowrite32(val, priv->base_addr + *offset);
-
-// Increment the file offset by the number of bytes we wrote.
-*offset = *offset + sizeof(val);
+/**
+* rotation_store() - Rotate the strip contents.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that contains the pixel to show on LED 0.
+* @size: The number of bytes being written.
+*
+* Every LED shows the pixel this many places further along the
+* framebuffer (or the legacy registers), wrapping at led_count.
+*
+* Return: The number of bytes stored.
+*/
+static ssize_t rotation_store(struct device *dev,
+struct device_attribute *attr, const char *buf, size_t size)
+{
+u32 rotation;
+int ret;
+struct ws2811_dev *priv = dev_get_drvdata(dev);
 
-// Return the number of bytes we wrote.
-ret = sizeof(val);
+ret = kstrtouint(buf, 0, &rotation);
+if (ret < 0) {
+return ret;
 }
-else {
-pr_warn("ws2811_write: nothing copied from user space\n");
-ret = -EFAULT;
+if (rotation >= priv->led_count) {
+return -EINVAL;
 }
 
-mutex_unlock(&priv->lock);
-return ret;
+iowrite32(rotation, priv->base_addr + ROTATE);
+
+return size;
 }
 
 /**
-* ws2811_fops - File operations supported by the
-* ws2811 driver
-* @owner: The ws2811 driver owns the file operations; this
-* ensures that the driver can't be removed while the
-* character device is still in use.
-* @read: The read function.
-* @write: The write function.
-* @llseek: We use the kernel's default_llseek() function; this allows
-* users to change what position they are writing/reading to/from.
+* rotation_step_show() - Return how often the rotation steps to user-space
+* via sysfs.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that gets returned to user-space.
+*
+* Return: The number of bytes read.
 */
-static const struct file_operations ws2811_fops = {
-.owner = THIS_MODULE,
-.read = ws2811_read,
-.write = ws2811_write,
-.llseek = default_llseek,
-};
-
-static int ws2811_probe(struct platform_device *pdev)
+static ssize_t rotation_step_show(struct device *dev,
+struct device_attribute *attr, char *buf)
 {
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+u32 step = ioread32(priv->base_addr + ROTATE_STEP);
 
-size_t ret;
+return scnprintf(buf, PAGE_SIZE, "%s%u\n",
+(step & ROTATE_BACKWARDS) ? "-" : "", step & ROTATE_STEP_MASK);
+}
 
-struct ws2811_dev *priv;
-/*
-* Allocate kernel memory for the led patterns device and set it to 0.
-* GFP_KERNEL specifies that we are allocating normal kernel RAM;
-* see the kmalloc documentation for more info. The allocated memory
-* is automatically freed when the device is removed.
+/**
+* rotation_step_store() - Make the component step the rotation by itself.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Frames per step, negative to rotate backwards; 0 stops.
+* @size: The number of bytes being written.
+*
+* Return: The number of bytes stored.
 */
-priv = devm_kzalloc(&pdev->dev, sizeof(struct ws2811_dev),
-GFP_KERNEL);
-if (!priv) {
-pr_err("Failed to allocate memory\n");
-return -ENOMEM;
+static ssize_t rotation_step_store(struct device *dev,
+struct device_attribute *attr, const char *buf, size_t size)
+{
+int frames;
+u32 step = 0;
+int ret;
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+ret = kstrtoint(buf, 0, &frames);
+if (ret < 0) {
+return ret;
 }
-/*
-* Request and remap the device's memory region. Requesting the region
-* make sure nobody else can use that memory. The memory is remapped
-* into the kernel's virtual address space because we don't have access
-* to physical memory locations.
-*/
-priv->base_addr = devm_platform_ioremap_resource(pdev, 0);
-if (IS_ERR(priv->base_addr)) {
-pr_err("Failed to request/remap platform device resource\n");
-return PTR_ERR(priv->base_addr);
+if (frames > ROTATE_STEP_MASK || frames < -ROTATE_STEP_MASK) {
+return -EINVAL;
+}
+if (frames < 0) {
+step = ROTATE_BACKWARDS;
+frames = -frames;
 }
-// Set the memory addresses for each register.
-priv->rgb_all = priv->base_addr + RGB_ALL;
-priv->rgb_single = priv->base_addr + RGB_SINGLE;
-priv->strip_index = priv->base_addr + STRIP_INDEX;
-// turn on red, just for fun.
-iowrite32(0xffff, priv->rgb_all);
-iowrite32(0x0, priv->rgb_single);
-iowrite32(0x0, priv->strip_index);
 
-// Initialize the misc device parameters
-priv->miscdev.minor = MISC_DYNAMIC_MINOR;
-priv->miscdev.name = "ws2811";
-priv->miscdev.fops = &ws2811_fops;
-priv->miscdev.parent = &pdev->dev;
+iowrite32(step | frames, priv->base_addr + ROTATE_STEP);
 
-// Register the misc device; this creates a char dev at /dev/ws2811
-ret = misc_register(&priv->miscdev);
-if (ret) {
-pr_err("Failed to register misc device");
-return ret;
+return size;
 }
 
-/* Attach the ws2811's private data to the platform device's struct.
-* This is so we can access our state container in the other functions.
+/**
+* led_count_show() - Return the number of LEDs the component was built
+* for to user-space via sysfs.
+* @dev: Device structure for the ws2811_controller component. This
+* device struct is embedded in the ws2811_controller' device struct.
+* @attr: Unused.
+* @buf: Buffer that gets returned to user-space.
+*
+* Return: The number of bytes read.
 */
-platform_set_drvdata(pdev, priv);
-pr_info("ws2811_probe successful\n");
-return 0;
+static ssize_t led_count_show(struct device *dev,
+struct device_attribute *attr, char *buf)
+{
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+return scnprintf(buf, PAGE_SIZE, "%u\n", priv->led_count);
 }
 
 /**
-* ws2811_remove() - Remove an ws2811 device.
-* @pdev: Platform device structure associated with our ws2811 device.
+* channels_show() - Return the number of strips driven in parallel
+* to user-space via sysfs.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that gets returned to user-space.
 *
-* This function is called when an ws2811 devicee is removed or
-* the driver is removed.
+* Return: The number of bytes read.
 */
-static int ws2811_remove(struct platform_device *pdev)
+static ssize_t channels_show(struct device *dev,
+struct device_attribute *attr, char *buf)
 {
-// Get the ws2811's private data from the platform device.
-struct ws2811_dev *priv = platform_get_drvdata(pdev);
-// Turn off LED for kicks.
-iowrite32(0x0, priv->rgb_all);
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+return scnprintf(buf, PAGE_SIZE, "%u\n", priv->channels);
+}
+
+/**
+* ws2811_timing_show() - Return a timing register to user-space via sysfs.
+* @dev: Device structure for the ws2811_controller component.
+* @offset: Offset of the timing register.
+* @buf: Buffer that gets returned to user-space.
+*
+* Return: The number of bytes read.
+*/
+static ssize_t ws2811_timing_show(struct device *dev, u32 offset, char *buf)
+{
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+return scnprintf(buf, PAGE_SIZE, "%u\n", ioread32(priv->base_addr + offset));
+}
+
+/**
+* ws2811_timing_store() - Store a timing register.
+* @dev: Device structure for the ws2811_controller component.
+* @offset: Offset of the timing register.
+* @buf: Buffer that contains the number of clock cycles.
+* @size: The number of bytes being written.
+*
+* The component starts using the new value at the end of the current frame.
+*
+* Return: The number of bytes stored.
+*/
+static ssize_t ws2811_timing_store(struct device *dev, u32 offset,
+const char *buf, size_t size)
+{
+u16 cycles;
+int ret;
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+// The registers are 16 bits wide, and a phase is at least one cycle.
+ret = kstrtou16(buf, 0, &cycles);
+if (ret < 0) {
+return ret;
+}
+if (cycles == 0) {
+return -EINVAL;
+}
+
+iowrite32(cycles, priv->base_addr + offset);
+
+return size;
+}
+
+// The five timing attributes only differ in the register they access.
+#define WS2811_TIMING_ATTR(_name, _offset) \
+static ssize_t _name##_show(struct device *dev, \
+struct device_attribute *attr, char *buf) \
+{ \
+return ws2811_timing_show(dev, _offset, buf); \
+} \
+static ssize_t _name##_store(struct device *dev, \
+struct device_attribute *attr, const char *buf, size_t size) \
+{ \
+return ws2811_timing_store(dev, _offset, buf, size); \
+} \
+static DEVICE_ATTR_RW(_name)
+
+WS2811_TIMING_ATTR(t0h, T0H);
+WS2811_TIMING_ATTR(t0l, T0L);
+WS2811_TIMING_ATTR(t1h, T1H);
+WS2811_TIMING_ATTR(t1l, T1L);
+WS2811_TIMING_ATTR(latch, LATCH);
+
+/**
+* brightness_show() - Return the brightness to user-space via sysfs.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that gets returned to user-space.
+*
+* Return: The number of bytes read.
+*/
+static ssize_t brightness_show(struct device *dev,
+struct device_attribute *attr, char *buf)
+{
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+return scnprintf(buf, PAGE_SIZE, "%u\n", ioread32(priv->base_addr + BRIGHTNESS));
+}
+
+/**
+* brightness_store() - Store the brightness of the whole strip.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that contains the brightness, 0 (off) to 256 (full).
+* @size: The number of bytes being written.
+*
+* Every colour shown is scaled by the brightness / 256, before the gamma
+* table, from the next frame on.
+*
+* Return: The number of bytes stored.
+*/
+static ssize_t brightness_store(struct device *dev,
+struct device_attribute *attr, const char *buf, size_t size)
+{
+u32 brightness;
+int ret;
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+ret = kstrtouint(buf, 0, &brightness);
+if (ret < 0) {
+return ret;
+}
+if (brightness > BRIGHTNESS_MAX) {
+return -EINVAL;
+}
+
+iowrite32(brightness, priv->base_addr + BRIGHTNESS);
+
+return size;
+}
+
+/**
+* hue_offset_show() - Return the hue offset to user-space via sysfs.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that gets returned to user-space.
+*
+* Return: The number of bytes read.
+*/
+static ssize_t hue_offset_show(struct device *dev,
+struct device_attribute *attr, char *buf)
+{
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+return scnprintf(buf, PAGE_SIZE, "%u\n", ioread32(priv->base_addr + HUE_OFFSET));
+}
+
+/**
+* hue_offset_store() - Store the hue offset.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that contains the offset, 0 to 255.
+* @size: The number of bytes being written.
+*
+* In HSV mode the offset is added to every hue from the next frame on, so
+* stepping it turns every colour round the colour wheel with one write.
+*
+* Return: The number of bytes stored.
+*/
+static ssize_t hue_offset_store(struct device *dev,
+struct device_attribute *attr, const char *buf, size_t size)
+{
+u32 offset;
+int ret;
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+ret = kstrtouint(buf, 0, &offset);
+if (ret < 0) {
+return ret;
+}
+if (offset > HUE_OFFSET_MAX) {
+return -EINVAL;
+}
+
+iowrite32(offset, priv->base_addr + HUE_OFFSET);
+
+return size;
+}
+
+/**
+* latency_show() - Return the refresh latency of the last change to
+* user-space via sysfs.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that gets returned to user-space.
+*
+* The latency runs from the register write to the first bit of the frame
+* that shows it, in microseconds.
+*
+* Return: The number of bytes read.
+*/
+static ssize_t latency_show(struct device *dev,
+struct device_attribute *attr, char *buf)
+{
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+return scnprintf(buf, PAGE_SIZE, "%u\n",
+ioread32(priv->base_addr + LATENCY) / CYCLES_PER_US);
+}
+
+/**
+* latency_max_show() - Return the worst refresh latency to user-space via
+* sysfs.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that gets returned to user-space.
+*
+* Return: The number of bytes read.
+*/
+static ssize_t latency_max_show(struct device *dev,
+struct device_attribute *attr, char *buf)
+{
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+return scnprintf(buf, PAGE_SIZE, "%u\n",
+ioread32(priv->base_addr + LATENCY_MAX) / CYCLES_PER_US);
+}
+
+/**
+* latency_max_store() - Start measuring the worst refresh latency again.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Unused; any write clears the worst latency.
+* @size: The number of bytes being written.
+*
+* Return: The number of bytes stored.
+*/
+static ssize_t latency_max_store(struct device *dev,
+struct device_attribute *attr, const char *buf, size_t size)
+{
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+iowrite32(0, priv->base_addr + LATENCY_MAX);
+
+return size;
+}
+
+/**
+* ws2811_counter_show() - Return a counter of the component to user-space
+* via sysfs.
+* @dev: Device structure for the ws2811_controller component.
+* @offset: Offset of the counter register.
+* @buf: Buffer that gets returned to user-space.
+*
+* Return: The number of bytes read.
+*/
+static ssize_t ws2811_counter_show(struct device *dev, u32 offset, char *buf)
+{
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+return scnprintf(buf, PAGE_SIZE, "%u\n", ioread32(priv->base_addr + offset));
+}
+
+/**
+* ws2811_counter_store() - Clear a counter of the component.
+* @dev: Device structure for the ws2811_controller component.
+* @offset: Offset of the counter register.
+* @size: The number of bytes being written.
+*
+* Return: The number of bytes stored.
+*/
+static ssize_t ws2811_counter_store(struct device *dev, u32 offset, size_t size)
+{
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+iowrite32(0, priv->base_addr + offset);
+
+return size;
+}
+
+// Counters read as they are, and any write clears them.
+#define WS2811_COUNTER_ATTR(_name, _offset) \
+static ssize_t _name##_show(struct device *dev, \
+struct device_attribute *attr, char *buf) \
+{ \
+return ws2811_counter_show(dev, _offset, buf); \
+} \
+static ssize_t _name##_store(struct device *dev, \
+struct device_attribute *attr, const char *buf, size_t size) \
+{ \
+return ws2811_counter_store(dev, _offset, size); \
+} \
+static DEVICE_ATTR_RW(_name)
+
+WS2811_COUNTER_ATTR(stream_underflow, STREAM_UNDERFLOW);
+WS2811_COUNTER_ATTR(stream_backpressure, STREAM_BACKPRESSURE);
+
+/**
+* stream_level_show() - Return the beats waiting in the stream FIFO to
+* user-space via sysfs.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that gets returned to user-space.
+*
+* Return: The number of bytes read.
+*/
+static ssize_t stream_level_show(struct device *dev,
+struct device_attribute *attr, char *buf)
+{
+return ws2811_counter_show(dev, STREAM_LEVEL, buf);
+}
+
+/**
+* active_count_show() - Return the number of leds sent per frame
+* to user-space via sysfs.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that gets returned to user-space.
+*
+* Return: The number of bytes read.
+*/
+static ssize_t active_count_show(struct device *dev,
+struct device_attribute *attr, char *buf)
+{
+u32 active_count;
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+active_count = ioread32(priv->base_addr + ACTIVE_COUNT);
+if (active_count == 0 || active_count > priv->led_count) {
+active_count = priv->led_count;
+}
+
+return scnprintf(buf, PAGE_SIZE, "%u\n", active_count);
+}
+
+/**
+* active_count_store() - Store the number of leds sent per frame.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that contains the number of leds.
+* @size: The number of bytes being written.
+*
+* Leds past the active count are not sent and keep their last colour, and
+* the frame takes proportionally less time. 0 sends every led.
+*
+* Return: The number of bytes stored.
+*/
+static ssize_t active_count_store(struct device *dev,
+struct device_attribute *attr, const char *buf, size_t size)
+{
+u32 active_count;
+int ret;
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+ret = kstrtouint(buf, 0, &active_count);
+if (ret < 0) {
+return ret;
+}
+if (active_count > priv->led_count) {
+return -EINVAL;
+}
+
+iowrite32(active_count, priv->base_addr + ACTIVE_COUNT);
+
+return size;
+}
+
+/**
+* timing_show() - Return the name of the timing preset in use
+* to user-space via sysfs.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that gets returned to user-space.
+*
+* Return: The number of bytes read. "custom" is returned if the timing
+* registers don't match any preset.
+*/
+static ssize_t timing_show(struct device *dev,
+struct device_attribute *attr, char *buf)
+{
+const struct ws2811_timing *t;
+size_t i;
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+for (i = 0; i < ARRAY_SIZE(ws2811_timings); i++) {
+t = &ws2811_timings[i];
+if (ioread32(priv->base_addr + T0H) == t->t0h &&
+ioread32(priv->base_addr + T0L) == t->t0l &&
+ioread32(priv->base_addr + T1H) == t->t1h &&
+ioread32(priv->base_addr + T1L) == t->t1l &&
+ioread32(priv->base_addr + LATCH) == t->latch) {
+return scnprintf(buf, PAGE_SIZE, "%s\n", t->name);
+}
+}
+
+return scnprintf(buf, PAGE_SIZE, "custom\n");
+}
+
+/**
+* timing_store() - Load a timing preset.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that contains the preset name, e.g. "ws2812b".
+* @size: The number of bytes being written.
+*
+* Return: The number of bytes stored, or -EINVAL for an unknown preset.
+*/
+static ssize_t timing_store(struct device *dev,
+struct device_attribute *attr, const char *buf, size_t size)
+{
+const struct ws2811_timing *t;
+size_t i;
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+for (i = 0; i < ARRAY_SIZE(ws2811_timings); i++) {
+t = &ws2811_timings[i];
+if (sysfs_streq(buf, t->name)) {
+/*
+* The component picks the registers up at the end of a frame. If one
+* ends between these writes, one frame goes out with mixed timings.
+*/
+mutex_lock(&priv->lock);
+iowrite32(t->t0h, priv->base_addr + T0H);
+iowrite32(t->t0l, priv->base_addr + T0L);
+iowrite32(t->t1h, priv->base_addr + T1H);
+iowrite32(t->t1l, priv->base_addr + T1L);
+iowrite32(t->latch, priv->base_addr + LATCH);
+mutex_unlock(&priv->lock);
+return size;
+}
+}
+
+return -EINVAL;
+}
+
+/**
+* sprites_show() - Return the number of hardware sprites to user-space
+* via sysfs.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that gets returned to user-space.
+*
+* Return: The number of bytes read.
+*/
+static ssize_t sprites_show(struct device *dev,
+struct device_attribute *attr, char *buf)
+{
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+return scnprintf(buf, PAGE_SIZE, "%u\n", priv->sprites);
+}
+
+/**
+* sprite_show() - Return the sprite the sprite_* attributes access
+* to user-space via sysfs.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that gets returned to user-space.
+*
+* Return: The number of bytes read.
+*/
+static ssize_t sprite_show(struct device *dev,
+struct device_attribute *attr, char *buf)
+{
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+return scnprintf(buf, PAGE_SIZE, "%u\n", READ_ONCE(priv->sprite));
+}
+
+/**
+* sprite_store() - Select the sprite the sprite_* attributes access.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that contains the sprite number.
+* @size: The number of bytes being written.
+*
+* Return: The number of bytes stored.
+*/
+static ssize_t sprite_store(struct device *dev,
+struct device_attribute *attr, const char *buf, size_t size)
+{
+u32 sprite;
+int ret;
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+ret = kstrtouint(buf, 0, &sprite);
+if (ret < 0) {
+return ret;
+}
+if (sprite >= priv->sprites) {
+return -EINVAL;
+}
+
+WRITE_ONCE(priv->sprite, sprite);
+
+return size;
+}
+
+/**
+* segments_show() - Return the number of colour segments to user-space
+* via sysfs.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that gets returned to user-space.
+*
+* Return: The number of bytes read.
+*/
+static ssize_t segments_show(struct device *dev,
+struct device_attribute *attr, char *buf)
+{
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+return scnprintf(buf, PAGE_SIZE, "%u\n", priv->segments);
+}
+
+/**
+* segment_show() - Return the segment the segment_* attributes access
+* to user-space via sysfs.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that gets returned to user-space.
+*
+* Return: The number of bytes read.
+*/
+static ssize_t segment_show(struct device *dev,
+struct device_attribute *attr, char *buf)
+{
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+return scnprintf(buf, PAGE_SIZE, "%u\n", READ_ONCE(priv->segment));
+}
+
+/**
+* segment_store() - Select the segment the segment_* attributes access.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that contains the segment number.
+* @size: The number of bytes being written.
+*
+* Return: The number of bytes stored.
+*/
+static ssize_t segment_store(struct device *dev,
+struct device_attribute *attr, const char *buf, size_t size)
+{
+u32 segment;
+int ret;
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+ret = kstrtouint(buf, 0, &segment);
+if (ret < 0) {
+return ret;
+}
+if (segment >= priv->segments) {
+return -EINVAL;
+}
+
+WRITE_ONCE(priv->segment, segment);
+
+return size;
+}
+
+/**
+* ws2811_entry_show() - Return a register of a sprite, a segment or the
+* pattern generator to user-space via sysfs.
+* @priv: The device.
+* @offset: Offset of the register.
+* @buf: Buffer that gets returned to user-space.
+*
+* Return: The number of bytes read.
+*/
+static ssize_t ws2811_entry_show(struct ws2811_dev *priv, u32 offset, char *buf)
+{
+return scnprintf(buf, PAGE_SIZE, "%u\n", ioread32(priv->base_addr + offset));
+}
+
+/**
+* ws2811_entry_store() - Store a register of a sprite, a segment or the
+* pattern generator.
+* @priv: The device.
+* @offset: Offset of the register.
+* @buf: Buffer that contains the value being written.
+* @size: The number of bytes being written.
+*
+* Return: The number of bytes stored.
+*/
+static ssize_t ws2811_entry_store(struct ws2811_dev *priv, u32 offset,
+const char *buf, size_t size)
+{
+u32 val;
+int ret;
+
+ret = kstrtouint(buf, 0, &val);
+if (ret < 0) {
+return ret;
+}
+
+iowrite32(val, priv->base_addr + offset);
+
+return size;
+}
+
+/*
+* Attributes that access one register of the sprite or segment selected by
+* the sprite or segment attribute. Only the table and the offset differ.
+*/
+#define WS2811_ENTRY_ATTR(_name, _select, _base, _stride, _field) \
+static ssize_t _name##_show(struct device *dev, \
+struct device_attribute *attr, char *buf) \
+{ \
+struct ws2811_dev *priv = dev_get_drvdata(dev); \
+return ws2811_entry_show(priv, \
+_base + READ_ONCE(priv->_select) * _stride + _field, buf); \
+} \
+static ssize_t _name##_store(struct device *dev, \
+struct device_attribute *attr, const char *buf, size_t size) \
+{ \
+struct ws2811_dev *priv = dev_get_drvdata(dev); \
+return ws2811_entry_store(priv, \
+_base + READ_ONCE(priv->_select) * _stride + _field, buf, size); \
+} \
+static DEVICE_ATTR_RW(_name)
+
+WS2811_ENTRY_ATTR(sprite_position, sprite, SPRITE_BASE, SPRITE_STRIDE, SPRITE_POSITION);
+WS2811_ENTRY_ATTR(sprite_length, sprite, SPRITE_BASE, SPRITE_STRIDE, SPRITE_LENGTH);
+WS2811_ENTRY_ATTR(sprite_color, sprite, SPRITE_BASE, SPRITE_STRIDE, SPRITE_COLOR);
+WS2811_ENTRY_ATTR(segment_start, segment, SEGMENT_BASE, SEGMENT_STRIDE, SEGMENT_START);
+WS2811_ENTRY_ATTR(segment_length, segment, SEGMENT_BASE, SEGMENT_STRIDE, SEGMENT_LENGTH);
+WS2811_ENTRY_ATTR(segment_color, segment, SEGMENT_BASE, SEGMENT_STRIDE, SEGMENT_COLOR);
+
+/**
+* pattern_show() - Return the name of the pattern shown to user-space via
+* sysfs.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that gets returned to user-space.
+*
+* Return: The number of bytes read.
+*/
+static ssize_t pattern_show(struct device *dev,
+struct device_attribute *attr, char *buf)
+{
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+u32 pattern = ioread32(priv->base_addr + PATTERN);
+
+if (pattern >= ARRAY_SIZE(ws2811_patterns)) {
+return -EIO;
+}
+
+return scnprintf(buf, PAGE_SIZE, "%s\n", ws2811_patterns[pattern]);
+}
+
+/**
+* pattern_store() - Select the pattern the component draws by itself.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that contains the pattern name, e.g. "rainbow", or "off".
+* @size: The number of bytes being written.
+*
+* The pattern is drawn over the framebuffer or legacy registers, under
+* segments and sprites, from the next frame on.
+*
+* Return: The number of bytes stored, or -EINVAL for an unknown pattern.
+*/
+static ssize_t pattern_store(struct device *dev,
+struct device_attribute *attr, const char *buf, size_t size)
+{
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+int pattern;
+
+pattern = sysfs_match_string(ws2811_patterns, buf);
+if (pattern < 0) {
+return pattern;
+}
+
+iowrite32(pattern, priv->base_addr + PATTERN);
+
+return size;
+}
+
+/**
+* pattern_speed_show() - Return how far the pattern moves per frame to
+* user-space via sysfs.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that gets returned to user-space.
+*
+* Return: The number of bytes read.
+*/
+static ssize_t pattern_speed_show(struct device *dev,
+struct device_attribute *attr, char *buf)
+{
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+return scnprintf(buf, PAGE_SIZE, "%d\n", (s16)ioread32(priv->base_addr + PATTERN_SPEED));
+}
+
+/**
+* pattern_speed_store() - Store how far the pattern moves per frame.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Step per frame in 1/65536 of a cycle, -32768 to 32767; negative
+* steps go backwards and 0 stands still.
+* @size: The number of bytes being written.
+*
+* Return: The number of bytes stored.
+*/
+static ssize_t pattern_speed_store(struct device *dev,
+struct device_attribute *attr, const char *buf, size_t size)
+{
+s16 speed;
+int ret;
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+
+ret = kstrtos16(buf, 0, &speed);
+if (ret < 0) {
+return ret;
+}
+
+iowrite32((u16)speed, priv->base_addr + PATTERN_SPEED);
+
+return size;
+}
+
+// The remaining pattern attributes are plain registers: the step per LED
+// (16 bits) and the two colours.
+#define WS2811_PATTERN_ATTR(_name, _offset) \
+static ssize_t _name##_show(struct device *dev, \
+struct device_attribute *attr, char *buf) \
+{ \
+return ws2811_entry_show(dev_get_drvdata(dev), _offset, buf); \
+} \
+static ssize_t _name##_store(struct device *dev, \
+struct device_attribute *attr, const char *buf, size_t size) \
+{ \
+return ws2811_entry_store(dev_get_drvdata(dev), _offset, buf, size); \
+} \
+static DEVICE_ATTR_RW(_name)
+
+WS2811_PATTERN_ATTR(pattern_scale, PATTERN_SCALE);
+WS2811_PATTERN_ATTR(pattern_color, PATTERN_COLOR);
+WS2811_PATTERN_ATTR(pattern_color2, PATTERN_COLOR2);
+
+/**
+* sprite_period_show() - Return the step period of the selected sprite
+* to user-space via sysfs.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Buffer that gets returned to user-space.
+*
+* The period is shown in microseconds, negative if the sprite moves
+* backwards, with an "f" suffix if it is counted in frames instead.
+*
+* Return: The number of bytes read.
+*/
+static ssize_t sprite_period_show(struct device *dev,
+struct device_attribute *attr, char *buf)
+{
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+u32 offset = SPRITE_BASE + READ_ONCE(priv->sprite) * SPRITE_STRIDE + SPRITE_PERIOD;
+u32 period = ioread32(priv->base_addr + offset);
+
+return scnprintf(buf, PAGE_SIZE, "%s%u%s\n",
+(period & SPRITE_REVERSE) ? "-" : "",
+period & SPRITE_PERIOD_MASK,
+(period & SPRITE_FRAMES) ? "f" : "");
+}
+
+/**
+* sprite_period_store() - Set how fast the selected sprite moves.
+* @dev: Device structure for the ws2811_controller component.
+* @attr: Unused.
+* @buf: Microseconds per step, negative to move backwards, with an "f"
+* suffix to count frames instead. 0 stops the sprite.
+* @size: The number of bytes being written.
+*
+* Return: The number of bytes stored.
+*/
+static ssize_t sprite_period_store(struct device *dev,
+struct device_attribute *attr, const char *buf, size_t size)
+{
+char str[16];
+ssize_t len;
+s32 period;
+u32 val = 0;
+int ret;
+struct ws2811_dev *priv = dev_get_drvdata(dev);
+u32 offset = SPRITE_BASE + READ_ONCE(priv->sprite) * SPRITE_STRIDE + SPRITE_PERIOD;
+
+// Strip the newline and the optional "f" before parsing the number.
+len = strscpy(str, buf, sizeof(str));
+if (len < 0) {
+return -EINVAL;
+}
+if (len > 0 && str[len - 1] == '\n') {
+str[--len] = '\0';
+}
+if (len > 0 && str[len - 1] == 'f') {
+str[--len] = '\0';
+val |= SPRITE_FRAMES;
+}
+
+ret = kstrtos32(str, 0, &period);
+if (ret < 0) {
+return ret;
+}
+if (period > SPRITE_PERIOD_MASK || period < -SPRITE_PERIOD_MASK) {
+return -EINVAL;
+}
+if (period < 0) {
+val |= SPRITE_REVERSE;
+period = -period;
+}
+
+iowrite32(val | period, priv->base_addr + offset);
+
+return size;
+}
+
+// Define sysfs attributes
+static DEVICE_ATTR_RW(rgb_all);
+static DEVICE_ATTR_RW(rgb_single);
+static DEVICE_ATTR_RW(strip_index);
+static DEVICE_ATTR_RO(led_count);
+static DEVICE_ATTR_RO(channels);
+static DEVICE_ATTR_RW(timing);
+static DEVICE_ATTR_RW(active_count);
+static DEVICE_ATTR_RW(brightness);
+static DEVICE_ATTR_RW(hue_offset);
+static DEVICE_ATTR_RW(pattern);
+static DEVICE_ATTR_RW(pattern_speed);
+static DEVICE_ATTR_RO(stream_level);
+static DEVICE_ATTR_RO(latency);
+static DEVICE_ATTR_RW(latency_max);
+static DEVICE_ATTR_RO(sprites);
+static DEVICE_ATTR_RW(sprite);
+static DEVICE_ATTR_RW(sprite_period);
+static DEVICE_ATTR_RW(rotation);
+static DEVICE_ATTR_RW(rotation_step);
+static DEVICE_ATTR_RO(segments);
+static DEVICE_ATTR_RW(segment);
+
+// Create an attribute group so the device core can
+// export the attributes for us.
+static struct attribute *ws2811_attrs[] = {
+&dev_attr_rgb_all.attr,
+&dev_attr_rgb_single.attr,
+&dev_attr_strip_index.attr,
+&dev_attr_framebuffer.attr,
+&dev_attr_reverse.attr,
+&dev_attr_mirror.attr,
+&dev_attr_indexed.attr,
+&dev_attr_gamma.attr,
+&dev_attr_deep.attr,
+&dev_attr_dither.attr,
+&dev_attr_on_demand.attr,
+&dev_attr_hsv.attr,
+&dev_attr_latency.attr,
+&dev_attr_latency_max.attr,
+&dev_attr_brightness.attr,
+&dev_attr_hue_offset.attr,
+&dev_attr_pattern.attr,
+&dev_attr_pattern_speed.attr,
+&dev_attr_pattern_scale.attr,
+&dev_attr_pattern_color.attr,
+&dev_attr_pattern_color2.attr,
+&dev_attr_stream.attr,
+&dev_attr_stream_underflow.attr,
+&dev_attr_stream_backpressure.attr,
+&dev_attr_stream_level.attr,
+&dev_attr_rotation.attr,
+&dev_attr_rotation_step.attr,
+&dev_attr_led_count.attr,
+&dev_attr_channels.attr,
+&dev_attr_timing.attr,
+&dev_attr_t0h.attr,
+&dev_attr_t0l.attr,
+&dev_attr_t1h.attr,
+&dev_attr_t1l.attr,
+&dev_attr_latch.attr,
+&dev_attr_active_count.attr,
+&dev_attr_sprites.attr,
+&dev_attr_sprite.attr,
+&dev_attr_sprite_position.attr,
+&dev_attr_sprite_length.attr,
+&dev_attr_sprite_color.attr,
+&dev_attr_sprite_period.attr,
+&dev_attr_segments.attr,
+&dev_attr_segment.attr,
+&dev_attr_segment_start.attr,
+&dev_attr_segment_length.attr,
+&dev_attr_segment_color.attr,
+NULL,
+};
+ATTRIBUTE_GROUPS(ws2811);
+
+/**
+* ws2811_vsync_pending() - Check for the end of a frame this file hasn't seen.
+* @wf: Per-open state of the file.
+*
+* Return: true if a frame ended since @wf last consumed a vsync.
+*/
+static bool ws2811_vsync_pending(struct ws2811_file *wf)
+{
+return READ_ONCE(wf->priv->frames) != wf->seen;
+}
+
+/**
+* ws2811_read_vsync() - Wait for the end of a frame and return it to user space.
+* @file: Pointer to the char device file struct.
+* @buf: User-space buffer to copy the struct ws2811_vsync into.
+* @count: The number of bytes being requested.
+*
+* Blocks until a frame this file hasn't seen ends, unless the file was
+* opened with O_NONBLOCK. The file offset is not advanced, so repeated
+* reads keep waiting for frames.
+*
+* Return: sizeof(struct ws2811_vsync) on success, negative error value
+* otherwise.
+*/
+static ssize_t ws2811_read_vsync(struct file *file, char __user *buf,
+size_t count)
+{
+struct ws2811_file *wf = file->private_data;
+struct ws2811_dev *priv = wf->priv;
+struct ws2811_vsync vsync = { 0 };
+unsigned long flags;
+int ret;
+
+if (count < sizeof(vsync)) {
+return -EINVAL;
+}
+
+if (!ws2811_vsync_pending(wf)) {
+if (file->f_flags & O_NONBLOCK) {
+return -EAGAIN;
+}
+ret = wait_event_interruptible(priv->wait, ws2811_vsync_pending(wf));
+if (ret) {
+return ret;
+}
+}
+
+// Take a consistent snapshot of the frame count and its timestamp.
+spin_lock_irqsave(&priv->vsync_lock, flags);
+vsync.frames = priv->frames;
+vsync.timestamp_ns = ktime_to_ns(priv->frame_time);
+spin_unlock_irqrestore(&priv->vsync_lock, flags);
+
+wf->seen = vsync.frames;
+
+if (copy_to_user(buf, &vsync, sizeof(vsync))) {
+return -EFAULT;
+}
+
+return sizeof(vsync);
+}
+
+/**
+* ws2811_read() - Read method for the ws2811 char device
+* @file: Pointer to the char device file struct.
+* @buf: User-space buffer to read the value into.
+* @count: The number of bytes being requested.
+* @offset: The byte offset in the file being read from.
+*
+* Reading from WS2811_VSYNC_OFFSET waits for the end of a frame; see
+* ws2811_read_vsync().
+*
+* Return: On success, the number of bytes written is returned and the
+* offset @offset is advanced by this number. On error, a negative error
+* value is returned.
+*/
+static ssize_t ws2811_read(struct file *file, char __user *buf,
+size_t count, loff_t *offset)
+{
+size_t ret;
+u32 val;
+
+/*
+* Get the device's private data from the per-open state that
+* ws2811_open() stored in the file struct's private_data field.
+*/
+struct ws2811_file *wf = file->private_data;
+struct ws2811_dev *priv = wf->priv;
+
+// Reads from the vsync offset wait for a frame instead of reading a register.
+if (*offset == WS2811_VSYNC_OFFSET) {
+return ws2811_read_vsync(file, buf, count);
+}
+
+// Check file offset to make sure we are reading from a valid location.
+if (*offset < 0) {
+// We can't read from a negative file position.
+return -EINVAL;
+}
+if (*offset >= SPAN) {
+// We can't read from a position past the end of our device.
+return 0;
+}
+if ((*offset % 0x4) != 0) {
+// Prevent unaligned access.
+pr_warn("ws2811_read: unaligned access\n");
+return -EFAULT;
+}
+
+val = ioread32(priv->base_addr + *offset);
+
+// Copy the value to userspace.
+ret = copy_to_user(buf, &val, sizeof(val));
+if (ret == sizeof(val)) {
+pr_warn("ws2811_read: nothing copied\n");
+return -EFAULT;
+}
+
+// Increment the file offset by the number of bytes we read.
+*offset = *offset + sizeof(val);
+
+return sizeof(val);
+}
+
+/**
+* ws2811_write_strip_indexed() - Write palette indices through the logical
+* strip window
+* @priv: The device being written.
+* @buf: User-space buffer to read the indices from, one byte per LED.
+* @count: The number of bytes being written.
+* @offset: The byte offset in the file, at or past WS2811_STRIP_OFFSET.
+*
+* Byte n of the window is LED n % led_count of channel n / led_count. The
+* indices are packed four to a framebuffer word; a word that is only
+* partly written is read back first.
+*
+* Return: The number of bytes written, or a negative error value; -EBUSY
+* while a frame fetch has the framebuffer.
+*/
+static ssize_t ws2811_write_strip_indexed(struct ws2811_dev *priv,
+const char __user *buf, size_t count, loff_t *offset)
+{
+u8 indices[WRITE_CHUNK * sizeof(u32)];
+size_t size = priv->channels * priv->led_count;
+size_t pos = *offset - WS2811_STRIP_OFFSET;
+size_t bytes;
+size_t done = 0;
+size_t i;
+size_t n;
+size_t b;
+u32 led;
+u32 first;
+u32 word;
+void __iomem *addr;
+ssize_t ret = 0;
+
+if (pos >= size) {
+return 0;
+}
+
+count = min_t(size_t, count, size - pos);
+
+mutex_lock(&priv->lock);
+if (ioread32(priv->base_addr + DMA_STATUS) & DMA_BUSY) {
+mutex_unlock(&priv->lock);
+return -EBUSY;
+}
+
+while (done < count) {
+bytes = min_t(size_t, count - done, sizeof(indices));
+
+if (copy_from_user(indices, buf + done, bytes)) {
+pr_warn("ws2811_write: nothing copied from user space\n");
+ret = -EFAULT;
+break;
+}
+for (i = 0; i < bytes; i += n) {
+led = (pos + done + i) % priv->led_count;
+first = led % 4;
+addr = priv->base_addr + FRAMEBUFFER +
+(((pos + done + i) / priv->led_count) * priv->channel_stride +
+led / 4) * sizeof(u32);
+// indices for this word: up to the word's end, the channel's end
+// or the end of the chunk, whichever comes first
+n = min_t(size_t, 4 - first, priv->led_count - led);
+n = min_t(size_t, n, bytes - i);
+word = n == 4 ? 0 : ioread32(addr);
+for (b = 0; b < n; b++) {
+word &= ~(0xffu << (8 * (first + b)));
+word |= (u32) indices[i + b] << (8 * (first + b));
+}
+iowrite32(word, addr);
+}
+done += bytes;
+}
+
+mutex_unlock(&priv->lock);
+
+if (done == 0) {
+return ret;
+}
+
+*offset = *offset + done;
+
+return done;
+}
+
+/**
+* ws2811_write_strip() - Write LEDs through the logical strip window
+* @priv: The device being written.
+* @buf: User-space buffer to read the colours from.
+* @count: The number of bytes being written.
+* @offset: The byte offset in the file, at or past WS2811_STRIP_OFFSET.
+*
+* Word n of the window is LED n % led_count of channel n / led_count, so
+* the channels can be written as one long strip. In deep mode every LED
+* takes two words, so word n is word n % 2 of LED n / 2. That is also how
+* the component's pixel window lays out the back page, so when it is
+* mapped every chunk is a single memcpy_toio() through a write-combining
+* mapping, which the bridge can send as bursts; otherwise every word is
+* written to its bank on its own. The next register write, e.g. commit,
+* is ordered after the copy by iowrite32()'s barrier.
+*
+* Return: The number of bytes written, or a negative error value; -EBUSY
+* while a frame fetch has the framebuffer.
+*/
+static ssize_t ws2811_write_strip(struct ws2811_dev *priv,
+const char __user *buf, size_t count, loff_t *offset)
+{
+u32 vals[WRITE_CHUNK];
+u32 words_per_led = (ioread32(priv->ctrl) & CTRL_DEEP) ? 2 : 1;
+size_t size = priv->channels * priv->led_count * words_per_led * sizeof(u32);
+size_t pos = *offset - WS2811_STRIP_OFFSET;
+size_t words;
+size_t done = 0;
+size_t i;
+u32 word;
+u32 led;
+ssize_t ret = 0;
+
+if (pos >= size) {
+return 0;
+}
+if ((pos % 0x4) != 0) {
+pr_warn("ws2811_write: unaligned access\n");
+return -EFAULT;
+}
+
+count = min_t(size_t, count, size - pos) & ~(size_t) 0x3;
+if (count == 0) {
+return -EINVAL;
+}
+
+mutex_lock(&priv->lock);
+if (ioread32(priv->base_addr + DMA_STATUS) & DMA_BUSY) {
+mutex_unlock(&priv->lock);
+return -EBUSY;
+}
+
+while (done < count) {
+words = min_t(size_t, (count - done) / sizeof(u32), WRITE_CHUNK);
+
+if (copy_from_user(vals, buf + done, words * sizeof(u32))) {
+pr_warn("ws2811_write: nothing copied from user space\n");
+ret = -EFAULT;
+break;
+}
+if (priv->pixel_addr && size <= priv->pixel_size) {
+memcpy_toio(priv->pixel_addr + pos + done, vals, words * sizeof(u32));
+done += words * sizeof(u32);
+continue;
+}
+for (i = 0; i < words; i++) {
+word = (pos + done) / sizeof(u32) + i;
+led = word / words_per_led;
+iowrite32(vals[i], priv->base_addr + FRAMEBUFFER +
+((led / priv->led_count) * priv->channel_stride +
+(led % priv->led_count) * words_per_led + word % words_per_led) * sizeof(u32));
+}
+done += words * sizeof(u32);
+}
+
+mutex_unlock(&priv->lock);
+
+if (done == 0) {
+return ret;
+}
+
+*offset = *offset + done;
+
+return done;
+}
+
+/**
+* ws2811_write_fetch() - Have the component fetch a frame from memory
+* @priv: The device being written.
+* @buf: User-space buffer holding the number of the frame buffer, a u32.
+* @count: The number of bytes being written; must be 4.
+* @offset: The byte offset in the file, WS2811_DMA_OFFSET.
+*
+* The component copies the buffer into the back page over the
+* FPGA-to-SDRAM port and commits it once it is in, so the whole upload is
+* this one register write. If the port stops answering, the component
+* gives the fetch up by itself, commits nothing and sets DMA_ERROR. A read
+* the port hasn't taken stays asserted until it is, and the next fetch
+* waits for it and the words still owed before it starts.
+*
+* Return: 4, or a negative error value; -EBUSY if a fetch is on its way.
+*/
+static ssize_t ws2811_write_fetch(struct ws2811_dev *priv,
+const char __user *buf, size_t count, loff_t *offset)
+{
+u32 n;
+ssize_t ret = sizeof(n);
+
+if (*offset != WS2811_DMA_OFFSET || count != sizeof(n)) {
+return -EINVAL;
+}
+if (copy_from_user(&n, buf, sizeof(n))) {
+return -EFAULT;
+}
+if (n >= WS2811_DMA_BUFFERS) {
+return -EINVAL;
+}
+
+mutex_lock(&priv->lock);
+if (ioread32(priv->base_addr + DMA_STATUS) & DMA_BUSY) {
+ret = -EBUSY;
+} else {
+// iowrite32's barrier makes the buffer's contents visible first
+iowrite32(lower_32_bits(priv->dma_handle[n]) | DMA_COMMIT,
+priv->base_addr + DMA_ADDR);
+}
+mutex_unlock(&priv->lock);
+
+return ret;
+}
+
+/**
+* ws2811_write_rle() - Write run-length encoded LEDs
+* @priv: The device being written.
+* @buf: User-space buffer to read the runs from.
+* @count: The number of bytes being written.
+* @offset: The byte offset in the file, at or past WS2811_RLE_OFFSET.
+*
+* The runs are painted from LED (@offset - WS2811_RLE_OFFSET) / 4 on, by the
+* component's decoder, which holds the bus until each run has been written.
+* The decoder writes one 8-bit colour word per LED, which is not what the
+* framebuffer holds in deep or indexed mode, so runs are refused then.
+*
+* Return: The number of bytes written, or a negative error value: -EINVAL
+* in deep or indexed mode, -EBUSY while a frame fetch has the framebuffer.
+* @offset is moved to the LED after the last one painted.
+*/
+static ssize_t ws2811_write_rle(struct ws2811_dev *priv,
+const char __user *buf, size_t count, loff_t *offset)
+{
+u32 vals[WRITE_CHUNK];
+size_t pos = *offset - WS2811_RLE_OFFSET;
+size_t words;
+size_t done = 0;
+ssize_t ret = 0;
+
+if (pos / sizeof(u32) >= priv->channels * priv->led_count) {
+return 0;
+}
+if ((pos % 0x4) != 0) {
+pr_warn("ws2811_write: unaligned access\n");
+return -EFAULT;
+}
+
+count &= ~(size_t) 0x3;
+if (count == 0) {
+return -EINVAL;
+}
+if (ioread32(priv->ctrl) & (CTRL_DEEP | CTRL_INDEXED)) {
+return -EINVAL;
+}
+
+mutex_lock(&priv->lock);
+if (ioread32(priv->base_addr + DMA_STATUS) & DMA_BUSY) {
+mutex_unlock(&priv->lock);
+return -EBUSY;
+}
+
+iowrite32(pos / sizeof(u32), priv->base_addr + RLE_POS);
+while (done < count) {
+words = min_t(size_t, (count - done) / sizeof(u32), WRITE_CHUNK);
+
+if (copy_from_user(vals, buf + done, words * sizeof(u32))) {
+pr_warn("ws2811_write: nothing copied from user space\n");
+ret = -EFAULT;
+break;
+}
+iowrite32_rep(priv->base_addr + RLE_DATA, vals, words);
+done += words * sizeof(u32);
+}
+pos = ioread32(priv->base_addr + RLE_POS) * sizeof(u32);
+
+mutex_unlock(&priv->lock);
+
+if (done == 0) {
+return ret;
+}
+
+*offset = WS2811_RLE_OFFSET + pos;
+
+return done;
+}
+
+/**
+* ws2811_write() - Write method for the ws2811 char device
+* @file: Pointer to the char device file struct.
+* @buf: User-space buffer to read the value from.
+* @count: The number of bytes being written.
+* @offset: The byte offset in the file being written to.
+*
+* Consecutive 32-bit words are written to consecutive registers, so a whole
+* frame can be written to the framebuffer with one call. A write that
+* reaches the commit register marks every frame so far as seen by this
+* file, so the next vsync read returns once the committed page is shown.
+* Writes at WS2811_STRIP_OFFSET and past it go to ws2811_write_strip(), or
+* to ws2811_write_strip_indexed() in indexed mode, and writes at
+* WS2811_RLE_OFFSET and past it to ws2811_write_rle().
+*
+* Return: On success, the number of bytes written is returned and the
+* offset @offset is advanced by this number. On error, a negative error
+* value is returned.
+*/
+static ssize_t ws2811_write(struct file *file, const char __user *buf,
+size_t count, loff_t *offset)
+{
+u32 vals[WRITE_CHUNK];
+size_t words;
+size_t done = 0;
+size_t i;
+ssize_t ret = 0;
+
+struct ws2811_file *wf = file->private_data;
+struct ws2811_dev *priv = wf->priv;
+
+if (*offset < 0) {
+return -EINVAL;
+}
+if (*offset >= WS2811_DMA_OFFSET) {
+return ws2811_write_fetch(priv, buf, count, offset);
+}
+if (*offset >= WS2811_RLE_OFFSET) {
+return ws2811_write_rle(priv, buf, count, offset);
+}
+if (*offset >= WS2811_STRIP_OFFSET) {
+if (ioread32(priv->ctrl) & CTRL_INDEXED) {
+return ws2811_write_strip_indexed(priv, buf, count, offset);
+}
+return ws2811_write_strip(priv, buf, count, offset);
+}
+if (*offset >= SPAN) {
+return 0;
+}
+if ((*offset % 0x4) != 0) {
+pr_warn("ws2811_write: unaligned access\n");
+return -EFAULT;
+}
+
+// Only whole words are written, and never past the end of the device.
+count = min_t(size_t, count, SPAN - *offset) & ~(size_t) 0x3;
+if (count == 0) {
+return -EINVAL;
+}
+
+mutex_lock(&priv->lock);
+
+// Frames that end from here on may show the page being committed.
+if (*offset <= COMMIT && *offset + count > COMMIT) {
+wf->seen = READ_ONCE(priv->frames);
+}
+
+while (done < count) {
+words = min_t(size_t, (count - done) / sizeof(u32), WRITE_CHUNK);
+
+// Get the values from userspace.
+if (copy_from_user(vals, buf + done, words * sizeof(u32))) {
+pr_warn("ws2811_write: nothing copied from user space\n");
+ret = -EFAULT;
+break;
+}
+for (i = 0; i < words; i++) {
+iowrite32(vals[i], priv->base_addr + *offset + done + i * sizeof(u32));
+}
+done += words * sizeof(u32);
+}
+
+mutex_unlock(&priv->lock);
+
+// Report a partial write if some words made it to the component.
+if (done == 0) {
+return ret;
+}
+
+// Increment the file offset by the number of bytes we wrote.
+*offset = *offset + done;
+
+// Return the number of bytes we wrote.
+return done;
+}
+
+/**
+* ws2811_poll() - Poll method for the ws2811 char device
+* @file: Pointer to the char device file struct.
+* @wait: Poll table to register our wait queue with.
+*
+* Return: EPOLLIN | EPOLLRDNORM if a frame this file hasn't seen has ended.
+*/
+static __poll_t ws2811_poll(struct file *file, poll_table *wait)
+{
+struct ws2811_file *wf = file->private_data;
+
+poll_wait(file, &wf->priv->wait, wait);
+
+if (ws2811_vsync_pending(wf)) {
+return EPOLLIN | EPOLLRDNORM;
+}
+return 0;
+}
+
+/**
+* ws2811_open() - Open method for the ws2811 char device
+* @inode: Unused.
+* @file: Pointer to the char device file struct.
+*
+* Allocates the per-open state. Frames that ended before the file was
+* opened are not reported.
+*
+* Return: 0 on success, -ENOMEM otherwise.
+*/
+static int ws2811_open(struct inode *inode, struct file *file)
+{
+// misc_open() sets private_data to our miscdev.
+struct ws2811_dev *priv = container_of(file->private_data,
+struct ws2811_dev, miscdev);
+struct ws2811_file *wf;
+
+wf = kzalloc(sizeof(*wf), GFP_KERNEL);
+if (!wf) {
+return -ENOMEM;
+}
+wf->priv = priv;
+wf->seen = READ_ONCE(priv->frames);
+file->private_data = wf;
+
+return 0;
+}
+
+/**
+* ws2811_release() - Release method for the ws2811 char device
+* @inode: Unused.
+* @file: Pointer to the char device file struct.
+*
+* Return: 0.
+*/
+static int ws2811_release(struct inode *inode, struct file *file)
+{
+kfree(file->private_data);
+return 0;
+}
+
+/**
+* ws2811_mmap() - Mmap method for the ws2811 char device
+* @file: Pointer to the char device file struct.
+* @vma: User-space mapping being created.
+*
+* Maps the component's registers into user space so they can be accessed
+* without a system call per access. The mapping is uncached and covers the
+* whole page(s) the component lives in.
+*
+* Return: 0 on success, negative error value otherwise.
+*/
+static int ws2811_mmap(struct file *file, struct vm_area_struct *vma)
+{
+struct ws2811_file *wf = file->private_data;
+struct ws2811_dev *priv = wf->priv;
+unsigned long first = WS2811_DMA_OFFSET >> PAGE_SHIFT;
+unsigned long n;
+
+// the frame buffers, one per mapping
+if (vma->vm_pgoff >= first) {
+if ((vma->vm_pgoff - first) % (WS2811_DMA_SIZE >> PAGE_SHIFT) != 0) {
+return -EINVAL;
+}
+n = (vma->vm_pgoff - first) / (WS2811_DMA_SIZE >> PAGE_SHIFT);
+if (n >= WS2811_DMA_BUFFERS) {
+return -EINVAL;
+}
+vma->vm_pgoff = 0;
+return dma_mmap_coherent(priv->miscdev.parent, vma,
+priv->dma_buf[n], priv->dma_handle[n], WS2811_DMA_SIZE);
+}
+
+vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+
+// vm_iomap_memory checks the requested size and offset against the region.
+return vm_iomap_memory(vma, priv->phys_addr, priv->phys_size);
+}
+
+// events of the de10_ws2811 PMU, in config order
+static const struct de10_pmu_counter ws2811_counters[] = {
+{ "frames", FRAME_COUNT, 0, 32 },
+{ "bits", PERF_BITS, 0, 32 },
+{ "reads", PERF_READS, 0, 32 },
+{ "writes", PERF_WRITES, 0, 32 },
+{ "stalls", PERF_STALLS, 0, 32 },
+};
+
+/**
+* ws2811_fops - File operations supported by the
+* ws2811 driver
+* @owner: The ws2811 driver owns the file operations; this
+* ensures that the driver can't be removed while the
+* character device is still in use.
+* @read: The read function.
+* @write: The write function.
+* @llseek: We use the kernel's default_llseek() function; this allows
+* users to change what position they are writing/reading to/from.
+* @mmap: The mmap function.
+* @poll: The poll function; wakes up at the end of every frame.
+* @open: Allocates per-open state.
+* @release: Frees per-open state.
+*/
+static const struct file_operations ws2811_fops = {
+.owner = THIS_MODULE,
+.read = ws2811_read,
+.write = ws2811_write,
+.llseek = default_llseek,
+.mmap = ws2811_mmap,
+.poll = ws2811_poll,
+.open = ws2811_open,
+.release = ws2811_release,
+};
+
+/**
+* ws2811_isr() - Interrupt handler for the end of a frame
+* @irq: Unused.
+* @dev_id: The ws2811_dev that requested the interrupt.
+*
+* Acknowledges the interrupt, records when the frame ended and wakes up
+* blocked readers and pollers of the char device.
+*
+* Return: IRQ_HANDLED if our component raised the interrupt.
+*/
+static irqreturn_t ws2811_isr(int irq, void *dev_id)
+{
+struct ws2811_dev *priv = dev_id;
+ktime_t now = ktime_get();
+
+if (!(ioread32(priv->irq_ctrl) & IRQ_PENDING)) {
+return IRQ_NONE;
+}
+
+// The pending bit is write-1-to-clear; keep the interrupt enabled.
+iowrite32(IRQ_ENABLE | IRQ_PENDING, priv->irq_ctrl);
+
+spin_lock(&priv->vsync_lock);
+priv->frame_time = now;
+priv->frames++;
+spin_unlock(&priv->vsync_lock);
+
+wake_up_interruptible(&priv->wait);
+
+return IRQ_HANDLED;
+}
+
+static int ws2811_probe(struct platform_device *pdev)
+{
+
+size_t ret;
+int i;
+
+struct ws2811_dev *priv;
+struct resource *res;
+/*
+* Allocate kernel memory for the led patterns device and set it to 0.
+* GFP_KERNEL specifies that we are allocating normal kernel RAM;
+* see the kmalloc documentation for more info. The allocated memory
+* is automatically freed when the device is removed.
+*/
+priv = devm_kzalloc(&pdev->dev, sizeof(struct ws2811_dev),
+GFP_KERNEL);
+if (!priv) {
+pr_err("Failed to allocate memory\n");
+return -ENOMEM;
+}
+/*
+* Request and remap the device's memory region. Requesting the region
+* make sure nobody else can use that memory. The memory is remapped
+* into the kernel's virtual address space because we don't have access
+* to physical memory locations.
+*/
+priv->base_addr = devm_platform_get_and_ioremap_resource(pdev, 0, &res);
+if (IS_ERR(priv->base_addr)) {
+pr_err("Failed to request/remap platform device resource\n");
+return PTR_ERR(priv->base_addr);
+}
+// Remember the physical region so mmap can hand it to user space.
+priv->phys_addr = res->start;
+priv->phys_size = resource_size(res);
+/*
+* The pixel window is optional; without it strip writes go word by word.
+* It sits behind the full-width HPS-to-FPGA bridge and is mapped write
+* combining, so the CPU can merge consecutive stores into bursts.
+*/
+res = platform_get_resource(pdev, IORESOURCE_MEM, 1);
+if (res) {
+priv->pixel_addr = devm_ioremap_resource_wc(&pdev->dev, res);
+if (IS_ERR(priv->pixel_addr)) {
+pr_err("Failed to request/remap the pixel window\n");
+return PTR_ERR(priv->pixel_addr);
+}
+priv->pixel_size = resource_size(res);
+}
+/*
+* Frame buffers for the component to fetch from. It reaches memory through
+* the FPGA-to-SDRAM port with 32-bit addresses. The buffers are allocated
+* coherent (uncached on this SoC), so a frame written through mmap() needs
+* no cache maintenance before the fetch.
+*/
+ret = dma_set_mask_and_coherent(&pdev->dev, DMA_BIT_MASK(32));
+if (ret) {
+pr_err("No 32-bit DMA for the frame fetch\n");
+return ret;
+}
+for (i = 0; i < WS2811_DMA_BUFFERS; i++) {
+priv->dma_buf[i] = dmam_alloc_coherent(&pdev->dev, WS2811_DMA_SIZE,
+&priv->dma_handle[i], GFP_KERNEL);
+if (!priv->dma_buf[i]) {
+pr_err("Failed to allocate frame buffer %d\n", i);
+return -ENOMEM;
+}
+}
+// Set the memory addresses for each register.
+priv->rgb_all = priv->base_addr + RGB_ALL;
+priv->rgb_single = priv->base_addr + RGB_SINGLE;
+priv->strip_index = priv->base_addr + STRIP_INDEX;
+priv->ctrl = priv->base_addr + CTRL;
+priv->irq_ctrl = priv->base_addr + IRQ_CTRL;
+priv->led_count = ioread32(priv->base_addr + LED_COUNT);
+priv->channels = ioread32(priv->base_addr + CHANNELS);
+priv->channel_stride = ioread32(priv->base_addr + CHANNEL_STRIDE);
+priv->sprites = ioread32(priv->base_addr + SPRITES);
+priv->segments = ioread32(priv->base_addr + SEGMENTS);
+mutex_init(&priv->lock);
+spin_lock_init(&priv->vsync_lock);
+init_waitqueue_head(&priv->wait);
+// turn on red, just for fun.
+iowrite32(0xffff, priv->rgb_all);
+iowrite32(0x0, priv->rgb_single);
+iowrite32(0x0, priv->strip_index);
+iowrite32(0x0, priv->ctrl);
+
+/*
+* The frame-done interrupt fires at the end of every frame. Clear anything
+* left pending before enabling the interrupt in the component.
+*/
+priv->irq = platform_get_irq(pdev, 0);
+if (priv->irq < 0) {
+return priv->irq;
+}
+iowrite32(IRQ_PENDING, priv->irq_ctrl);
+ret = devm_request_irq(&pdev->dev, priv->irq, ws2811_isr, 0, "ws2811", priv);
+if (ret) {
+pr_err("Failed to request interrupt\n");
+return ret;
+}
+iowrite32(IRQ_ENABLE, priv->irq_ctrl);
+
+// Initialize the misc device parameters
+priv->miscdev.minor = MISC_DYNAMIC_MINOR;
+priv->miscdev.name = "ws2811";
+priv->miscdev.fops = &ws2811_fops;
+priv->miscdev.parent = &pdev->dev;
+
+// Register the misc device; this creates a char dev at /dev/ws2811
+ret = misc_register(&priv->miscdev);
+if (ret) {
+pr_err("Failed to register misc device");
+iowrite32(IRQ_PENDING, priv->irq_ctrl);
+return ret;
+}
+
+/* Attach the ws2811's private data to the platform device's struct.
+* This is so we can access our state container in the other functions.
+*/
+platform_set_drvdata(pdev, priv);
+
+// perf is a nice to have, so the device works without it
+ret = de10_pmu_register(&priv->pmu, &pdev->dev, "de10_ws2811", priv->base_addr,
+ws2811_counters, ARRAY_SIZE(ws2811_counters));
+if (ret) {
+pr_warn("Failed to register the de10_ws2811 PMU\n");
+}
+
+pr_info("ws2811_probe successful\n");
+return 0;
+}
+
+/**
+* ws2811_remove() - Remove an ws2811 device.
+* @pdev: Platform device structure associated with our ws2811 device.
+*
+* This function is called when an ws2811 devicee is removed or
+* the driver is removed.
+*/
+static int ws2811_remove(struct platform_device *pdev)
+{
+// Get the ws2811's private data from the platform device.
+struct ws2811_dev *priv = platform_get_drvdata(pdev);
+u32 i;
+
+// Turn off LED for kicks.
+iowrite32(0x0, priv->rgb_all);
 iowrite32(0x0, priv->rgb_single);
 iowrite32(0x0, priv->strip_index);
+iowrite32(0x0, priv->ctrl);
+iowrite32(0x0, priv->base_addr + ROTATE_STEP);
+iowrite32(0x0, priv->base_addr + ROTATE);
+for (i = 0; i < priv->sprites; i++) {
+iowrite32(0x0, priv->base_addr + SPRITE_BASE + i * SPRITE_STRIDE + SPRITE_LENGTH);
+}
+for (i = 0; i < priv->segments; i++) {
+iowrite32(0x0, priv->base_addr + SEGMENT_BASE + i * SEGMENT_STRIDE + SEGMENT_LENGTH);
+}
+// Stop the frame-done interrupt; devm frees the handler after remove.
+iowrite32(IRQ_PENDING, priv->irq_ctrl);
+
+de10_pmu_unregister(&priv->pmu);
 
 // Deregister the misc device and remove the /dev/led_patterns file.
 misc_deregister(&priv->miscdev);
@@ -256,7 +256,7 @@ architecture de10nano_arch of de10nano_top is
       rgb_pwm_green_out               : out   std_logic;
       rgb_pwm_blue_out                : out   std_logic;
 	   stop_button_stop_button         : in    std_logic:= 'X';      -- stop_button	
-		ws2811_driver_strip_output      : out   std_logic             -- strip_output
+		ws2811_driver_strip_output      : out   std_logic_vector(0 downto 0) -- strip_output
 	 );
   end component soc_system;
 
@@ -367,7 +367,7 @@ begin
 		stop_button_stop_button => gpio_1(1),
 		
 		-- PWM output
-		ws2811_driver_strip_output => gpio_0(6)
+		ws2811_driver_strip_output(0) => gpio_0(6)
 		
     );
 
@@ -81,7 +81,7 @@ set_interface_property pwm_rgb_controller_avalon_slave SVD_ADDRESS_GROUP ""
 
 add_interface_port pwm_rgb_controller_avalon_slave avs_read read Input 1
 add_interface_port pwm_rgb_controller_avalon_slave avs_write write Input 1
-add_interface_port pwm_rgb_controller_avalon_slave avs_address address Input 2
+add_interface_port pwm_rgb_controller_avalon_slave avs_address address Input 3
 add_interface_port pwm_rgb_controller_avalon_slave avs_readdata readdata Output 32
 add_interface_port pwm_rgb_controller_avalon_slave avs_writedata writedata Input 32
 set_interface_assignment pwm_rgb_controller_avalon_slave embeddedsw.configuration.isFlash 0
@@ -84,7 +84,7 @@ set_interface_property avalon_slave_0 SVD_ADDRESS_GROUP ""
 
 add_interface_port avalon_slave_0 avs_read read Input 1
 add_interface_port avalon_slave_0 avs_write write Input 1
-add_interface_port avalon_slave_0 avs_address address Input 1
+add_interface_port avalon_slave_0 avs_address address Input 4
 add_interface_port avalon_slave_0 avs_readdata readdata Output 32
 add_interface_port avalon_slave_0 avs_writedata writedata Input 32
 set_interface_assignment avalon_slave_0 embeddedsw.configuration.isFlash 0
@@ -93,6 +93,24 @@ set_interface_assignment avalon_slave_0 embeddedsw.configuration.isNonVolatileSt
 set_interface_assignment avalon_slave_0 embeddedsw.configuration.isPrintableDevice 0
 
 
+# 
+# connection point irq
+# 
+add_interface irq interrupt end
+set_interface_property irq associatedAddressablePoint avalon_slave_0
+set_interface_property irq associatedClock clk
+set_interface_property irq associatedReset rst
+set_interface_property irq bridgedReceiverOffset ""
+set_interface_property irq bridgesToReceiver ""
+set_interface_property irq ENABLED true
+set_interface_property irq EXPORT_OF ""
+set_interface_property irq PORT_NAME_MAP ""
+set_interface_property irq CMSIS_SVD_VARIABLES ""
+set_interface_property irq SVD_ADDRESS_GROUP ""
+
+add_interface_port irq irq irq Output 1
+
+
 # 
 # connection point clk
 # 
@@ -136,3 +154,17 @@ set_interface_property output SVD_ADDRESS_GROUP ""
 
 add_interface_port output stop_button stop_button Input 1
 
+# 
+# connection point position
+# 
+add_interface position conduit end
+set_interface_property position associatedClock clk
+set_interface_property position associatedReset ""
+set_interface_property position ENABLED true
+set_interface_property position EXPORT_OF ""
+set_interface_property position PORT_NAME_MAP ""
+set_interface_property position CMSIS_SVD_VARIABLES ""
+set_interface_property position SVD_ADDRESS_GROUP ""
+
+add_interface_port position strip_index strip_index Input 32
+
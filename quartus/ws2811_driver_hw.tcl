@@ -40,12 +40,64 @@ set_fileset_property QUARTUS_SYNTH TOP_LEVEL ws_2811_driver_avalon
 set_fileset_property QUARTUS_SYNTH ENABLE_RELATIVE_INCLUDE_PATHS false
 set_fileset_property QUARTUS_SYNTH ENABLE_FILE_OVERWRITE_MODE false
 add_fileset_file ws2811_driver.vhd VHDL PATH ../hdl/ws2811_driver/ws2811_driver.vhd
+add_fileset_file pixel_ram.vhd VHDL PATH ../hdl/ws2811_driver/pixel_ram.vhd
+add_fileset_file sprite_engine.vhd VHDL PATH ../hdl/ws2811_driver/sprite_engine.vhd
+add_fileset_file segment_table.vhd VHDL PATH ../hdl/ws2811_driver/segment_table.vhd
+add_fileset_file colour_correction.vhd VHDL PATH ../hdl/ws2811_driver/colour_correction.vhd
+add_fileset_file temporal_dither.vhd VHDL PATH ../hdl/ws2811_driver/temporal_dither.vhd
+add_fileset_file hsv_to_rgb.vhd VHDL PATH ../hdl/ws2811_driver/hsv_to_rgb.vhd
+add_fileset_file pattern_generator.vhd VHDL PATH ../hdl/ws2811_driver/pattern_generator.vhd
+add_fileset_file pixel_stream.vhd VHDL PATH ../hdl/ws2811_driver/pixel_stream.vhd
+add_fileset_file pixel_window.vhd VHDL PATH ../hdl/ws2811_driver/pixel_window.vhd
+add_fileset_file frame_fetch.vhd VHDL PATH ../hdl/ws2811_driver/frame_fetch.vhd
 add_fileset_file ws2811_driver_avalon.vhd VHDL PATH ../hdl/ws2811_driver/ws2811_driver_avalon.vhd TOP_LEVEL_FILE
 
 
 # 
 # parameters
 # 
+add_parameter LED_COUNT INTEGER 250
+set_parameter_property LED_COUNT DEFAULT_VALUE 250
+set_parameter_property LED_COUNT DISPLAY_NAME LED_COUNT
+set_parameter_property LED_COUNT TYPE INTEGER
+set_parameter_property LED_COUNT UNITS None
+set_parameter_property LED_COUNT ALLOWED_RANGES 1:8192
+set_parameter_property LED_COUNT HDL_PARAMETER true
+add_parameter CHANNELS INTEGER 1
+set_parameter_property CHANNELS DEFAULT_VALUE 1
+set_parameter_property CHANNELS DISPLAY_NAME CHANNELS
+set_parameter_property CHANNELS TYPE INTEGER
+set_parameter_property CHANNELS UNITS None
+set_parameter_property CHANNELS ALLOWED_RANGES 1:8
+set_parameter_property CHANNELS HDL_PARAMETER true
+add_parameter SPRITES INTEGER 4
+set_parameter_property SPRITES DEFAULT_VALUE 4
+set_parameter_property SPRITES DISPLAY_NAME SPRITES
+set_parameter_property SPRITES TYPE INTEGER
+set_parameter_property SPRITES UNITS None
+set_parameter_property SPRITES ALLOWED_RANGES 1:16
+set_parameter_property SPRITES HDL_PARAMETER true
+add_parameter SEGMENTS INTEGER 8
+set_parameter_property SEGMENTS DEFAULT_VALUE 8
+set_parameter_property SEGMENTS DISPLAY_NAME SEGMENTS
+set_parameter_property SEGMENTS TYPE INTEGER
+set_parameter_property SEGMENTS UNITS None
+set_parameter_property SEGMENTS ALLOWED_RANGES 1:16
+set_parameter_property SEGMENTS HDL_PARAMETER true
+add_parameter DEEP_COLOUR INTEGER 1
+set_parameter_property DEEP_COLOUR DEFAULT_VALUE 1
+set_parameter_property DEEP_COLOUR DISPLAY_NAME DEEP_COLOUR
+set_parameter_property DEEP_COLOUR TYPE INTEGER
+set_parameter_property DEEP_COLOUR UNITS None
+set_parameter_property DEEP_COLOUR ALLOWED_RANGES 0:1
+set_parameter_property DEEP_COLOUR HDL_PARAMETER true
+add_parameter STREAM_DEPTH INTEGER 512
+set_parameter_property STREAM_DEPTH DEFAULT_VALUE 512
+set_parameter_property STREAM_DEPTH DISPLAY_NAME STREAM_DEPTH
+set_parameter_property STREAM_DEPTH TYPE INTEGER
+set_parameter_property STREAM_DEPTH UNITS None
+set_parameter_property STREAM_DEPTH ALLOWED_RANGES {16 32 64 128 256 512 1024 2048 4096}
+set_parameter_property STREAM_DEPTH HDL_PARAMETER true
 
 
 # 
@@ -69,7 +121,7 @@ set_interface_property avalon_slave_0 linewrapBursts false
 set_interface_property avalon_slave_0 maximumPendingReadTransactions 0
 set_interface_property avalon_slave_0 maximumPendingWriteTransactions 0
 set_interface_property avalon_slave_0 readLatency 0
-set_interface_property avalon_slave_0 readWaitTime 1
+set_interface_property avalon_slave_0 readWaitTime 0
 set_interface_property avalon_slave_0 setupTime 0
 set_interface_property avalon_slave_0 timingUnits Cycles
 set_interface_property avalon_slave_0 writeWaitTime 0
@@ -81,15 +133,116 @@ set_interface_property avalon_slave_0 SVD_ADDRESS_GROUP ""
 
 add_interface_port avalon_slave_0 avs_read read Input 1
 add_interface_port avalon_slave_0 avs_write write Input 1
-add_interface_port avalon_slave_0 avs_address address Input 2
+add_interface_port avalon_slave_0 avs_address address Input 14
 add_interface_port avalon_slave_0 avs_readdata readdata Output 32
 add_interface_port avalon_slave_0 avs_writedata writedata Input 32
+add_interface_port avalon_slave_0 avs_waitrequest waitrequest Output 1
 set_interface_assignment avalon_slave_0 embeddedsw.configuration.isFlash 0
 set_interface_assignment avalon_slave_0 embeddedsw.configuration.isMemoryDevice 0
 set_interface_assignment avalon_slave_0 embeddedsw.configuration.isNonVolatileStorage 0
 set_interface_assignment avalon_slave_0 embeddedsw.configuration.isPrintableDevice 0
 
 
+# 
+# connection point pixel_slave
+# 
+add_interface pixel_slave avalon end
+set_interface_property pixel_slave addressUnits WORDS
+set_interface_property pixel_slave associatedClock clk
+set_interface_property pixel_slave associatedReset rst
+set_interface_property pixel_slave bitsPerSymbol 8
+set_interface_property pixel_slave burstOnBurstBoundariesOnly false
+set_interface_property pixel_slave burstcountUnits WORDS
+set_interface_property pixel_slave explicitAddressSpan 0
+set_interface_property pixel_slave holdTime 0
+set_interface_property pixel_slave linewrapBursts false
+set_interface_property pixel_slave maximumPendingReadTransactions 1
+set_interface_property pixel_slave maximumPendingWriteTransactions 0
+set_interface_property pixel_slave readLatency 0
+set_interface_property pixel_slave readWaitTime 0
+set_interface_property pixel_slave setupTime 0
+set_interface_property pixel_slave timingUnits Cycles
+set_interface_property pixel_slave writeWaitTime 0
+set_interface_property pixel_slave ENABLED true
+set_interface_property pixel_slave EXPORT_OF ""
+set_interface_property pixel_slave PORT_NAME_MAP ""
+set_interface_property pixel_slave CMSIS_SVD_VARIABLES ""
+set_interface_property pixel_slave SVD_ADDRESS_GROUP ""
+
+add_interface_port pixel_slave avp_read read Input 1
+add_interface_port pixel_slave avp_write write Input 1
+add_interface_port pixel_slave avp_address address Input 13
+add_interface_port pixel_slave avp_burstcount burstcount Input 8
+add_interface_port pixel_slave avp_readdata readdata Output 32
+add_interface_port pixel_slave avp_readdatavalid readdatavalid Output 1
+add_interface_port pixel_slave avp_writedata writedata Input 32
+add_interface_port pixel_slave avp_byteenable byteenable Input 4
+add_interface_port pixel_slave avp_waitrequest waitrequest Output 1
+set_interface_assignment pixel_slave embeddedsw.configuration.isFlash 0
+set_interface_assignment pixel_slave embeddedsw.configuration.isMemoryDevice 1
+set_interface_assignment pixel_slave embeddedsw.configuration.isNonVolatileStorage 0
+set_interface_assignment pixel_slave embeddedsw.configuration.isPrintableDevice 0
+
+
+# 
+# connection point dma_master
+# 
+add_interface dma_master avalon start
+set_interface_property dma_master addressUnits SYMBOLS
+set_interface_property dma_master associatedClock clk
+set_interface_property dma_master associatedReset rst
+set_interface_property dma_master bitsPerSymbol 8
+set_interface_property dma_master burstOnBurstBoundariesOnly false
+set_interface_property dma_master burstcountUnits WORDS
+set_interface_property dma_master doStreamReads false
+set_interface_property dma_master doStreamWrites false
+set_interface_property dma_master holdTime 0
+set_interface_property dma_master linewrapBursts false
+set_interface_property dma_master maximumPendingReadTransactions 0
+set_interface_property dma_master maximumPendingWriteTransactions 0
+set_interface_property dma_master readLatency 0
+set_interface_property dma_master readWaitTime 1
+set_interface_property dma_master setupTime 0
+set_interface_property dma_master timingUnits Cycles
+set_interface_property dma_master writeWaitTime 0
+set_interface_property dma_master ENABLED true
+set_interface_property dma_master EXPORT_OF ""
+set_interface_property dma_master PORT_NAME_MAP ""
+set_interface_property dma_master CMSIS_SVD_VARIABLES ""
+set_interface_property dma_master SVD_ADDRESS_GROUP ""
+
+add_interface_port dma_master avm_address address Output 32
+add_interface_port dma_master avm_read read Output 1
+add_interface_port dma_master avm_burstcount burstcount Output 5
+add_interface_port dma_master avm_readdata readdata Input 32
+add_interface_port dma_master avm_readdatavalid readdatavalid Input 1
+add_interface_port dma_master avm_waitrequest waitrequest Input 1
+
+
+# 
+# connection point pixel_sink
+# 
+add_interface pixel_sink avalon_streaming end
+set_interface_property pixel_sink associatedClock clk
+set_interface_property pixel_sink associatedReset rst
+set_interface_property pixel_sink dataBitsPerSymbol 8
+set_interface_property pixel_sink errorDescriptor ""
+set_interface_property pixel_sink firstSymbolInHighOrderBits true
+set_interface_property pixel_sink maxChannel 0
+set_interface_property pixel_sink readyLatency 0
+set_interface_property pixel_sink ENABLED true
+set_interface_property pixel_sink EXPORT_OF ""
+set_interface_property pixel_sink PORT_NAME_MAP ""
+set_interface_property pixel_sink CMSIS_SVD_VARIABLES ""
+set_interface_property pixel_sink SVD_ADDRESS_GROUP ""
+
+add_interface_port pixel_sink asi_data data Input "24 * CHANNELS"
+add_interface_port pixel_sink asi_valid valid Input 1
+add_interface_port pixel_sink asi_ready ready Output 1
+add_interface_port pixel_sink asi_startofpacket startofpacket Input 1
+add_interface_port pixel_sink asi_endofpacket endofpacket Input 1
+
+
 # 
 # connection point rst
 # 
@@ -119,6 +272,24 @@ set_interface_property clk SVD_ADDRESS_GROUP ""
 add_interface_port clk clk clk Input 1
 
 
+# 
+# connection point irq
+# 
+add_interface irq interrupt end
+set_interface_property irq associatedAddressablePoint avalon_slave_0
+set_interface_property irq associatedClock clk
+set_interface_property irq associatedReset rst
+set_interface_property irq bridgedReceiverOffset ""
+set_interface_property irq bridgesToReceiver ""
+set_interface_property irq ENABLED true
+set_interface_property irq EXPORT_OF ""
+set_interface_property irq PORT_NAME_MAP ""
+set_interface_property irq CMSIS_SVD_VARIABLES ""
+set_interface_property irq SVD_ADDRESS_GROUP ""
+
+add_interface_port irq irq irq Output 1
+
+
 # 
 # connection point export
 # 
@@ -131,5 +302,19 @@ set_interface_property export PORT_NAME_MAP ""
 set_interface_property export CMSIS_SVD_VARIABLES ""
 set_interface_property export SVD_ADDRESS_GROUP ""
 
-add_interface_port export strip_output strip_output Output 1
+add_interface_port export strip_output strip_output Output CHANNELS
+
+# 
+# connection point position
+# 
+add_interface position conduit end
+set_interface_property position associatedClock clk
+set_interface_property position associatedReset ""
+set_interface_property position ENABLED true
+set_interface_property position EXPORT_OF ""
+set_interface_property position PORT_NAME_MAP ""
+set_interface_property position CMSIS_SVD_VARIABLES ""
+set_interface_property position SVD_ADDRESS_GROUP ""
+
+add_interface_port position strip_index_out strip_index Output 32
 
@@ -0,0 +1,134 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <system_error>
+#include <time.h>
+
+#include "de10nano_hal.hpp"
+
+/*
+* Upload time per frame for the ws2811 framebuffer written a word at a time
+* through the register slave on the lightweight bridge, and written through
+* the pixel window on the full-width HPS-to-FPGA bridge, which takes bursts.
+*
+* Usage: burst_bench [frames] [leds] device
+*
+* Needs the board: pass /dev/ws2811. A frame is leds LEDs on every channel
+* (default led_count), so leds must not be more than led_count. Three
+* paths are timed:
+*   single: pwrite() to each channel's bank; the driver writes every word
+*           to the register slave with its own iowrite32()
+*   mapped: the register slave mmap()ed, one store per word
+*   window: write_strip() of all channels at once; with the pixel window in
+*           the device tree the driver copies each chunk into it with
+*           memcpy_toio()
+*   fetch:  the frame copied into a frame buffer in memory, and fetched by
+*           the component over the FPGA-to-SDRAM port; timed until the
+*           fetch is done, and stops the benchmark if it was given up
+* With leds below led_count only the window and fetch paths are contiguous,
+* so they move led_count LEDs per channel, which counts against them.
+* The back page of the framebuffer is overwritten, but nothing is committed.
+*/
+
+using de10::ws2811;
+
+/**
+* seconds_since() - Wall-clock seconds elapsed since @start.
+*/
+static double seconds_since(const struct timespec &start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/**
+* upload() - Time @frames uploads of @words words through one path.
+* @write: Writes one frame.
+* @words: Words per frame.
+* @frames: Number of frames.
+*
+* Return: Frames per second.
+*/
+template <typename Write>
+static double upload(Write write, std::size_t words, long frames)
+{
+    std::vector<std::uint32_t> frame(words);
+    struct timespec start;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long f = 0; f < frames; f++) {
+        // something different every frame, as an animation would
+        for (std::size_t i = 0; i < words; i++) {
+            frame[i] = static_cast<std::uint32_t>(f + i) & 0xffffff;
+        }
+        write(frame.data(), words);
+    }
+    return frames / seconds_since(start);
+}
+
+/**
+* report() - Print one path's line of the report.
+*/
+static void report(const char *name, std::size_t words, double fps)
+{
+    printf("%-8s %14.0f %10.2f\n", name, fps, fps * words * sizeof(std::uint32_t) / 1e6);
+}
+
+int main(int argc, char **argv) try {
+    long frames = argc > 1 ? strtol(argv[1], nullptr, 0) : 10000;
+
+    if (argc <= 3) {
+        printf("usage: burst_bench [frames] [leds] device\n");
+        return 1;
+    }
+
+    de10::chardev<ws2811> dev(argv[3]);
+    de10::mapped<ws2811> map(argv[3]);
+    std::size_t led_count = dev.read(ws2811::led_count);
+    std::size_t channels = dev.read(ws2811::channels);
+    std::size_t stride = dev.read(ws2811::channel_stride) * sizeof(std::uint32_t);
+    std::size_t leds = strtoul(argv[2], nullptr, 0);
+
+    if (leds == 0 || leds > led_count) {
+        leds = led_count;
+    }
+
+    printf("%ld frames of %zu leds on %zu channels against %s\n\n", frames, leds,
+           channels, argv[3]);
+    printf("%-8s %14s %10s\n", "path", "frames/s", "MB/s");
+    report("single", channels * leds, upload([&](const std::uint32_t *vals, std::size_t) {
+        for (std::size_t c = 0; c < channels; c++) {
+            dev.write_words(ws2811::framebuffer + c * stride, vals + c * leds, leds);
+        }
+    }, channels * leds, frames));
+    report("mapped", channels * leds, upload([&](const std::uint32_t *vals, std::size_t) {
+        for (std::size_t c = 0; c < channels; c++) {
+            map.write_words(ws2811::framebuffer + c * stride, vals + c * leds, leds);
+        }
+    }, channels * leds, frames));
+    report("window", channels * led_count, upload([&](const std::uint32_t *vals, std::size_t n) {
+        de10::write_strip(dev, vals, n);
+    }, channels * led_count, frames));
+
+    de10::frame_buffer buffer(dev, 0);
+    report("fetch", channels * led_count, upload([&](const std::uint32_t *vals, std::size_t n) {
+        memcpy(buffer.words(), vals, n * sizeof(*vals));
+        while (!de10::fetch_frame(dev, 0)) {
+        }
+        while (map.read(ws2811::dma_status) & ws2811::dma_busy) {
+        }
+        if (map.read(ws2811::dma_status) & ws2811::dma_error) {
+            throw std::system_error(EIO, std::generic_category(), "frame fetch");
+        }
+    }, channels * led_count, frames));
+
+    return 0;
+}
+catch (const std::system_error &e) {
+    printf("failed to access %s\n", e.what());
+    exit(1);
+}
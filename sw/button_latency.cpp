@@ -0,0 +1,52 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <system_error>
+#include <time.h>
+
+#include "de10nano_hal.hpp"
+
+/*
+* Measures how long it takes from the stop button interrupt to a blocked
+* user-space reader waking up. The driver timestamps each press in its hard
+* interrupt handler with CLOCK_MONOTONIC; this program blocks in poll(),
+* reads the event and compares that timestamp with the time it woke up.
+*
+* Usage: button_latency [presses]
+*/
+
+using de10::stop_button;
+
+int main(int argc, char **argv) try {
+    long presses = argc > 1 ? strtol(argv[1], nullptr, 0) : 10;
+    de10::chardev<stop_button> dev_stop_button;
+    struct stop_button_event press;
+    double min_us = 1e9, max_us = 0, total_us = 0;
+
+    printf("press the stop button %ld times\n\n", presses);
+    for (long i = 0; i < presses; i++) {
+        if (!de10::wait_press(dev_stop_button, -1, &press)) {
+            printf("interrupted\n");
+            return 1;
+        }
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double us = ((now.tv_sec * 1000000000LL + now.tv_nsec) - (long long) press.timestamp_ns) / 1e3;
+
+        printf("press %u: irq to wakeup %.1f us\n", press.presses, us);
+        min_us = us < min_us ? us : min_us;
+        max_us = us > max_us ? us : max_us;
+        total_us += us;
+
+        // reset the button like game_play does
+        de10::read_clear(dev_stop_button);
+    }
+
+    printf("\nmin %.1f us, avg %.1f us, max %.1f us\n", min_us, total_us / presses, max_us);
+    return 0;
+}
+catch (const std::system_error &e) {
+    printf("failed to access %s\n", e.what());
+    exit(1);
+}
@@ -0,0 +1,750 @@
+#ifndef DE10NANO_HAL_HPP
+#define DE10NANO_HAL_HPP
+
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "../linux/stop_button/stop_button.h"
+#include "../linux/ws2811_driver/ws2811.h"
+
+/*
+* Header-only access layer for the character devices created by the drivers
+* in linux/. Every register is described at compile time by its offset and
+* access rights, so a bad offset or a write to a read-only register fails to
+* compile instead of failing at run time. A device keeps its file descriptor
+* open for the life of the object. Two access paths share the same interface:
+*
+* - chardev: each register access is exactly one pread()/pwrite() system
+*   call; no stdio buffering, no seeking, no flushing.
+* - mapped: the registers are mmap()ed once and each access is a single
+*   volatile load or store, with no system call at all.
+*/
+namespace de10 {
+
+enum class access { ro, wo, rw };
+
+/**
+* struct reg - Compile-time description of a 32-bit register.
+* @Offset: Byte offset of the register from the component's base address.
+* @Access: Whether the register can be read, written or both.
+* @Mask: Bits of the register that hold the value.
+*
+* Registers are empty constexpr objects passed to read() and write(), e.g.
+* dev.write(ws2811::strip_index, 3); the offset is folded in at compile time.
+*/
+template <std::uint32_t Offset, access Access = access::rw, std::uint32_t Mask = 0xffffffff>
+struct reg {
+    static_assert(Offset % 4 == 0, "registers are 32-bit aligned");
+
+    static constexpr std::uint32_t offset = Offset;
+    static constexpr std::uint32_t mask = Mask;
+    static constexpr bool readable = Access != access::wo;
+    static constexpr bool writable = Access != access::ro;
+};
+
+// register map of linux/adc/de10nano_adc.c
+struct adc {
+    static constexpr const char *path = "/dev/adc";
+    static constexpr std::uint32_t span = 32;
+
+    static constexpr reg<0x0, access::wo> update{};
+    static constexpr reg<0x4, access::wo> auto_update{};
+    // ADC values are in the 12 least-significant bits of the registers
+    static constexpr reg<0x0, access::ro, 0xfff> ch0{};
+    static constexpr reg<0x4, access::ro, 0xfff> ch1{};
+    static constexpr reg<0x8, access::ro, 0xfff> ch2{};
+    static constexpr reg<0xc, access::ro, 0xfff> ch3{};
+    static constexpr reg<0x10, access::ro, 0xfff> ch4{};
+    static constexpr reg<0x14, access::ro, 0xfff> ch5{};
+    static constexpr reg<0x18, access::ro, 0xfff> ch6{};
+    static constexpr reg<0x1c, access::ro, 0xfff> ch7{};
+};
+
+// register map of linux/pwm_rgb_controller/pwm_rgb.c
+struct pwm_rgb {
+    static constexpr const char *path = "/dev/pwm_rgb";
+    static constexpr std::uint32_t span = 32;
+
+    static constexpr reg<0x0> duty_red{};
+    static constexpr reg<0x4> duty_green{};
+    static constexpr reg<0x8> duty_blue{};
+    // the driver calls this 0x12, but the component decodes it at word 3
+    static constexpr reg<0xc> base_period{};
+    // free-running counts of bus reads and writes; de10_pwm_rgb in perf
+    static constexpr reg<0x10, access::ro> perf_reads{};
+    static constexpr reg<0x14, access::ro> perf_writes{};
+};
+
+// register map of linux/stop_button/stop_button.c
+struct stop_button {
+    static constexpr const char *path = "/dev/stop_button";
+    static constexpr std::uint32_t span = 64;
+
+    static constexpr reg<0x0> stop{};
+    // bit 0: interrupt enable; bit 1: interrupt pending (write 1 to clear)
+    static constexpr reg<0x4> irq_ctrl{};
+    // bit 0: latched press, bit 1: win (write 1 to clear); bits 31-16: press count
+    static constexpr reg<0x8> status{};
+    // strip_index captured by the FPGA at the last press
+    static constexpr reg<0xc, access::ro> hit_index{};
+    // a press with win_lo <= strip_index <= win_hi is a win
+    static constexpr reg<0x10> win_lo{};
+    static constexpr reg<0x14> win_hi{};
+    // free-running counts of bus reads and writes; de10_stop_button in perf
+    static constexpr reg<0x18, access::ro> perf_reads{};
+    static constexpr reg<0x1c, access::ro> perf_writes{};
+    // status, cleared by the read, and the hit_index that went with it;
+    // the driver's read_clear() uses them, so don't read press yourself
+    static constexpr reg<0x20, access::ro> press{};
+    static constexpr reg<0x24, access::ro> press_hit{};
+};
+
+// register map of linux/ws2811_driver/ws2811_driver.c
+struct ws2811 {
+    static constexpr const char *path = "/dev/ws2811";
+    static constexpr std::uint32_t span = 0x10000;
+
+    // the led at strip_index, and every other led
+    static constexpr reg<0x0> rgb_single{};
+    static constexpr reg<0x4> rgb_all{};
+    // LED 0 is the one nearest the FPGA
+    static constexpr reg<0x8> strip_index{};
+    // the ctrl_* bits below; they take effect at the end of a frame
+    static constexpr reg<0xc> ctrl{};
+    // leds on each channel
+    static constexpr reg<0x10, access::ro> led_count{};
+    // write 1: show the framebuffer page just drawn at the end of this frame;
+    // read bit 0: flip pending, bit 1: page shown. Use commit() instead.
+    static constexpr reg<0x14> commit{};
+    // bit 0: frame-done interrupt enable; bit 1: pending (write 1 to clear)
+    static constexpr reg<0x18> irq_ctrl{};
+    static constexpr reg<0x1c, access::ro> frame_count{};
+    // bit timings and latch period in 20 ns clock cycles, 16 bits each;
+    // they take effect at the end of the current frame
+    static constexpr reg<0x20, access::rw, 0xffff> t0h{};
+    static constexpr reg<0x24, access::rw, 0xffff> t0l{};
+    static constexpr reg<0x28, access::rw, 0xffff> t1h{};
+    static constexpr reg<0x2c, access::rw, 0xffff> t1l{};
+    static constexpr reg<0x30, access::rw, 0xffff> latch{};
+    // leds sent per frame (0: all); the rest keep their colour
+    static constexpr reg<0x34> active_count{};
+    // strips driven in parallel, and words between their framebuffer banks
+    static constexpr reg<0x38, access::ro> channels{};
+    static constexpr reg<0x3c, access::ro> channel_stride{};
+    static constexpr reg<0x40, access::ro> sprites{};
+    // pixel shown on led 0; every led shows the pixel this far along
+    static constexpr reg<0x44> rotate{};
+    // bits 15-0: frames per step of rotate (0: still); bit 31: backwards
+    static constexpr reg<0x48, access::rw, 0x8000ffff> rotate_step{};
+    static constexpr reg<0x4c, access::ro> segments{};
+    // run-length decoder: next led painted, counted along the channels;
+    // use write_rle() rather than these
+    static constexpr reg<0x50> rle_pos{};
+    // bits 31-24: run length minus one; bits 23-0: colour
+    static constexpr reg<0x54, access::wo> rle_data{};
+    // every colour is scaled by brightness / 256 (0 to 256) from the next
+    // frame on, before the gamma table
+    static constexpr reg<0x58, access::rw, 0x1ff> brightness{};
+    // clock cycles (20 ns) from a change to the first bit of the frame
+    // showing it: the last change, and the worst since latency_max was
+    // written
+    static constexpr reg<0x5c, access::ro> latency{};
+    static constexpr reg<0x60> latency_max{};
+    // added to every hue in HSV mode from the next frame on
+    static constexpr reg<0x64, access::rw, 0xff> hue_offset{};
+    // pattern drawn by the component (see hdl/ws2811_driver/
+    // pattern_generator.vhd): one of the pattern_* numbers, 0 for none
+    static constexpr reg<0x68, access::rw, 0x7> pattern{};
+    // phase step per frame and per led, in 1/65536 of a cycle; the step
+    // per frame is signed, so 0xffff goes backwards slowly
+    static constexpr reg<0x6c, access::rw, 0xffff> pattern_speed{};
+    static constexpr reg<0x70, access::rw, 0xffff> pattern_scale{};
+    static constexpr reg<0x74, access::rw, 0xffffff> pattern_color{};
+    static constexpr reg<0x78, access::rw, 0xffffff> pattern_color2{};
+    // stream sink (see hdl/ws2811_driver/pixel_stream.vhd): leds sent with
+    // no streamed pixel, and clock cycles a producer was held off; writing
+    // either clears it. stream_level is the beats in the FIFO.
+    static constexpr reg<0x7c> stream_underflow{};
+    static constexpr reg<0x80> stream_backpressure{};
+    static constexpr reg<0x84, access::ro> stream_level{};
+    // frame fetch (see hdl/ws2811_driver/frame_fetch.vhd): bus address of
+    // the frame being fetched, and dma_busy while it is; use fetch_frame().
+    // Writing dma_status gives the fetch up.
+    static constexpr reg<0x88, access::ro> dma_addr{};
+    static constexpr reg<0x8c> dma_status{};
+    // free-running counters, like frame_count: bits sent per strip,
+    // register reads and writes, and clock cycles an access was held off
+    // while the framebuffer was taken; de10_ws2811 in perf
+    static constexpr reg<0x90, access::ro> perf_bits{};
+    static constexpr reg<0x94, access::ro> perf_reads{};
+    static constexpr reg<0x98, access::ro> perf_writes{};
+    static constexpr reg<0x9c, access::ro> perf_stalls{};
+    // segment K's registers (see hdl/ws2811_driver/segment_table.vhd): a run
+    // of one colour; where segments overlap the lowest numbered one wins
+    template <unsigned K>
+    static constexpr reg<0x200 + 0x10 * K> segment_start{};
+    // 0 turns the segment off
+    template <unsigned K>
+    static constexpr reg<0x204 + 0x10 * K> segment_length{};
+    template <unsigned K>
+    static constexpr reg<0x208 + 0x10 * K, access::rw, 0xffffff> segment_color{};
+    // sprite K's registers (see hdl/ws2811_driver/sprite_engine.vhd), e.g.
+    // dev.write(ws2811::sprite_color<0>, 0x00ff00). Sprite 0 is on top, and
+    // its position is what the stop button compares with the win window.
+    template <unsigned K>
+    static constexpr reg<0x100 + 0x10 * K> sprite_position{};
+    // leds lit from the position on; 0 hides the sprite
+    template <unsigned K>
+    static constexpr reg<0x104 + 0x10 * K> sprite_length{};
+    template <unsigned K>
+    static constexpr reg<0x108 + 0x10 * K, access::rw, 0xffffff> sprite_color{};
+    // bits 29-0: step period, 0 stands still; or sprite_frames, sprite_reverse
+    template <unsigned K>
+    static constexpr reg<0x10c + 0x10 * K> sprite_period{};
+
+    // show the framebuffer instead of rgb_all/rgb_single/strip_index
+    static constexpr std::uint32_t ctrl_framebuffer = 0x1;
+    // led 0 shows the last pixel
+    static constexpr std::uint32_t ctrl_reverse = 0x2;
+    // the second half of the strip mirrors the first
+    static constexpr std::uint32_t ctrl_mirror = 0x4;
+    // the framebuffer holds palette indices, four leds per word, led 4n + b
+    // in bits 8b+7 to 8b
+    static constexpr std::uint32_t ctrl_indexed = 0x8;
+    // colours go through the gamma table
+    static constexpr std::uint32_t ctrl_gamma = 0x10;
+    // the framebuffer holds 16-bit colours, two words per led: red in bits
+    // 31-16 and green in 15-0 of the first, blue in 15-0 of the second
+    static constexpr std::uint32_t ctrl_deep = 0x20;
+    // the bits below the top 8 of every colour are spread over frames
+    static constexpr std::uint32_t ctrl_dither = 0x40;
+    // send a frame only when something shown changes, straight away
+    static constexpr std::uint32_t ctrl_on_demand = 0x80;
+    // every 8-bit colour is hue, saturation and value; make them with hsv()
+    static constexpr std::uint32_t ctrl_hsv = 0x100;
+    // show the pixels streamed to the component's Avalon-ST sink
+    static constexpr std::uint32_t ctrl_stream = 0x200;
+    // dma_status: a fetch is on its way, and the last one was given up, by
+    // a write to dma_status or because the memory port stopped answering
+    static constexpr std::uint32_t dma_busy = 0x1;
+    static constexpr std::uint32_t dma_error = 0x2;
+    // patterns; rainbow and plasma take saturation and value from bits 15-0
+    // of pattern_color, gradient and comet blend the two colours
+    static constexpr std::uint32_t pattern_rainbow = 1;
+    static constexpr std::uint32_t pattern_gradient = 2;
+    static constexpr std::uint32_t pattern_plasma = 3;
+    static constexpr std::uint32_t pattern_comet = 4;
+    static constexpr std::uint32_t rotate_backwards = 0x80000000;
+    // sprite_period: count frames instead of microseconds, step backwards
+    static constexpr std::uint32_t sprite_frames = 0x40000000;
+    static constexpr std::uint32_t sprite_reverse = 0x80000000;
+    // one word per LED from here, colour in bits 23-0; use write_words().
+    // The bus sees the back page; commit() puts it on the strip.
+    // Channel c's bank starts channel_stride words further on per channel;
+    // write_strip() hides the banks.
+    static constexpr std::uint32_t framebuffer = 0x8000;
+    // 256 colours for indexed mode, one word each; use write_words().
+    // Changes show from the next led sent.
+    static constexpr std::uint32_t palette = 0x400;
+    // 256 words; word v holds what red, green and blue of value v become,
+    // in bits 23-16, 15-8 and 7-0. Use load_gamma().
+    static constexpr std::uint32_t gamma_table = 0x800;
+};
+
+/**
+* check_words() - Check that @count words at @offset lie inside a device.
+* @span: Size of the device's register region in bytes.
+*
+* Throws std::system_error(EINVAL) if they don't.
+*/
+inline void check_words(std::uint32_t span, std::uint32_t offset, std::size_t count)
+{
+    if (offset % 4 != 0 || offset > span || count > (span - offset) / 4) {
+        throw std::system_error(EINVAL, std::generic_category(), "register range");
+    }
+}
+
+/**
+* class chardev - A component accessed through its /dev character device.
+* @Dev: One of the register maps above.
+*
+* The device is opened once, in the constructor, and closed in the
+* destructor. Failing to open the device throws std::system_error.
+*/
+template <typename Dev>
+class chardev {
+public:
+    explicit chardev(const char *path = Dev::path)
+        : fd_(::open(path, O_RDWR | O_CLOEXEC))
+    {
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), path);
+        }
+    }
+
+    ~chardev()
+    {
+        ::close(fd_);
+    }
+
+    chardev(const chardev &) = delete;
+    chardev &operator=(const chardev &) = delete;
+
+    /**
+    * read() - Read a register with a single pread().
+    *
+    * Return: The register value. Throws std::system_error on failure.
+    */
+    template <typename Reg>
+    std::uint32_t read(Reg) const
+    {
+        static_assert(Reg::readable, "register is write-only");
+        static_assert(Reg::offset + 4 <= Dev::span, "register is outside the device span");
+
+        std::uint32_t val;
+        if (::pread(fd_, &val, sizeof(val), Reg::offset) != sizeof(val)) {
+            throw std::system_error(errno, std::generic_category(), "pread");
+        }
+        return val & Reg::mask;
+    }
+
+    /**
+    * write() - Write a register with a single pwrite().
+    * @val: Value to write. Throws std::system_error on failure.
+    */
+    template <typename Reg>
+    void write(Reg, std::uint32_t val) const
+    {
+        static_assert(Reg::writable, "register is read-only");
+        static_assert(Reg::offset + 4 <= Dev::span, "register is outside the device span");
+
+        if (::pwrite(fd_, &val, sizeof(val), Reg::offset) != sizeof(val)) {
+            throw std::system_error(errno, std::generic_category(), "pwrite");
+        }
+    }
+
+    /**
+    * write_words() - Write consecutive words with a single pwrite().
+    * @offset: Byte offset of the first word, e.g. ws2811::framebuffer.
+    * @vals: Values to write.
+    * @count: Number of words. Throws std::system_error on failure.
+    */
+    void write_words(std::uint32_t offset, const std::uint32_t *vals, std::size_t count) const
+    {
+        check_words(Dev::span, offset, count);
+
+        ssize_t len = count * sizeof(*vals);
+        if (::pwrite(fd_, vals, len, offset) != len) {
+            throw std::system_error(errno, std::generic_category(), "pwrite");
+        }
+    }
+
+    int fd() const
+    {
+        return fd_;
+    }
+
+private:
+    int fd_;
+};
+
+/**
+* class mapped - A component accessed through an mmap() of its /dev node.
+* @Dev: One of the register maps above.
+*
+* The device is opened and mapped once, in the constructor. The drivers map
+* the registers uncached, so every read() and write() reaches the component.
+* Failing to open or map the device throws std::system_error.
+*/
+template <typename Dev>
+class mapped {
+public:
+    explicit mapped(const char *path = Dev::path)
+        : fd_(::open(path, O_RDWR | O_SYNC | O_CLOEXEC))
+    {
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), path);
+        }
+        void *base = ::mmap(nullptr, Dev::span, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (base == MAP_FAILED) {
+            int err = errno;
+            ::close(fd_);
+            throw std::system_error(err, std::generic_category(), path);
+        }
+        regs_ = static_cast<volatile std::uint32_t *>(base);
+    }
+
+    ~mapped()
+    {
+        ::munmap(const_cast<std::uint32_t *>(regs_), Dev::span);
+        ::close(fd_);
+    }
+
+    mapped(const mapped &) = delete;
+    mapped &operator=(const mapped &) = delete;
+
+    /**
+    * read() - Read a register with a single load.
+    *
+    * Return: The register value.
+    */
+    template <typename Reg>
+    std::uint32_t read(Reg) const
+    {
+        static_assert(Reg::readable, "register is write-only");
+        static_assert(Reg::offset + 4 <= Dev::span, "register is outside the device span");
+
+        return regs_[Reg::offset / 4] & Reg::mask;
+    }
+
+    /**
+    * write() - Write a register with a single store.
+    * @val: Value to write.
+    */
+    template <typename Reg>
+    void write(Reg, std::uint32_t val) const
+    {
+        static_assert(Reg::writable, "register is read-only");
+        static_assert(Reg::offset + 4 <= Dev::span, "register is outside the device span");
+
+        regs_[Reg::offset / 4] = val;
+    }
+
+    /**
+    * write_words() - Write consecutive words with one store each.
+    * @offset: Byte offset of the first word, e.g. ws2811::framebuffer.
+    * @vals: Values to write.
+    * @count: Number of words. Throws std::system_error if out of range.
+    */
+    void write_words(std::uint32_t offset, const std::uint32_t *vals, std::size_t count) const
+    {
+        check_words(Dev::span, offset, count);
+
+        for (std::size_t i = 0; i < count; i++) {
+            regs_[offset / 4 + i] = vals[i];
+        }
+    }
+
+    int fd() const
+    {
+        return fd_;
+    }
+
+private:
+    int fd_;
+    volatile std::uint32_t *regs_;
+};
+
+/**
+* wait_press() - Wait for the stop button to be pressed.
+* @dev: A chardev or mapped stop_button device.
+* @timeout_ms: How long to wait in ms; -1 waits forever.
+* @event: Filled in with the press, including the kernel's timestamp.
+*
+* Sleeps in poll() until the driver's interrupt handler reports a press, so
+* a press is seen as soon as it happens rather than on the next tick.
+*
+* Return: true if the button was pressed, false on timeout or a signal.
+*/
+template <typename Device>
+bool wait_press(const Device &dev, int timeout_ms, stop_button_event *event)
+{
+    struct pollfd pfd = { dev.fd(), POLLIN, 0 };
+
+    if (::poll(&pfd, 1, timeout_ms) <= 0) {
+        return false;
+    }
+    return ::pread(dev.fd(), event, sizeof(*event), STOP_BUTTON_EVENT_OFFSET) == sizeof(*event);
+}
+
+/**
+* read_clear() - Read and clear the stop button's latched press state.
+* @dev: A chardev or mapped stop_button device.
+*
+* One ioctl that returns whether (and how many times) the button was pressed
+* since the last call and clears it, without losing a press that lands in
+* between. Throws std::system_error on failure.
+*
+* Return: The press state.
+*/
+template <typename Device>
+stop_button_state read_clear(const Device &dev)
+{
+    stop_button_state state;
+
+    if (::ioctl(dev.fd(), STOP_BUTTON_IOC_READ_CLEAR, &state) < 0) {
+        throw std::system_error(errno, std::generic_category(), "STOP_BUTTON_IOC_READ_CLEAR");
+    }
+    return state;
+}
+
+/**
+* commit() - Show the framebuffer page just drawn, from the next frame on.
+* @dev: A chardev or mapped ws2811 device.
+*
+* Always goes through the driver, even for a mapped device, so that the
+* next wait_vsync() returns once the new page is on the strip. Throws
+* std::system_error on failure.
+*/
+template <typename Device>
+void commit(const Device &dev)
+{
+    std::uint32_t val = 1;
+
+    if (::pwrite(dev.fd(), &val, sizeof(val), ws2811::commit.offset) != sizeof(val)) {
+        throw std::system_error(errno, std::generic_category(), "pwrite");
+    }
+}
+
+/**
+* write_strip() - Write the framebuffer of every channel as one long strip.
+* @dev: A chardev or mapped ws2811 device.
+* @vals: Colours, LED 0 of channel 0 first, then LED 0 of channel 1 once
+*        channel 0's led_count LEDs are done, and so on.
+* @count: Number of colours.
+*
+* Always goes through the driver, which spreads the words over the channel
+* banks, or copies them into the component's pixel window in bursts when
+* the device tree gives it one. With ws2811::ctrl_deep set every LED takes
+* two words. Throws std::system_error on failure.
+*/
+template <typename Device>
+void write_strip(const Device &dev, const std::uint32_t *vals, std::size_t count)
+{
+    ssize_t len = static_cast<ssize_t>(count * sizeof(*vals));
+
+    if (::pwrite(dev.fd(), vals, count * sizeof(*vals), WS2811_STRIP_OFFSET) != len) {
+        throw std::system_error(errno, std::generic_category(), "pwrite");
+    }
+}
+
+/**
+* write_strip_indexed() - Write palette indices of every channel as one
+* long strip, in indexed mode.
+* @dev: A chardev or mapped ws2811 device.
+* @indices: One palette index per LED, in the same order as write_strip().
+* @count: Number of indices.
+*
+* The driver packs the indices four to a framebuffer word. Throws
+* std::system_error on failure.
+*/
+template <typename Device>
+void write_strip_indexed(const Device &dev, const std::uint8_t *indices, std::size_t count)
+{
+    if (::pwrite(dev.fd(), indices, count, WS2811_STRIP_OFFSET) != static_cast<ssize_t>(count)) {
+        throw std::system_error(errno, std::generic_category(), "pwrite");
+    }
+}
+
+/**
+* rle_encode() - Run-length encode colours for write_rle().
+* @vals: Colours, in the same order as write_strip().
+* @count: Number of colours.
+* @runs: Filled in with the runs; needs room for @count words.
+*
+* Each run is (length - 1) << 24 | colour, 1 to 256 LEDs of one colour.
+*
+* Return: The number of runs.
+*/
+inline std::size_t rle_encode(const std::uint32_t *vals, std::size_t count, std::uint32_t *runs)
+{
+    std::size_t n = 0;
+
+    for (std::size_t i = 0; i < count;) {
+        std::uint32_t colour = vals[i] & 0xffffff;
+        std::size_t len = 1;
+
+        while (i + len < count && len < 256 && (vals[i + len] & 0xffffff) == colour) {
+            len++;
+        }
+        runs[n++] = static_cast<std::uint32_t>(len - 1) << 24 | colour;
+        i += len;
+    }
+    return n;
+}
+
+/**
+* write_rle() - Write run-length encoded colours into the framebuffer.
+* @dev: A chardev or mapped ws2811 device.
+* @runs: Runs from rle_encode().
+* @count: Number of runs.
+* @first: LED the first run starts at, counted as in write_strip().
+*
+* Always goes through the driver; the component expands the runs into one
+* 8-bit colour per LED, so it only works with neither ws2811::ctrl_deep nor
+* ws2811::ctrl_indexed set, and fails with EINVAL otherwise. Throws
+* std::system_error on failure.
+*/
+template <typename Device>
+void write_rle(const Device &dev, const std::uint32_t *runs, std::size_t count, std::uint32_t first = 0)
+{
+    ssize_t len = static_cast<ssize_t>(count * sizeof(*runs));
+
+    if (::pwrite(dev.fd(), runs, count * sizeof(*runs), WS2811_RLE_OFFSET + first * sizeof(*runs)) != len) {
+        throw std::system_error(errno, std::generic_category(), "pwrite");
+    }
+}
+
+/**
+* class frame_buffer - One of the ws2811 driver's frame buffers in memory,
+* mmap()ed.
+*
+* Laid out like write_strip()'s words (write_strip_indexed()'s bytes in
+* indexed mode), WS2811_DMA_SIZE bytes long. fetch_frame() has the
+* component copy it into the back page. Failing to map it throws
+* std::system_error.
+*/
+class frame_buffer {
+public:
+    template <typename Device>
+    frame_buffer(const Device &dev, unsigned n)
+    {
+        void *base = ::mmap(nullptr, WS2811_DMA_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+                            dev.fd(), WS2811_DMA_OFFSET + n * WS2811_DMA_SIZE);
+        if (base == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "frame buffer");
+        }
+        words_ = static_cast<std::uint32_t *>(base);
+    }
+
+    ~frame_buffer()
+    {
+        ::munmap(words_, WS2811_DMA_SIZE);
+    }
+
+    frame_buffer(const frame_buffer &) = delete;
+    frame_buffer &operator=(const frame_buffer &) = delete;
+
+    std::uint32_t *words() const
+    {
+        return words_;
+    }
+
+private:
+    std::uint32_t *words_;
+};
+
+/**
+* fetch_frame() - Have the component fetch frame buffer @n and show it.
+* @dev: A chardev or mapped ws2811 device.
+* @n: Frame buffer number, below WS2811_DMA_BUFFERS.
+*
+* One pwrite() and one register write; the component copies the buffer
+* into the back page and commits it. Leave the buffer alone until
+* ws2811::dma_status no longer shows ws2811::dma_busy; if it then shows
+* ws2811::dma_error, the fetch was given up and nothing committed. Throws
+* std::system_error on failure.
+*
+* Return: false if the previous fetch wasn't done, and nothing was started.
+*/
+template <typename Device>
+bool fetch_frame(const Device &dev, std::uint32_t n)
+{
+    if (::pwrite(dev.fd(), &n, sizeof(n), WS2811_DMA_OFFSET) == sizeof(n)) {
+        return true;
+    }
+    if (errno == EBUSY) {
+        return false;
+    }
+    throw std::system_error(errno, std::generic_category(), "pwrite");
+}
+
+/**
+* load_gamma() - Fill the ws2811 gamma table with a power curve.
+* @dev: A chardev or mapped ws2811 device.
+* @gamma: Exponent, the same for every colour; 2.2 to 2.8 suits most LEDs.
+*
+* Value v becomes 255 * (v / 255)^gamma. The table is only used with
+* ws2811::ctrl_gamma set in ctrl.
+*/
+template <typename Device>
+void load_gamma(const Device &dev, double gamma)
+{
+    std::uint32_t table[256];
+
+    for (unsigned v = 0; v < 256; v++) {
+        auto out = static_cast<std::uint32_t>(std::lround(255.0 * std::pow(v / 255.0, gamma)));
+        table[v] = out << 16 | out << 8 | out;
+    }
+    dev.write_words(ws2811::gamma_table, table, 256);
+}
+
+/**
+* hsv() - Pack a colour for ws2811::ctrl_hsv mode.
+* @hue: Round the colour wheel from 0 to 255: red 0, green 85, blue 170.
+* @sat: 0 is white, 255 the pure hue.
+* @val: 0 is off, 255 full.
+*/
+constexpr std::uint32_t hsv(std::uint8_t hue, std::uint8_t sat, std::uint8_t val)
+{
+    return static_cast<std::uint32_t>(hue) << 16 | static_cast<std::uint32_t>(sat) << 8 | val;
+}
+
+/**
+* hsv_to_rgb() - The red, green and blue the component shows for a colour
+* in ws2811::ctrl_hsv mode.
+* @colour: From hsv().
+* @hue_offset: The ws2811::hue_offset register.
+*
+* Does the same sums as hdl/ws2811_driver/hsv_to_rgb.vhd, so the result
+* matches the hardware bit for bit.
+*/
+constexpr std::uint32_t hsv_to_rgb(std::uint32_t colour, std::uint8_t hue_offset = 0)
+{
+    // exact x / 255 for x up to 255 * 255
+    auto div255 = [](std::uint32_t x) { return (x + (x >> 8) + 1) >> 8; };
+    std::uint32_t hue = ((colour >> 16) + hue_offset) & 0xff;
+    std::uint32_t sat = (colour >> 8) & 0xff;
+    std::uint32_t val = colour & 0xff;
+    std::uint32_t sector = hue * 6 >> 8;
+    std::uint32_t fraction = hue * 6 & 0xff;
+    std::uint32_t p = div255(val * (255 - sat));
+    std::uint32_t q = div255(val * (255 - div255(sat * fraction)));
+    std::uint32_t t = div255(val * (255 - div255(sat * (255 - fraction))));
+
+    switch (sector) {
+    case 0: return val << 16 | t << 8 | p;
+    case 1: return q << 16 | val << 8 | p;
+    case 2: return p << 16 | val << 8 | t;
+    case 3: return p << 16 | q << 8 | val;
+    case 4: return t << 16 | p << 8 | val;
+    default: return val << 16 | p << 8 | q;
+    }
+}
+
+/**
+* wait_vsync() - Wait for the strip to finish a frame.
+* @dev: A chardev or mapped ws2811 device.
+* @timeout_ms: How long to wait in ms; -1 waits forever.
+* @vsync: Filled in with the frame, including the kernel's timestamp.
+*
+* Sleeps in poll() until the frame-done interrupt. After commit(), this is
+* the end of the frame at which the committed page became the one shown, so
+* the other page is free to draw the next frame into.
+*
+* Return: true if a frame ended, false on timeout or a signal.
+*/
+template <typename Device>
+bool wait_vsync(const Device &dev, int timeout_ms, ws2811_vsync *vsync)
+{
+    struct pollfd pfd = { dev.fd(), POLLIN, 0 };
+
+    if (::poll(&pfd, 1, timeout_ms) <= 0) {
+        return false;
+    }
+    return ::pread(dev.fd(), vsync, sizeof(*vsync), WS2811_VSYNC_OFFSET) == sizeof(*vsync);
+}
+
+} // namespace de10
+
+#endif // DE10NANO_HAL_HPP
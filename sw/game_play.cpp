@@ -0,0 +1,176 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+#include <unistd.h>
+#include <signal.h>
+
+#include "de10nano_hal.hpp"
+
+using de10::adc;
+using de10::stop_button;
+using de10::ws2811;
+
+// LED driver component
+// off color is the color of the whole strip, the moving led is sprite 0,
+// which the FPGA moves along on its own
+constexpr auto OFF_COLOR = ws2811::rgb_all;
+constexpr auto ON_COLOR = ws2811::sprite_color<0>;
+constexpr auto SPEED = ws2811::sprite_period<0>;
+
+// the index of the led on the strip that corrisponds to a win
+#define WIN_INDEX 0
+
+// colour of the win zone, painted with colour segment 0, and what it
+// flashes to on a win
+#define WIN_COLOR 0x200000
+#define WON_COLOR 0x00ff00
+
+// ws2811 clock cycles per microsecond
+#define CYCLES_PER_US 50
+
+// min and max delay times between steps of the moving led in ms
+#define DELAY_MIN 1.0
+#define DELAY_MAX 500.0
+
+// how often the speed pot is read in ms
+#define POLL_MS 50
+
+uint32_t val;
+uint32_t delay;
+uint32_t last_delay = 0;
+struct stop_button_event press;
+struct stop_button_state result;
+
+// loop variable that is set to zero by int_handler()
+static volatile int keep_running = 1;
+
+/**
+* int_handler() - Cleanup and exit program when cntl-C is entered
+*/
+void int_handler(int)
+{
+    printf("\nLOOP KILLED!\n");
+    keep_running = 0;
+}
+
+/**
+* play() - Run the program with the given register access path
+* @Device: de10::chardev or de10::mapped
+*/
+template <template <typename> class Device>
+static int play()
+{
+    // open the devices once; they stay open until the program exits
+    Device<stop_button> dev_stop_button;
+    Device<adc> dev_adc;
+    Device<ws2811> dev_ws2811;
+
+    // Test reading the registers sequentially
+    printf("\n************************************\n*");
+    printf("* read initial register values\n");
+    printf("************************************\n\n");
+    printf("stop_button = 0x%x\n", dev_stop_button.read(stop_button::stop));
+    de10::read_clear(dev_stop_button);
+
+    printf("adc_ch_0 = 0x%x\n", dev_adc.read(adc::ch0));
+
+    printf("off_color = 0x%x\n", dev_ws2811.read(OFF_COLOR));
+    printf("on_color = 0x%x\n", dev_ws2811.read(ON_COLOR));
+    printf("sprites = %u\n", dev_ws2811.read(ws2811::sprites));
+
+    printf("\n************************************\n*");
+    printf("* begin game!\n");
+    printf("************************************\n\n");
+
+
+    // the stop button compares the led position against the win window
+    dev_stop_button.write(stop_button::win_lo, WIN_INDEX);
+    dev_stop_button.write(stop_button::win_hi, WIN_INDEX);
+
+    // update on and off color values; the moving led is a one led sprite
+    dev_ws2811.write(OFF_COLOR, 0x0000FF);
+    dev_ws2811.write(ON_COLOR, 0x000200);
+    dev_ws2811.write(ws2811::sprite_position<0>, 1);
+    dev_ws2811.write(ws2811::sprite_length<0>, 1);
+
+    // mark the win zone under the moving led
+    dev_ws2811.write(ws2811::segment_start<0>, WIN_INDEX);
+    dev_ws2811.write(ws2811::segment_color<0>, WIN_COLOR);
+    dev_ws2811.write(ws2811::segment_length<0>, 1);
+
+    // only send frames when something changes, so the win flash goes out
+    // at once instead of after the frame in progress
+    dev_ws2811.write(ws2811::ctrl, dev_ws2811.read(ws2811::ctrl) | ws2811::ctrl_on_demand);
+
+    // loop until ctl-c is entered
+    signal(SIGINT, int_handler);
+    while(keep_running)
+    {
+        // read ADC values and convert to pwm values
+        // NOTE: this is designed for 3.3V supply to the pots
+        // the highest value read by the ADC would be
+        // max_pot_v / max_adc_v * adc_bits - 1  = 3.3/4.096 * 2^12 - 1 = 3299
+        val = dev_adc.read(adc::ch0);
+        delay = (uint32_t) (DELAY_MIN + (DELAY_MAX - DELAY_MIN)*((float) val) / 3299.0);
+
+        // the FPGA steps the led; only tell it when the speed changes
+        if(delay != last_delay)
+        {
+            printf("Delay: %d\n", delay);
+            dev_ws2811.write(SPEED, delay * 1000);
+            last_delay = delay;
+        }
+
+        // wait for the next pot reading, but react to a press the moment it happens
+        // if the user pressed the button and won, pause the game for 5 seconds
+        // either way, reset the button
+        // the FPGA captures the led position on the press itself, so a win
+        // doesn't depend on how quickly we get here
+        if(de10::wait_press(dev_stop_button, POLL_MS, &press))
+        {
+            printf("Button pressed!");
+            result = de10::read_clear(dev_stop_button);
+            if(result.won)
+            {
+                printf("YOU WON!!\n");
+                // stop the led where it is for the pause, and flash the zone
+                dev_ws2811.write(SPEED, 0);
+                dev_ws2811.write(ws2811::segment_color<0>, WON_COLOR);
+                usleep(5*1000*1000);
+                printf("win shown %u us after the write\n",
+                       dev_ws2811.read(ws2811::latency) / CYCLES_PER_US);
+                dev_ws2811.write(ws2811::segment_color<0>, WIN_COLOR);
+                dev_ws2811.write(SPEED, delay * 1000);
+                // throw away presses made while the game was paused
+                de10::read_clear(dev_stop_button);
+            }
+            printf("Game reset...\n");
+        }
+    }
+
+
+    // ON EXIT
+    // set all leds to red
+    dev_ws2811.write(ws2811::sprite_length<0>, 0);
+    dev_ws2811.write(ws2811::segment_length<0>, 0);
+    dev_ws2811.write(SPEED, 0);
+    dev_ws2811.write(ws2811::ctrl, dev_ws2811.read(ws2811::ctrl) & ~ws2811::ctrl_on_demand);
+    dev_ws2811.write(OFF_COLOR, 0x00FF00);
+
+    return 0;
+}
+
+int main (int argc, char **argv) try {
+    // --mmap maps the registers instead of going through read()/write()
+    if (argc > 1 && strcmp(argv[1], "--mmap") == 0) {
+        return play<de10::mapped>();
+    }
+    return play<de10::chardev>();
+}
+catch (const std::system_error &e) {
+    // the most common failure is a missing driver: "failed to open /dev/adc"
+    printf("failed to access %s\n", e.what());
+    exit(1);
+}
@@ -0,0 +1,222 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <system_error>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+
+#include "de10nano_hal.hpp"
+
+/*
+* Microbenchmark for one tick of the game_play loop: read the ADC, read the
+* stop button, write the strip index. The "stdio" variant is the loop as it
+* was written before the HAL (fopen/fseek/fread|fwrite/fflush/fclose for each
+* device on every tick); the "hal" variant uses de10::chardev.
+*
+* Usage: hal_bench [ticks] [device directory]
+*
+* With no directory, RAM-backed stand-in files are created under /tmp so the
+* benchmark runs on any Linux host. On the board, pass /dev to measure the
+* real drivers. System calls are counted by tracing a child process with
+* ptrace; the count for 0 ticks is subtracted so only the loop is measured.
+*/
+
+using de10::adc;
+using de10::stop_button;
+using de10::ws2811;
+
+// number of addressable LEDs in the strip
+#define NUM_LEDS 250
+
+static std::string dir;
+
+static std::string dev_path(const char *name)
+{
+    return dir + "/" + name;
+}
+
+/**
+* stdio_ticks() - Run the game loop body the way game_play.c used to.
+* @ticks: Number of loop iterations.
+*/
+static void stdio_ticks(long ticks)
+{
+    uint32_t val;
+    uint32_t strip = 0;
+    std::string adc_path = dev_path("adc");
+    std::string stop_button_path = dev_path("stop_button");
+    std::string ws2811_path = dev_path("ws2811");
+
+    for (long i = 0; i < ticks; i++) {
+        FILE *file_adc = fopen(adc_path.c_str(), "rb+");
+        fseek(file_adc, adc::ch0.offset, SEEK_SET);
+        fread(&val, 4, 1, file_adc);
+        fclose(file_adc);
+
+        FILE *file_stop_button = fopen(stop_button_path.c_str(), "rb+");
+        fseek(file_stop_button, stop_button::stop.offset, SEEK_SET);
+        fread(&val, 4, 1, file_stop_button);
+        fclose(file_stop_button);
+
+        FILE *file_ws2811 = fopen(ws2811_path.c_str(), "rb+");
+        strip = strip > NUM_LEDS ? 0 : strip + 1;
+        fseek(file_ws2811, ws2811::strip_index.offset, SEEK_SET);
+        fwrite(&strip, 4, 1, file_ws2811);
+        fflush(file_ws2811);
+        fclose(file_ws2811);
+    }
+}
+
+/**
+* hal_ticks() - Run the game loop body through the HAL.
+* @ticks: Number of loop iterations.
+*/
+static void hal_ticks(long ticks)
+{
+    uint32_t strip = 0;
+    de10::chardev<adc> dev_adc(dev_path("adc").c_str());
+    de10::chardev<stop_button> dev_stop_button(dev_path("stop_button").c_str());
+    de10::chardev<ws2811> dev_ws2811(dev_path("ws2811").c_str());
+
+    for (long i = 0; i < ticks; i++) {
+        dev_adc.read(adc::ch0);
+        dev_stop_button.read(stop_button::stop);
+        strip = strip > NUM_LEDS ? 0 : strip + 1;
+        dev_ws2811.write(ws2811::strip_index, strip);
+    }
+}
+
+/**
+* count_syscalls() - Count the system calls made by a variant.
+* @run: stdio_ticks or hal_ticks.
+* @ticks: Number of loop iterations.
+*
+* Return: The number of system calls, or -1 if the child could not be traced.
+*/
+static long count_syscalls(void (*run)(long), long ticks)
+{
+    pid_t pid = fork();
+    if (pid == 0) {
+        ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+        raise(SIGSTOP);
+        run(ticks);
+        _exit(0);
+    }
+
+    int status;
+    long stops = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFSTOPPED(status)) {
+        return -1;
+    }
+    ptrace(PTRACE_SETOPTIONS, pid, nullptr, (void *) PTRACE_O_TRACESYSGOOD);
+    while (true) {
+        if (ptrace(PTRACE_SYSCALL, pid, nullptr, nullptr) < 0) {
+            kill(pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            return -1;
+        }
+        waitpid(pid, &status, 0);
+        if (WIFEXITED(status) || WIFSIGNALED(status)) {
+            break;
+        }
+        if (WIFSTOPPED(status) && WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+            stops++;
+        }
+    }
+
+    // every system call stops once on entry and once on exit, except exit
+    return (stops + 1) / 2;
+}
+
+/**
+* ns_per_tick() - Measure the average wall-clock time of one tick.
+*/
+static double ns_per_tick(void (*run)(long), long ticks)
+{
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    run(ticks);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / ticks;
+}
+
+/**
+* make_stand_ins() - Create zero-filled files standing in for /dev nodes.
+*/
+static void make_stand_ins()
+{
+    char tmpl[] = "/tmp/hal_bench.XXXXXX";
+    if (mkdtemp(tmpl) == nullptr) {
+        throw std::system_error(errno, std::generic_category(), "mkdtemp");
+    }
+    dir = tmpl;
+
+    const struct { const char *name; uint32_t span; } devs[] = {
+        { "adc", adc::span },
+        { "stop_button", stop_button::span },
+        { "ws2811", ws2811::span },
+    };
+    for (const auto &d : devs) {
+        int fd = open(dev_path(d.name).c_str(), O_RDWR | O_CREAT, 0600);
+        if (fd < 0 || ftruncate(fd, d.span) < 0) {
+            throw std::system_error(errno, std::generic_category(), d.name);
+        }
+        close(fd);
+    }
+}
+
+static void remove_stand_ins()
+{
+    unlink(dev_path("adc").c_str());
+    unlink(dev_path("stop_button").c_str());
+    unlink(dev_path("ws2811").c_str());
+    rmdir(dir.c_str());
+}
+
+int main(int argc, char **argv) try {
+    long ticks = argc > 1 ? strtol(argv[1], nullptr, 0) : 100000;
+    bool stand_in = argc <= 2;
+
+    if (stand_in) {
+        make_stand_ins();
+    } else {
+        dir = argv[2];
+    }
+
+    const struct { const char *name; void (*run)(long); } variants[] = {
+        { "stdio", stdio_ticks },
+        { "hal", hal_ticks },
+    };
+
+    printf("%ld ticks against %s\n\n", ticks, stand_in ? "RAM-backed stand-ins" : dir.c_str());
+    printf("%-8s %16s %16s\n", "variant", "syscalls/tick", "ns/tick");
+    for (const auto &v : variants) {
+        long traced_ticks = ticks < 1000 ? ticks : 1000;
+        long base = count_syscalls(v.run, 0);
+        long calls = count_syscalls(v.run, traced_ticks);
+        double ns = ns_per_tick(v.run, ticks);
+
+        if (base < 0 || calls < 0) {
+            printf("%-8s %16s %16.0f\n", v.name, "n/a", ns);
+        } else {
+            printf("%-8s %16.1f %16.0f\n", v.name, (double) (calls - base) / traced_ticks, ns);
+        }
+    }
+
+    if (stand_in) {
+        remove_stand_ins();
+    }
+
+    return 0;
+}
+catch (const std::system_error &e) {
+    printf("failed to access %s\n", e.what());
+    exit(1);
+}
@@ -0,0 +1,102 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <system_error>
+#include <time.h>
+#include <unistd.h>
+
+#include "de10nano_hal.hpp"
+
+/*
+* Register throughput of the two HAL access paths: de10::chardev (one
+* pread/pwrite per access) and de10::mapped (one load/store per access).
+*
+* Usage: mmap_bench [accesses] [device]
+*
+* With no device, a RAM-backed stand-in region is created in /dev/shm (or
+* /tmp) so the benchmark runs on any Linux host. On the board, pass
+* /dev/ws2811 to measure the real driver and bridge. Only the strip_index
+* register is written, so running against the LED strip is harmless.
+*/
+
+using de10::ws2811;
+
+/**
+* seconds_since() - Wall-clock seconds elapsed since @start.
+*/
+static double seconds_since(const struct timespec &start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/**
+* run() - Time @accesses reads and then @accesses writes through a device.
+* @name: Name of the access path, for the report.
+* @path: Device or stand-in file.
+* @accesses: Number of reads and of writes.
+*/
+template <template <typename> class Device>
+static void run(const char *name, const char *path, long accesses)
+{
+    Device<ws2811> dev(path);
+    struct timespec start;
+    volatile uint32_t sink;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < accesses; i++) {
+        sink = dev.read(ws2811::strip_index);
+    }
+    double read_s = seconds_since(start);
+    (void) sink;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < accesses; i++) {
+        dev.write(ws2811::strip_index, i);
+    }
+    double write_s = seconds_since(start);
+
+    printf("%-8s %16.0f %16.0f\n", name, accesses / read_s, accesses / write_s);
+}
+
+int main(int argc, char **argv) try {
+    long accesses = argc > 1 ? strtol(argv[1], nullptr, 0) : 1000000;
+    std::string path;
+    bool stand_in = argc <= 2;
+
+    if (stand_in) {
+        // a zero-filled file in tmpfs stands in for the registers
+        char tmpl[] = "/dev/shm/mmap_bench.XXXXXX";
+        char tmpl_tmp[] = "/tmp/mmap_bench.XXXXXX";
+        int fd = mkstemp(tmpl);
+        path = tmpl;
+        if (fd < 0) {
+            fd = mkstemp(tmpl_tmp);
+            path = tmpl_tmp;
+        }
+        if (fd < 0 || ftruncate(fd, ws2811::span) < 0) {
+            throw std::system_error(errno, std::generic_category(), "stand-in region");
+        }
+        close(fd);
+    } else {
+        path = argv[2];
+    }
+
+    printf("%ld accesses against %s\n\n", accesses, path.c_str());
+    printf("%-8s %16s %16s\n", "path", "reads/s", "writes/s");
+    run<de10::chardev>("chardev", path.c_str(), accesses);
+    run<de10::mapped>("mapped", path.c_str(), accesses);
+
+    if (stand_in) {
+        unlink(path.c_str());
+    }
+
+    return 0;
+}
+catch (const std::system_error &e) {
+    printf("failed to access %s\n", e.what());
+    exit(1);
+}
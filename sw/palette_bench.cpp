@@ -0,0 +1,128 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <system_error>
+#include <time.h>
+#include <unistd.h>
+
+#include "de10nano_hal.hpp"
+
+/*
+* Bus writes and upload time per frame for the ws2811 framebuffer in RGB
+* mode (one word per LED), in indexed mode (four palette indices per word)
+* and for colour cycling, which only rewrites part of the palette.
+*
+* Usage: palette_bench [frames] [leds] [device]
+*
+* With no device, a RAM-backed stand-in region is created in /dev/shm (or
+* /tmp) so the benchmark runs on any Linux host. On the board, pass
+* /dev/ws2811; the back page of the framebuffer and the palette are
+* overwritten, but nothing is committed, so the strip doesn't change
+* unless the framebuffer is already shown.
+*/
+
+using de10::ws2811;
+
+// palette entries rewritten per frame when colour cycling
+#define CYCLE_COLORS 16
+
+/**
+* seconds_since() - Wall-clock seconds elapsed since @start.
+*/
+static double seconds_since(const struct timespec &start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/**
+* upload() - Time @frames uploads of @words words at @offset.
+* @dev: The device to write.
+* @offset: Byte offset of the first word.
+* @words: Words written per frame.
+* @frames: Number of frames.
+*
+* Return: Frames per second.
+*/
+template <typename Device>
+static double upload(const Device &dev, std::uint32_t offset, std::size_t words, long frames)
+{
+    std::vector<std::uint32_t> frame(words);
+    struct timespec start;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long f = 0; f < frames; f++) {
+        // something different every frame, as an animation would
+        for (std::size_t i = 0; i < words; i++) {
+            frame[i] = static_cast<std::uint32_t>(f + i);
+        }
+        dev.write_words(offset, frame.data(), words);
+    }
+    return frames / seconds_since(start);
+}
+
+/**
+* run() - Report every mode through one access path.
+* @name: Name of the access path, for the report.
+* @path: Device or stand-in file.
+* @frames: Number of frames per mode.
+* @leds: LEDs per frame.
+*/
+template <template <typename> class Device>
+static void run(const char *name, const char *path, long frames, std::size_t leds)
+{
+    Device<ws2811> dev(path);
+    std::size_t rgb_words = leds;
+    std::size_t indexed_words = (leds + 3) / 4;
+
+    printf("%-8s %-8s %12zu %14.0f\n", name, "rgb", rgb_words,
+           upload(dev, ws2811::framebuffer, rgb_words, frames));
+    printf("%-8s %-8s %12zu %14.0f\n", name, "indexed", indexed_words,
+           upload(dev, ws2811::framebuffer, indexed_words, frames));
+    printf("%-8s %-8s %12d %14.0f\n", name, "cycle", CYCLE_COLORS,
+           upload(dev, ws2811::palette, CYCLE_COLORS, frames));
+}
+
+int main(int argc, char **argv) try {
+    long frames = argc > 1 ? strtol(argv[1], nullptr, 0) : 100000;
+    std::size_t leds = argc > 2 ? strtoul(argv[2], nullptr, 0) : 250;
+    std::string path;
+    bool stand_in = argc <= 3;
+
+    if (stand_in) {
+        // a zero-filled file in tmpfs stands in for the registers
+        char tmpl[] = "/dev/shm/palette_bench.XXXXXX";
+        char tmpl_tmp[] = "/tmp/palette_bench.XXXXXX";
+        int fd = mkstemp(tmpl);
+        path = tmpl;
+        if (fd < 0) {
+            fd = mkstemp(tmpl_tmp);
+            path = tmpl_tmp;
+        }
+        if (fd < 0 || ftruncate(fd, ws2811::span) < 0) {
+            throw std::system_error(errno, std::generic_category(), "stand-in region");
+        }
+        close(fd);
+    } else {
+        path = argv[3];
+    }
+
+    printf("%ld frames of %zu leds against %s\n\n", frames, leds, path.c_str());
+    printf("%-8s %-8s %12s %14s\n", "path", "mode", "writes/frame", "frames/s");
+    run<de10::chardev>("chardev", path.c_str(), frames, leds);
+    run<de10::mapped>("mapped", path.c_str(), frames, leds);
+
+    if (stand_in) {
+        unlink(path.c_str());
+    }
+
+    return 0;
+}
+catch (const std::system_error &e) {
+    printf("failed to access %s\n", e.what());
+    exit(1);
+}
@@ -0,0 +1,109 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+#include <unistd.h>
+#include <signal.h>
+
+#include "de10nano_hal.hpp"
+
+using de10::adc;
+using de10::pwm_rgb;
+
+// min and max PWM values
+#define PWM_MIN 0x0
+#define PWM_MAX 0x80000000
+
+// loop variable that is set to zero by int_handler()
+static volatile int keep_running = 1;
+
+/**
+* int_handler() - Cleanup and exit program when cntl-C is entered
+*/
+void int_handler(int)
+{
+    printf("\nLOOP KILLED!\n");
+    keep_running = 0;
+}
+
+/**
+* adc_to_pwm() - Convert an ADC reading to a pwm duty cycle
+* @val: Raw ADC value
+*
+* NOTE: this is designed for 3.3V supply to the pots
+* the highest value read by the ADC would be
+* max_pot_v / max_adc_v * adc_bits - 1  = 3.3/4.096 * 2^12 - 1 = 3299
+*/
+static uint32_t adc_to_pwm(uint32_t val)
+{
+    return (uint32_t) (PWM_MIN + (PWM_MAX - PWM_MIN)*((float) val) / 3299.0);
+}
+
+/**
+* play() - Run the program with the given register access path
+* @Device: de10::chardev or de10::mapped
+*/
+template <template <typename> class Device>
+static int play()
+{
+    // open the devices once; they stay open until the program exits
+    Device<pwm_rgb> dev_pwm_rgb;
+    Device<adc> dev_adc;
+
+    // Test reading the registers sequentially
+    printf("\n************************************\n*");
+    printf("* read initial register values\n");
+    printf("************************************\n\n");
+    printf("duty_red = 0x%x\n", dev_pwm_rgb.read(pwm_rgb::duty_red));
+    printf("duty_green = 0x%x\n", dev_pwm_rgb.read(pwm_rgb::duty_green));
+    printf("duty_blue = 0x%x\n", dev_pwm_rgb.read(pwm_rgb::duty_blue));
+    printf("base_period = 0x%x\n", dev_pwm_rgb.read(pwm_rgb::base_period));
+
+    printf("adc_ch_0 = 0x%x\n", dev_adc.read(adc::ch0));
+    printf("adc_ch_1 = 0x%x\n", dev_adc.read(adc::ch1));
+    printf("adc_ch_2 = 0x%x\n", dev_adc.read(adc::ch2));
+
+    printf("\n************************************\n*");
+    printf("* begin looping!\n");
+    printf("************************************\n\n");
+
+    // loop until ctl-c is entered
+    signal(SIGINT, int_handler);
+
+    /*
+    // set base period to 1 ms
+    dev_pwm_rgb.write(pwm_rgb::base_period, 0x1000);
+    */
+
+    while(keep_running)
+    {
+        // read ADC values and write pwm values
+        dev_pwm_rgb.write(pwm_rgb::duty_red, adc_to_pwm(dev_adc.read(adc::ch0)));
+        dev_pwm_rgb.write(pwm_rgb::duty_green, adc_to_pwm(dev_adc.read(adc::ch1)));
+        dev_pwm_rgb.write(pwm_rgb::duty_blue, adc_to_pwm(dev_adc.read(adc::ch2)));
+
+        usleep(100);
+
+    }
+
+    // ON EXIT
+    // run led off
+    dev_pwm_rgb.write(pwm_rgb::duty_red, 0x0);
+    dev_pwm_rgb.write(pwm_rgb::duty_green, 0x0);
+    dev_pwm_rgb.write(pwm_rgb::duty_blue, 0x0);
+
+    return 0;
+}
+
+int main (int argc, char **argv) try {
+    // --mmap maps the registers instead of going through read()/write()
+    if (argc > 1 && strcmp(argv[1], "--mmap") == 0) {
+        return play<de10::mapped>();
+    }
+    return play<de10::chardev>();
+}
+catch (const std::system_error &e) {
+    printf("failed to access %s\n", e.what());
+    exit(1);
+}
@@ -0,0 +1,163 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <system_error>
+#include <time.h>
+#include <unistd.h>
+
+#include "de10nano_hal.hpp"
+
+/*
+* Bytes and bus writes per frame for raw and run-length encoded framebuffer
+* uploads of a few typical frames, and the time taken to encode them.
+*
+* Usage: rle_bench [frames] [leds] [device]
+*
+* The counts and the encode time need no hardware. With a device (on the
+* board, /dev/ws2811) each frame is also uploaded both ways through the
+* driver and timed; the back page of the framebuffer is overwritten, but
+* nothing is committed.
+*/
+
+using de10::ws2811;
+
+#define BACKGROUND 0x000010
+#define DOT 0x00ff00
+#define WIN 0x200000
+
+/**
+* seconds_since() - Wall-clock seconds elapsed since @start.
+*/
+static double seconds_since(const struct timespec &start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/**
+* draw() - Draw one of the benchmark frames.
+* @scene: 0 dark, 1 dot on a background, 2 game (win zone and dot),
+*         3 progress bar, 4 a different colour on every led.
+* @frame: Filled in with the colours.
+*
+* Return: Name of the frame, for the report.
+*/
+static const char *draw(int scene, std::vector<std::uint32_t> &frame)
+{
+    std::size_t leds = frame.size();
+
+    switch (scene) {
+    case 0:
+        frame.assign(leds, 0);
+        return "dark";
+    case 1:
+        frame.assign(leds, BACKGROUND);
+        frame[leds / 3] = DOT;
+        return "dot";
+    case 2:
+        frame.assign(leds, BACKGROUND);
+        for (std::size_t i = leds * 4 / 5; i < leds * 4 / 5 + leds / 25; i++) {
+            frame[i] = WIN;
+        }
+        frame[leds / 3] = DOT;
+        return "game";
+    case 3:
+        frame.assign(leds, 0);
+        for (std::size_t i = 0; i < leds / 2; i++) {
+            frame[i] = DOT;
+        }
+        return "bar";
+    default:
+        for (std::size_t i = 0; i < leds; i++) {
+            frame[i] = static_cast<std::uint32_t>(i * 0x010203) & 0xffffff;
+        }
+        return "gradient";
+    }
+}
+
+/**
+* upload() - Time @frames uploads of @frame, raw and run-length encoded.
+* @path: The ws2811 device.
+* @frame: Colours of one frame.
+* @runs: The same frame from de10::rle_encode().
+* @frames: Number of uploads each way.
+* @raw_fps: Set to raw uploads per second.
+* @rle_fps: Set to RLE uploads per second.
+*/
+static void upload(const char *path, const std::vector<std::uint32_t> &frame,
+                   const std::vector<std::uint32_t> &runs, long frames,
+                   double *raw_fps, double *rle_fps)
+{
+    de10::chardev<ws2811> dev(path);
+    struct timespec start;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long f = 0; f < frames; f++) {
+        de10::write_strip(dev, frame.data(), frame.size());
+    }
+    *raw_fps = frames / seconds_since(start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long f = 0; f < frames; f++) {
+        de10::write_rle(dev, runs.data(), runs.size());
+    }
+    *rle_fps = frames / seconds_since(start);
+}
+
+int main(int argc, char **argv) try {
+    long frames = argc > 1 ? strtol(argv[1], nullptr, 0) : 100000;
+    std::size_t leds = argc > 2 ? strtoul(argv[2], nullptr, 0) : 250;
+    const char *path = argc > 3 ? argv[3] : nullptr;
+    std::vector<std::uint32_t> frame(leds);
+    std::vector<std::uint32_t> runs(leds);
+
+    printf("%ld frames of %zu leds%s%s\n\n", frames, leds,
+           path ? " against " : "", path ? path : "");
+    printf("%-9s %10s %10s %10s %10s %10s", "frame", "raw bytes", "raw writes",
+           "rle bytes", "rle writes", "encode us");
+    if (path) {
+        printf(" %10s %10s", "raw fps", "rle fps");
+    }
+    printf("\n");
+
+    for (int scene = 0; scene < 5; scene++) {
+        const char *name = draw(scene, frame);
+        std::size_t n = 0;
+        struct timespec start;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (long f = 0; f < frames; f++) {
+            // as an animation would, change something every frame
+            frame[f % leds] ^= 1;
+            n = de10::rle_encode(frame.data(), leds, runs.data());
+            frame[f % leds] ^= 1;
+        }
+        double encode_us = seconds_since(start) * 1e6 / frames;
+
+        n = de10::rle_encode(frame.data(), leds, runs.data());
+        runs.resize(n);
+
+        // plus one write to rle_pos
+        printf("%-9s %10zu %10zu %10zu %10zu %10.2f", name, leds * 4, leds,
+               n * 4, n + 1, encode_us);
+        if (path) {
+            double raw_fps;
+            double rle_fps;
+
+            upload(path, frame, runs, frames, &raw_fps, &rle_fps);
+            printf(" %10.0f %10.0f", raw_fps, rle_fps);
+        }
+        printf("\n");
+        runs.resize(leds);
+    }
+
+    return 0;
+}
+catch (const std::system_error &e) {
+    printf("failed to access %s\n", e.what());
+    exit(1);
+}
@@ -0,0 +1,75 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+
+#include "../sw/de10nano_hal.hpp"
+
+/*
+* Test vectors for tb_hsv_to_rgb.vhd, worked out with de10::hsv_to_rgb(),
+* the software reference for the component's HSV mode.
+*
+* Usage: hsv_vectors > hsv_vectors.txt
+*
+* Prints one line per LED, "colour hue_offset rgb" in hex, in frames of
+* FRAME_LEDS LEDs that share a hue offset: every hue at full, half and low
+* saturation and value, every saturation and every value on their own,
+* a grid of all three, and random colours with random offsets.
+*/
+
+// LEDs in one frame of the testbench, all its channels
+#define FRAME_LEDS 256
+#define RANDOM_FRAMES 8
+
+/**
+* print() - Print one vector.
+*/
+static void print(std::uint8_t hue, std::uint8_t sat, std::uint8_t val, std::uint8_t offset)
+{
+    std::uint32_t colour = de10::hsv(hue, sat, val);
+
+    std::printf("%06x %02x %06x\n", colour, offset, de10::hsv_to_rgb(colour, offset));
+}
+
+int main()
+{
+    static const std::uint8_t levels[] = { 255, 128, 1 };
+
+    // every hue, at a few saturations and values, with and without offset
+    for (std::uint8_t sat : levels) {
+        for (std::uint8_t val : levels) {
+            for (unsigned n = 0; n < FRAME_LEDS; n++) {
+                print(n, sat, val, 0);
+            }
+        }
+    }
+    for (unsigned n = 0; n < FRAME_LEDS; n++) {
+        print(n, 255, 255, 100);
+    }
+
+    // every saturation, and every value, over a few hues
+    for (std::uint8_t hue : { 0, 43, 128, 213, 255 }) {
+        for (unsigned n = 0; n < FRAME_LEDS; n++) {
+            print(hue, n, 255, 0);
+        }
+        for (unsigned n = 0; n < FRAME_LEDS; n++) {
+            print(hue, 200, n, 0);
+        }
+    }
+
+    // 16 x 16 saturations and values at every sixteenth hue
+    for (unsigned h = 0; h < 256; h += 16) {
+        for (unsigned n = 0; n < FRAME_LEDS; n++) {
+            print(h + n % 16, (n / 16) * 17, (n % 16) * 17, 0);
+        }
+    }
+
+    std::srand(1);
+    for (unsigned f = 0; f < RANDOM_FRAMES; f++) {
+        std::uint8_t offset = std::rand() & 0xff;
+
+        for (unsigned n = 0; n < FRAME_LEDS; n++) {
+            print(std::rand() & 0xff, std::rand() & 0xff, std::rand() & 0xff, offset);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,244 @@
+-- altera vhdl_input_version vhdl_2008
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+use IEEE.math_real.all;
+
+library work;
+use work.ws2811_tb_pkg.all;
+
+-- Checks brightness and the gamma table of ws_2811_driver_avalon against a
+-- reference LUT. It loads a different table into each colour: a 2.2 and a
+-- 2.8 power curve, worked out like de10::load_gamma, and random values, so
+-- entries also go down. It reads the table back over the bus, then fills
+-- the framebuffer so every colour takes all 256 values in one frame, and
+-- for each brightness and gamma setting in CASES decodes the frame off
+-- strip_output and compares every colour with the reference: the value
+-- scaled by brightness / 256 on 16 bits, then looked up, interpolating
+-- between two entries from the low byte, and cut to the top 8 bits.
+-- Reports "PASS" and finishes, or fails with the number of colours that
+-- differed.
+entity tb_colour_correction is
+  generic (
+    SEED : integer := 1
+  );
+end entity tb_colour_correction;
+
+architecture sim of tb_colour_correction is
+
+  constant CLK_PERIOD : time := 20 ns;
+  -- 256 LEDs, one for every value
+  constant LED_COUNT  : natural := 64;
+  constant CHANNELS   : natural := 4;
+  constant TOTAL      : natural := LED_COUNT * CHANNELS;
+
+  type lut_t is array (0 to 255) of natural range 0 to 255;
+  -- colour k in bits 8k+7 to 8k of the table words and of the colours
+  type lut_array is array (0 to 2) of lut_t;
+
+  type case_t is record
+    gamma      : boolean;
+    brightness : natural;
+  end record;
+  type case_array is array (natural range <>) of case_t;
+
+  constant CASES : case_array := (
+    (false, 256), -- as written
+    (true, 256),  -- the table, entry for entry
+    (true, 200),
+    (true, 77),
+    (false, 100),
+    (true, 0)
+  );
+
+  signal clk : std_logic := '0';
+  signal rst : std_logic := '1';
+
+  signal bus_out : avs_out_t := AVS_IDLE;
+  signal bus_in  : avs_in_t;
+
+  signal irq          : std_logic;
+  signal strip_output : std_logic_vector(CHANNELS - 1 downto 0);
+
+  signal frame    : colour_array(0 to TOTAL - 1);
+  signal complete : boolean;
+  signal frames   : natural;
+
+  -- the value of colour k at LED n, so each colour runs through all 256
+  -- values in its own order
+  function value(n : natural; k : natural) return natural is
+  begin
+    case k is
+      when 0      => return n;
+      when 1      => return (n * 7 + 3) mod 256;
+      when others => return 255 - n;
+    end case;
+  end function;
+
+  -- the reference
+  function correct(v : natural; brightness : natural; gamma : boolean; lut : lut_t) return natural is
+    variable scaled : natural;
+    variable lower  : natural;
+    variable upper  : natural;
+  begin
+    -- 8-bit colours enter the colour stage in the top byte of 16
+    scaled := v * 256 * brightness / 256;
+    if not gamma then
+      return scaled / 256;
+    end if;
+    lower := lut(scaled / 256);
+    upper := lut(minimum(scaled / 256 + 1, 255));
+    return (lower * 256 + (upper - lower) * (scaled mod 256)) / 256;
+  end function;
+
+begin
+
+  clk <= not clk after CLK_PERIOD / 2;
+
+  dut : entity work.ws_2811_driver_avalon
+    generic map (
+      LED_COUNT => LED_COUNT,
+      CHANNELS  => CHANNELS
+    )
+    port map (
+      clk               => clk,
+      rst               => rst,
+      avs_read          => bus_out.read,
+      avs_write         => bus_out.write,
+      avs_address       => bus_out.address,
+      avs_readdata      => bus_in.readdata,
+      avs_writedata     => bus_out.writedata,
+      avs_waitrequest   => bus_in.waitrequest,
+      avp_read          => '0',
+      avp_write         => '0',
+      avp_address       => (others => '0'),
+      avp_burstcount    => x"01",
+      avp_writedata     => (others => '0'),
+      avp_byteenable    => "1111",
+      avp_readdata      => open,
+      avp_readdatavalid => open,
+      avp_waitrequest   => open,
+      avm_address       => open,
+      avm_read          => open,
+      avm_burstcount    => open,
+      avm_readdata      => (others => '0'),
+      avm_readdatavalid => '0',
+      avm_waitrequest   => '0',
+      asi_data          => (others => '0'),
+      asi_valid         => '0',
+      asi_ready         => open,
+      asi_startofpacket => '0',
+      asi_endofpacket   => '0',
+      irq               => irq,
+      strip_index_out   => open,
+      strip_output      => strip_output
+    );
+
+  decoder : entity work.ws2811_decoder
+    generic map (
+      LED_COUNT => LED_COUNT,
+      CHANNELS  => CHANNELS
+    )
+    port map (
+      clk      => clk,
+      strip    => strip_output,
+      frame    => frame,
+      complete => complete,
+      frames   => frames
+    );
+
+  stimulus : process
+    variable seed1    : positive := SEED;
+    variable seed2    : positive := 2027;
+    variable r        : real;
+    variable lut      : lut_array;
+    variable data     : std_logic_vector(31 downto 0);
+    variable word     : std_logic_vector(31 downto 0);
+    variable stride   : natural;
+    variable colour   : std_logic_vector(23 downto 0);
+    variable expected : natural;
+    variable sent     : natural;
+    variable seen     : natural;
+    variable errors   : natural := 0;
+  begin
+    for v in 0 to 255 loop
+      uniform(seed1, seed2, r);
+      lut(0)(v) := integer(trunc(r * 256.0));
+      lut(1)(v) := integer(round(255.0 * (real(v) / 255.0) ** 2.8));
+      lut(2)(v) := integer(round(255.0 * (real(v) / 255.0) ** 2.2));
+    end loop;
+
+    wait for 5 * CLK_PERIOD;
+    wait until rising_edge(clk);
+    rst <= '0';
+    wait until rising_edge(clk);
+
+    avs_read(clk, bus_out, bus_in, REG_STRIDE, data);
+    stride := to_integer(unsigned(data));
+    set_sim_timing(clk, bus_out, bus_in);
+
+    for v in 0 to 255 loop
+      word := x"00" & std_logic_vector(to_unsigned(lut(2)(v), 8)) &
+              std_logic_vector(to_unsigned(lut(1)(v), 8)) & std_logic_vector(to_unsigned(lut(0)(v), 8));
+      avs_write(clk, bus_out, bus_in, GAMMA_BASE + v, word);
+    end loop;
+    for v in 0 to 255 loop
+      avs_read(clk, bus_out, bus_in, GAMMA_BASE + v, data);
+      word := x"00" & std_logic_vector(to_unsigned(lut(2)(v), 8)) &
+              std_logic_vector(to_unsigned(lut(1)(v), 8)) & std_logic_vector(to_unsigned(lut(0)(v), 8));
+      if data /= word then
+        report "gamma table word " & integer'image(v) & " reads " & to_hstring(data) &
+               ", written " & to_hstring(word) severity error;
+        errors := errors + 1;
+      end if;
+    end loop;
+
+    for n in 0 to TOTAL - 1 loop
+      colour := std_logic_vector(to_unsigned(value(n, 2), 8)) & std_logic_vector(to_unsigned(value(n, 1), 8)) &
+                std_logic_vector(to_unsigned(value(n, 0), 8));
+      avs_write(clk, bus_out, bus_in, FB_BASE + (n / LED_COUNT) * stride + n mod LED_COUNT, x"00" & colour);
+    end loop;
+    avs_write(clk, bus_out, bus_in, REG_COMMIT, x"00000001");
+
+    for t in CASES'range loop
+      avs_write(clk, bus_out, bus_in, REG_BRIGHTNESS, std_logic_vector(to_unsigned(CASES(t).brightness, 32)));
+      if CASES(t).gamma then
+        avs_write(clk, bus_out, bus_in, REG_CTRL, (CTRL_FRAMEBUFFER => '1', CTRL_GAMMA => '1', others => '0'));
+      else
+        avs_write(clk, bus_out, bus_in, REG_CTRL, (CTRL_FRAMEBUFFER => '1', others => '0'));
+      end if;
+
+      wait_frames(clk, bus_out, bus_in, irq, 2);
+      seen := frames;
+      wait until frames = seen + 1;
+
+      assert complete report "short frame" severity failure;
+      for n in 0 to TOTAL - 1 loop
+        for k in 0 to 2 loop
+          expected := correct(value(n, k), CASES(t).brightness, CASES(t).gamma, lut(k));
+          sent     := to_integer(unsigned(frame(n)(8 * k + 7 downto 8 * k)));
+          if sent /= expected then
+            report "gamma " & boolean'image(CASES(t).gamma) & ", brightness " &
+                   integer'image(CASES(t).brightness) & ", LED " & integer'image(n) & ", colour " &
+                   integer'image(k) & ": " & integer'image(value(n, k)) & " sent as " &
+                   integer'image(sent) & ", reference " & integer'image(expected) severity error;
+            errors := errors + 1;
+          end if;
+        end loop;
+      end loop;
+    end loop;
+
+    assert errors = 0 report "FAIL: " & integer'image(errors) & " colours differ" severity failure;
+    report "PASS: " & integer'image(CASES'length) & " settings";
+    std.env.finish;
+  end process;
+
+  watchdog : process
+  begin
+    wait for 100 ms;
+    report "timed out" severity failure;
+    wait;
+  end process;
+
+end architecture sim;
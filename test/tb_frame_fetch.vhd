@@ -0,0 +1,355 @@
+-- altera vhdl_input_version vhdl_2008
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+use IEEE.math_real.all;
+
+-- Checks frame_fetch against a model of the memory port it reads from: an
+-- Avalon-MM slave that holds off commands at random, takes bursts, answers
+-- them in order LATENCY clocks later, and can be made to stop answering,
+-- either holding waitrequest or taking commands and sitting on the words.
+-- It checks that a fetch copies every word of the frame to the right place
+-- and pulses done once, that it waits while hold is high, that a port that
+-- holds waitrequest, or takes the reads and never answers, makes the fetch
+-- give up within TIMEOUT clocks with busy low and failed set, and that the
+-- words such a port sends later are thrown away, never written, while the
+-- next fetch waits for them and then copies its frame whole. With
+-- waitrequest stuck high, the command on the bus when the fetch gives up
+-- must stay there unchanged until the port takes it, and a fetch started
+-- meanwhile must not issue another. An abort part way through a fetch does
+-- the same. Throughout, a command held off by waitrequest must stay on the
+-- bus unchanged until it is taken. Reports "PASS" and finishes, or fails at
+-- the first check that doesn't hold.
+entity tb_frame_fetch is
+  generic (
+    CHANNELS : integer := 2;
+    ROW      : integer := 50;
+    LATENCY  : integer := 8;
+    TIMEOUT  : integer := 200;
+    SEED     : integer := 1
+  );
+end entity tb_frame_fetch;
+
+architecture sim of tb_frame_fetch is
+
+  constant CLK_PERIOD    : time := 20 ns;
+  constant FB_ADDR_WIDTH : natural := 6;
+  constant BURST_WIDTH   : natural := 5;
+  constant TOTAL         : natural := CHANNELS * ROW;
+  constant BANK          : natural := 2**FB_ADDR_WIDTH;
+
+  type word_array is array (natural range <>) of std_logic_vector(31 downto 0);
+  type natural_array is array (natural range <>) of natural;
+
+  -- how the port behaves: answering, holding every command off, or taking
+  -- commands and keeping the words until it answers again
+  type port_mode is (answering, stalled, silent);
+
+  signal clk : std_logic := '0';
+  signal rst : std_logic := '1';
+
+  signal start   : std_logic := '0';
+  signal abort   : std_logic := '0';
+  signal base    : std_logic_vector(31 downto 0) := (others => '0');
+  signal hold    : std_logic := '0';
+  signal busy    : std_logic;
+  signal done    : std_logic;
+  signal failed  : std_logic;
+
+  signal address       : std_logic_vector(31 downto 0);
+  signal read          : std_logic;
+  signal burstcount    : std_logic_vector(BURST_WIDTH - 1 downto 0);
+  signal readdata      : std_logic_vector(31 downto 0) := (others => '0');
+  signal readdatavalid : std_logic := '0';
+  signal waitrequest   : std_logic := '1';
+
+  signal fb_write   : std_logic;
+  signal fb_channel : natural range 0 to CHANNELS - 1;
+  signal fb_word    : unsigned(FB_ADDR_WIDTH - 1 downto 0);
+  signal fb_wdata   : std_logic_vector(31 downto 0);
+
+  signal mode : port_mode := answering;
+  -- memory contents are worked out from the address and generation
+  signal generation : natural := 0;
+  -- words the port has taken reads for and not yet answered
+  signal owing      : natural := 0;
+
+  signal fb     : word_array(0 to CHANNELS * BANK - 1) := (others => (others => '0'));
+  signal writes : natural := 0;
+  signal dones  : natural := 0;
+
+  function memory(gen : natural; byte_address : natural) return std_logic_vector is
+  begin
+    return std_logic_vector(to_unsigned((byte_address / 4 * 40503 + gen * 1000003) mod 2**30, 32));
+  end function;
+
+begin
+
+  clk <= not clk after CLK_PERIOD / 2;
+
+  dut : entity work.frame_fetch
+    generic map (
+      CHANNELS      => CHANNELS,
+      FB_ADDR_WIDTH => FB_ADDR_WIDTH,
+      BURST_WIDTH   => BURST_WIDTH,
+      TIMEOUT       => TIMEOUT
+    )
+    port map (
+      clk           => clk,
+      rst           => rst,
+      start         => start,
+      abort         => abort,
+      base          => base,
+      row           => ROW,
+      hold          => hold,
+      busy          => busy,
+      done          => done,
+      failed        => failed,
+      address       => address,
+      read          => read,
+      burstcount    => burstcount,
+      readdata      => readdata,
+      readdatavalid => readdatavalid,
+      waitrequest   => waitrequest,
+      fb_write      => fb_write,
+      fb_channel    => fb_channel,
+      fb_word       => fb_word,
+      fb_wdata      => fb_wdata
+    );
+
+  -- The memory port: every word of a burst taken is queued with the clock
+  -- it may be answered on
+  memory_port : process
+    constant QUEUE : natural := 4096;
+    variable seed1   : positive := SEED;
+    variable seed2   : positive := 32749;
+    variable r       : real;
+    variable cycle   : natural := 0;
+    variable addrs   : natural_array(0 to QUEUE - 1);
+    variable due     : natural_array(0 to QUEUE - 1);
+    variable head    : natural := 0;
+    variable tail    : natural := 0;
+  begin
+    wait until rising_edge(clk);
+    cycle := cycle + 1;
+
+    if read = '1' and waitrequest = '0' then
+      for k in 0 to to_integer(unsigned(burstcount)) - 1 loop
+        addrs(tail) := to_integer(unsigned(address)) + 4 * k;
+        due(tail)   := cycle + LATENCY;
+        tail        := (tail + 1) mod QUEUE;
+      end loop;
+    end if;
+
+    readdatavalid <= '0';
+    if mode /= silent and head /= tail and due(head) <= cycle then
+      readdata      <= memory(generation, addrs(head));
+      readdatavalid <= '1';
+      head          := (head + 1) mod QUEUE;
+    end if;
+    owing <= (tail - head) mod QUEUE;
+
+    uniform(seed1, seed2, r);
+    if mode = stalled or r < 0.25 then
+      waitrequest <= '1';
+    else
+      waitrequest <= '0';
+    end if;
+  end process;
+
+  -- Avalon: a read held off by waitrequest stays, unchanged, until taken
+  avalon_rules : process
+    variable was_held   : boolean := false;
+    variable last_addr  : std_logic_vector(31 downto 0);
+    variable last_burst : std_logic_vector(BURST_WIDTH - 1 downto 0);
+  begin
+    wait until rising_edge(clk);
+    if was_held then
+      assert read = '1' report "read dropped before the port took it" severity failure;
+      assert address = last_addr and burstcount = last_burst
+        report "command changed before the port took it" severity failure;
+    end if;
+    was_held   := rst = '0' and read = '1' and waitrequest = '1';
+    last_addr  := address;
+    last_burst := burstcount;
+  end process;
+
+  framebuffer : process
+  begin
+    wait until rising_edge(clk);
+    if fb_write = '1' then
+      fb(fb_channel * BANK + to_integer(fb_word)) <= fb_wdata;
+      writes <= writes + 1;
+    end if;
+    if done = '1' then
+      dones <= dones + 1;
+    end if;
+  end process;
+
+  stimulus : process
+    variable first_writes : natural;
+    variable first_dones  : natural;
+    variable clocks       : natural;
+    variable cmd_address  : std_logic_vector(31 downto 0);
+    variable cmd_burst    : std_logic_vector(BURST_WIDTH - 1 downto 0);
+
+    procedure start_fetch(byte_address : natural) is
+    begin
+      base  <= std_logic_vector(to_unsigned(byte_address, 32));
+      start <= '1';
+      wait until rising_edge(clk);
+      start <= '0';
+      first_writes := writes;
+      first_dones  := dones;
+      -- busy shows from the clock after
+      wait until rising_edge(clk);
+    end procedure;
+
+    -- clocks until busy drops, failing past limit
+    procedure wait_idle(limit : natural; what : string) is
+    begin
+      clocks := 0;
+      while busy = '1' loop
+        wait until rising_edge(clk);
+        clocks := clocks + 1;
+        assert clocks <= limit report what & ": still busy after " & integer'image(limit) & " clocks"
+          severity failure;
+      end loop;
+      -- let the last write and done land
+      wait until rising_edge(clk);
+    end procedure;
+
+    procedure check_frame(gen : natural; byte_address : natural; what : string) is
+      variable expected : std_logic_vector(31 downto 0);
+    begin
+      assert failed = '0' report what & ": failed set" severity failure;
+      assert dones = first_dones + 1 report what & ": done pulsed " &
+        integer'image(dones - first_dones) & " times" severity failure;
+      assert writes = first_writes + TOTAL report what & ": " & integer'image(writes - first_writes) &
+        " words written, not " & integer'image(TOTAL) severity failure;
+      for n in 0 to TOTAL - 1 loop
+        expected := memory(gen, byte_address + 4 * n);
+        assert fb((n / ROW) * BANK + n mod ROW) = expected
+          report what & ": word " & integer'image(n) & " is " & to_hstring(fb((n / ROW) * BANK + n mod ROW)) &
+                 ", memory holds " & to_hstring(expected) severity failure;
+      end loop;
+    end procedure;
+
+    procedure check_given_up(what : string) is
+    begin
+      assert failed = '1' report what & ": failed not set" severity failure;
+      assert dones = first_dones report what & ": done pulsed" severity failure;
+    end procedure;
+  begin
+    wait for 5 * CLK_PERIOD;
+    wait until rising_edge(clk);
+    rst <= '0';
+    wait until rising_edge(clk);
+
+    -- a whole frame, with bit 0 of the address, the commit bit, ignored
+    generation <= 1;
+    start_fetch(16#1001#);
+    wait_idle(TOTAL * 8 + LATENCY + TIMEOUT, "fetch");
+    check_frame(1, 16#1000#, "fetch");
+
+    -- nothing is read while hold is high
+    hold <= '1';
+    generation <= 2;
+    start_fetch(16#2000#);
+    for i in 1 to 50 loop
+      wait until rising_edge(clk);
+      assert read = '0' report "hold: read while held" severity failure;
+      assert busy = '1' report "hold: not busy while waiting" severity failure;
+    end loop;
+    hold <= '0';
+    wait_idle(TOTAL * 8 + LATENCY + TIMEOUT, "hold");
+    check_frame(2, 16#2000#, "hold");
+
+    -- a port that holds waitrequest: given up on, with the command it
+    -- hasn't taken left on the bus as it was
+    mode <= stalled;
+    start_fetch(16#3000#);
+    wait until rising_edge(clk) and read = '1';
+    cmd_address := address;
+    cmd_burst   := burstcount;
+    wait_idle(TIMEOUT + 10, "stalled port");
+    check_given_up("stalled port");
+    assert writes = first_writes report "stalled port: words written" severity failure;
+    for i in 1 to 2 * TIMEOUT loop
+      wait until rising_edge(clk);
+      assert read = '1' and address = cmd_address and burstcount = cmd_burst
+        report "stalled port: command dropped or changed before it was taken" severity failure;
+    end loop;
+
+    -- a fetch started meanwhile issues nothing of its own, and gives up
+    start_fetch(16#3800#);
+    wait_idle(TIMEOUT + 10, "held command");
+    check_given_up("held command");
+    assert address = cmd_address and burstcount = cmd_burst
+      report "held command: another command issued" severity failure;
+
+    -- once the port takes it, its words are thrown away
+    mode <= answering;
+    wait until rising_edge(clk) and read = '0';
+    if owing /= 0 then
+      wait until owing = 0;
+    end if;
+    wait until rising_edge(clk);
+    assert writes = first_writes report "stalled port: " & integer'image(writes - first_writes) &
+      " late words written" severity failure;
+
+    -- a port that takes the reads and sits on the words
+    mode <= silent;
+    start_fetch(16#4000#);
+    wait_idle(TIMEOUT + TOTAL * 8, "silent port");
+    check_given_up("silent port");
+    assert owing > 0 report "silent port: nothing taken, so nothing tested" severity failure;
+    first_writes := writes;
+
+    -- the next fetch waits for those words, and gives up while they don't come
+    start_fetch(16#5000#);
+    for i in 1 to 20 loop
+      wait until rising_edge(clk);
+      assert read = '0' report "silent port: read with words still owed" severity failure;
+    end loop;
+    wait_idle(TIMEOUT + 10, "owed words");
+    check_given_up("owed words");
+
+    -- once they come they are thrown away, and the next fetch is whole
+    mode <= answering;
+    wait until owing = 0;
+    wait until rising_edge(clk);
+    assert writes = first_writes report "silent port: " & integer'image(writes - first_writes) &
+      " late words written" severity failure;
+    generation <= 3;
+    start_fetch(16#6000#);
+    wait_idle(TOTAL * 8 + LATENCY + TIMEOUT, "after silent port");
+    check_frame(3, 16#6000#, "after silent port");
+
+    -- an abort part way through
+    start_fetch(16#7000#);
+    wait until writes = first_writes + TOTAL / 2;
+    abort <= '1';
+    wait until rising_edge(clk);
+    abort <= '0';
+    wait until rising_edge(clk);
+    assert busy = '0' report "abort: still busy" severity failure;
+    check_given_up("abort");
+    generation <= 4;
+    start_fetch(16#8000#);
+    wait_idle(TOTAL * 8 + LATENCY + TIMEOUT, "after abort");
+    check_frame(4, 16#8000#, "after abort");
+
+    report "PASS";
+    std.env.finish;
+  end process;
+
+  watchdog : process
+  begin
+    wait for 10 ms;
+    report "timed out" severity failure;
+    wait;
+  end process;
+
+end architecture sim;
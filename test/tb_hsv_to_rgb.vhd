@@ -0,0 +1,178 @@
+-- altera vhdl_input_version vhdl_2008
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+
+library std;
+use std.textio.all;
+
+library work;
+use work.ws2811_tb_pkg.all;
+
+-- Checks the HSV mode of ws_2811_driver_avalon against hsv_to_rgb() in
+-- sw/de10nano_hal.hpp, which is meant to match it bit for bit. The vectors
+-- come from hsv_vectors.cpp: lines of "colour hue_offset rgb" in hex, in
+-- groups of 256 that share a hue offset. For every group it writes the
+-- colours to the framebuffer and the offset to hue_offset, sets HSV mode,
+-- decodes the frame that shows them off strip_output, and compares every
+-- LED with the rgb the software worked out. Reports "PASS" and finishes,
+-- or fails with the number of LEDs that differed.
+entity tb_hsv_to_rgb is
+  generic (
+    VECTORS : string := "hsv_vectors.txt"
+  );
+end entity tb_hsv_to_rgb;
+
+architecture sim of tb_hsv_to_rgb is
+
+  constant CLK_PERIOD : time := 20 ns;
+  -- 256 LEDs, one group of vectors a frame
+  constant LED_COUNT  : natural := 64;
+  constant CHANNELS   : natural := 4;
+  constant TOTAL      : natural := LED_COUNT * CHANNELS;
+
+  signal clk : std_logic := '0';
+  signal rst : std_logic := '1';
+
+  signal bus_out : avs_out_t := AVS_IDLE;
+  signal bus_in  : avs_in_t;
+
+  signal irq          : std_logic;
+  signal strip_output : std_logic_vector(CHANNELS - 1 downto 0);
+
+  signal frame    : colour_array(0 to TOTAL - 1);
+  signal complete : boolean;
+  signal frames   : natural;
+
+begin
+
+  clk <= not clk after CLK_PERIOD / 2;
+
+  dut : entity work.ws_2811_driver_avalon
+    generic map (
+      LED_COUNT => LED_COUNT,
+      CHANNELS  => CHANNELS
+    )
+    port map (
+      clk               => clk,
+      rst               => rst,
+      avs_read          => bus_out.read,
+      avs_write         => bus_out.write,
+      avs_address       => bus_out.address,
+      avs_readdata      => bus_in.readdata,
+      avs_writedata     => bus_out.writedata,
+      avs_waitrequest   => bus_in.waitrequest,
+      avp_read          => '0',
+      avp_write         => '0',
+      avp_address       => (others => '0'),
+      avp_burstcount    => x"01",
+      avp_writedata     => (others => '0'),
+      avp_byteenable    => "1111",
+      avp_readdata      => open,
+      avp_readdatavalid => open,
+      avp_waitrequest   => open,
+      avm_address       => open,
+      avm_read          => open,
+      avm_burstcount    => open,
+      avm_readdata      => (others => '0'),
+      avm_readdatavalid => '0',
+      avm_waitrequest   => '0',
+      asi_data          => (others => '0'),
+      asi_valid         => '0',
+      asi_ready         => open,
+      asi_startofpacket => '0',
+      asi_endofpacket   => '0',
+      irq               => irq,
+      strip_index_out   => open,
+      strip_output      => strip_output
+    );
+
+  decoder : entity work.ws2811_decoder
+    generic map (
+      LED_COUNT => LED_COUNT,
+      CHANNELS  => CHANNELS
+    )
+    port map (
+      clk      => clk,
+      strip    => strip_output,
+      frame    => frame,
+      complete => complete,
+      frames   => frames
+    );
+
+  stimulus : process
+    file vector_file : text;
+    variable status   : file_open_status;
+    variable l        : line;
+    variable data     : std_logic_vector(31 downto 0);
+    variable stride   : natural;
+    variable colour   : std_logic_vector(23 downto 0);
+    variable offset   : std_logic_vector(7 downto 0);
+    variable first    : std_logic_vector(7 downto 0);
+    variable expected : colour_array(0 to TOTAL - 1);
+    variable inputs   : colour_array(0 to TOTAL - 1);
+    variable group    : natural := 0;
+    variable seen     : natural;
+    variable errors   : natural := 0;
+  begin
+    file_open(status, vector_file, VECTORS, read_mode);
+    assert status = open_ok report "cannot open " & VECTORS & "; run hsv_vectors first" severity failure;
+
+    wait for 5 * CLK_PERIOD;
+    wait until rising_edge(clk);
+    rst <= '0';
+    wait until rising_edge(clk);
+
+    avs_read(clk, bus_out, bus_in, REG_STRIDE, data);
+    stride := to_integer(unsigned(data));
+    set_sim_timing(clk, bus_out, bus_in);
+    avs_write(clk, bus_out, bus_in, REG_CTRL, (CTRL_FRAMEBUFFER => '1', CTRL_HSV => '1', others => '0'));
+
+    while not endfile(vector_file) loop
+      for n in 0 to TOTAL - 1 loop
+        assert not endfile(vector_file) report VECTORS & " ends part way through a group" severity failure;
+        readline(vector_file, l);
+        hread(l, colour);
+        hread(l, offset);
+        hread(l, expected(n));
+        if n = 0 then
+          first := offset;
+        end if;
+        assert offset = first report VECTORS & ": hue offsets differ within a group" severity failure;
+        inputs(n) := colour;
+        avs_write(clk, bus_out, bus_in, FB_BASE + (n / LED_COUNT) * stride + n mod LED_COUNT, x"00" & colour);
+      end loop;
+      avs_write(clk, bus_out, bus_in, REG_HUE_OFFSET, x"000000" & first);
+      avs_write(clk, bus_out, bus_in, REG_COMMIT, x"00000001");
+
+      wait_frames(clk, bus_out, bus_in, irq, 2);
+      seen := frames;
+      wait until frames = seen + 1;
+
+      assert complete report "short frame" severity failure;
+      for n in 0 to TOTAL - 1 loop
+        if frame(n) /= expected(n) then
+          report "hsv " & to_hstring(inputs(n)) & ", hue offset " & to_hstring(first) & ": sent " &
+                 to_hstring(frame(n)) & ", hsv_to_rgb() " & to_hstring(expected(n)) severity error;
+          errors := errors + 1;
+        end if;
+      end loop;
+      group := group + 1;
+    end loop;
+    file_close(vector_file);
+
+    assert group > 0 report VECTORS & " is empty" severity failure;
+    assert errors = 0 report "FAIL: " & integer'image(errors) & " colours differ" severity failure;
+    report "PASS: " & integer'image(group * TOTAL) & " colours";
+    std.env.finish;
+  end process;
+
+  watchdog : process
+  begin
+    wait for 1 sec;
+    report "timed out" severity failure;
+    wait;
+  end process;
+
+end architecture sim;
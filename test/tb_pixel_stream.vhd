@@ -0,0 +1,222 @@
+-- altera vhdl_input_version vhdl_2008
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+use IEEE.math_real.all;
+
+library work;
+use work.ws2811_tb_pkg.all;
+
+-- Streams frames much longer than the FIFO through the Avalon-ST sink of
+-- ws_2811_driver_avalon and checks what comes out of strip_output. A
+-- producer sends frame after frame, a packet each, with random idle clocks
+-- between beats and holding every beat until ready. LED 0 of channel 0
+-- carries the frame's number and every other LED a colour worked out from
+-- it, so each decoded frame can be checked on its own, and the frames in a
+-- row must carry numbers in a row: none lost, none shown twice. Every
+-- fourth frame has a few beats too many, which the sink has to drop at the
+-- end of the frame. Once the stream is in step it clears the underflow
+-- counter, checks FRAMES frames, and expects no underflows and, as the
+-- producer is far faster than the strip, some backpressure. Reports "PASS"
+-- and finishes, or fails with the number of LEDs that differed.
+entity tb_pixel_stream is
+  generic (
+    LED_COUNT    : integer := 600;
+    CHANNELS     : integer := 2;
+    STREAM_DEPTH : integer := 64;
+    FRAMES       : integer := 6;
+    SEED         : integer := 1
+  );
+end entity tb_pixel_stream;
+
+architecture sim of tb_pixel_stream is
+
+  constant CLK_PERIOD : time := 20 ns;
+  constant TOTAL      : natural := LED_COUNT * CHANNELS;
+  -- beats past the end of every fourth frame
+  constant EXTRA      : natural := 3;
+
+  signal clk : std_logic := '0';
+  signal rst : std_logic := '1';
+
+  signal bus_out : avs_out_t := AVS_IDLE;
+  signal bus_in  : avs_in_t;
+
+  signal asi_data          : std_logic_vector(24 * CHANNELS - 1 downto 0) := (others => '0');
+  signal asi_valid         : std_logic := '0';
+  signal asi_ready         : std_logic;
+  signal asi_startofpacket : std_logic := '0';
+  signal asi_endofpacket   : std_logic := '0';
+
+  signal irq          : std_logic;
+  signal strip_output : std_logic_vector(CHANNELS - 1 downto 0);
+
+  signal frame       : colour_array(0 to TOTAL - 1);
+  signal complete    : boolean;
+  signal frames_seen : natural;
+
+  -- LED i of channel c in frame number tag, at n = c * LED_COUNT + i
+  function colour(tag : natural; n : natural) return std_logic_vector is
+  begin
+    if n = 0 then
+      return std_logic_vector(to_unsigned(tag, 24));
+    end if;
+    return std_logic_vector(to_unsigned((tag * 7919 + n * 104729 + n * n) mod 2**24, 24));
+  end function;
+
+begin
+
+  clk <= not clk after CLK_PERIOD / 2;
+
+  dut : entity work.ws_2811_driver_avalon
+    generic map (
+      LED_COUNT    => LED_COUNT,
+      CHANNELS     => CHANNELS,
+      STREAM_DEPTH => STREAM_DEPTH
+    )
+    port map (
+      clk               => clk,
+      rst               => rst,
+      avs_read          => bus_out.read,
+      avs_write         => bus_out.write,
+      avs_address       => bus_out.address,
+      avs_readdata      => bus_in.readdata,
+      avs_writedata     => bus_out.writedata,
+      avs_waitrequest   => bus_in.waitrequest,
+      avp_read          => '0',
+      avp_write         => '0',
+      avp_address       => (others => '0'),
+      avp_burstcount    => x"01",
+      avp_writedata     => (others => '0'),
+      avp_byteenable    => "1111",
+      avp_readdata      => open,
+      avp_readdatavalid => open,
+      avp_waitrequest   => open,
+      avm_address       => open,
+      avm_read          => open,
+      avm_burstcount    => open,
+      avm_readdata      => (others => '0'),
+      avm_readdatavalid => '0',
+      avm_waitrequest   => '0',
+      asi_data          => asi_data,
+      asi_valid         => asi_valid,
+      asi_ready         => asi_ready,
+      asi_startofpacket => asi_startofpacket,
+      asi_endofpacket   => asi_endofpacket,
+      irq               => irq,
+      strip_index_out   => open,
+      strip_output      => strip_output
+    );
+
+  decoder : entity work.ws2811_decoder
+    generic map (
+      LED_COUNT => LED_COUNT,
+      CHANNELS  => CHANNELS
+    )
+    port map (
+      clk      => clk,
+      strip    => strip_output,
+      frame    => frame,
+      complete => complete,
+      frames   => frames_seen
+    );
+
+  producer : process
+    variable seed1 : positive := SEED;
+    variable seed2 : positive := 8191;
+    variable r     : real;
+    variable beats : natural;
+    variable tag   : natural := 0;
+  begin
+    wait until rising_edge(clk) and rst = '0';
+    loop
+      beats := LED_COUNT;
+      if tag mod 4 = 3 then
+        beats := LED_COUNT + EXTRA;
+      end if;
+      for i in 0 to beats - 1 loop
+        uniform(seed1, seed2, r);
+        for idle in 1 to integer(trunc(r * 3.0)) loop
+          wait until rising_edge(clk);
+        end loop;
+        for c in 0 to CHANNELS - 1 loop
+          if i < LED_COUNT then
+            asi_data(24 * c + 23 downto 24 * c) <= colour(tag, c * LED_COUNT + i);
+          else
+            asi_data(24 * c + 23 downto 24 * c) <= x"FFFFFF";
+          end if;
+        end loop;
+        asi_valid         <= '1';
+        asi_startofpacket <= '1' when i = 0 else '0';
+        asi_endofpacket   <= '1' when i = beats - 1 else '0';
+        wait until rising_edge(clk) and asi_ready = '1';
+        asi_valid <= '0';
+      end loop;
+      tag := tag + 1;
+    end loop;
+  end process;
+
+  stimulus : process
+    variable data   : std_logic_vector(31 downto 0);
+    variable first  : natural;
+    variable tag    : natural;
+    variable seen   : natural;
+    variable errors : natural := 0;
+  begin
+    wait for 5 * CLK_PERIOD;
+    wait until rising_edge(clk);
+    rst <= '0';
+    wait until rising_edge(clk);
+
+    set_sim_timing(clk, bus_out, bus_in);
+    avs_write(clk, bus_out, bus_in, REG_CTRL, (CTRL_STREAM => '1', others => '0'));
+
+    -- the stream turns on at the end of a frame and finds the start of a
+    -- packet in the one after; from the next one on it is in step
+    wait_frames(clk, bus_out, bus_in, irq, 3);
+    avs_write(clk, bus_out, bus_in, REG_STREAM_UNDERFLOW, x"00000000");
+
+    for f in 0 to FRAMES - 1 loop
+      seen := frames_seen;
+      wait until frames_seen = seen + 1;
+
+      assert complete report "short frame" severity failure;
+      tag := to_integer(unsigned(frame(0)));
+      if f = 0 then
+        first := tag;
+      elsif tag /= first + f then
+        report "frame " & integer'image(f) & " is number " & integer'image(tag) & ", expected " &
+               integer'image(first + f) severity error;
+        errors := errors + 1;
+      end if;
+      for n in 1 to TOTAL - 1 loop
+        if frame(n) /= colour(tag, n) then
+          report "frame number " & integer'image(tag) & ", LED " & integer'image(n) & ": sent " &
+                 to_hstring(frame(n)) & ", streamed " & to_hstring(colour(tag, n)) severity error;
+          errors := errors + 1;
+        end if;
+      end loop;
+    end loop;
+
+    avs_read(clk, bus_out, bus_in, REG_STREAM_UNDERFLOW, data);
+    assert unsigned(data) = 0
+      report "FAIL: " & integer'image(to_integer(unsigned(data))) & " underflows" severity failure;
+    avs_read(clk, bus_out, bus_in, REG_STREAM_BACKPRESSURE, data);
+    assert unsigned(data) > 0 report "FAIL: no backpressure with the FIFO full" severity failure;
+
+    assert errors = 0 report "FAIL: " & integer'image(errors) & " LEDs differ" severity failure;
+    report "PASS: " & integer'image(FRAMES) & " frames of " & integer'image(LED_COUNT) & " beats through a " &
+           integer'image(STREAM_DEPTH) & " beat FIFO, " & integer'image(to_integer(unsigned(data))) &
+           " clocks of backpressure";
+    std.env.finish;
+  end process;
+
+  watchdog : process
+  begin
+    wait for 200 ms;
+    report "timed out" severity failure;
+    wait;
+  end process;
+
+end architecture sim;
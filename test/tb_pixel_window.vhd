@@ -0,0 +1,299 @@
+-- altera vhdl_input_version vhdl_2008
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+use IEEE.math_real.all;
+
+library work;
+use work.ws2811_tb_pkg.all;
+
+-- Full-frame upload benchmark for ws_2811_driver_avalon. It uploads a frame
+-- of random colours for every channel three ways and times each in clocks:
+-- a word at a time through the register slave, into each channel's bank,
+-- as the driver's pwrite() does; a word at a time through the pixel window;
+-- and through the pixel window in bursts of BURST words. GAP idle clocks
+-- follow every transaction, standing in for what a bridge spends between
+-- them, so single words pay it once a word and bursts once a burst; with
+-- GAP 0 the figures are the component's own. After every upload it reads
+-- the frame back through the window in bursts and compares it, and after
+-- the last it writes a burst in which only some beats enable every byte,
+-- as a wider bridge sends, and a word past the last channel, and checks
+-- that only whole words landed. Then it commits the frame and decodes it
+-- off strip_output. Reports the clocks and MB/s at 50 MHz for each way and
+-- how much faster bursts through the window are than the register slave,
+-- then "PASS", and finishes, or fails with the number of words that
+-- differed.
+entity tb_pixel_window is
+  generic (
+    LED_COUNT : integer := 256;
+    CHANNELS  : integer := 4;
+    BURST     : integer := 128;
+    GAP       : natural := 4;
+    SEED      : integer := 1
+  );
+end entity tb_pixel_window;
+
+architecture sim of tb_pixel_window is
+
+  constant CLK_PERIOD : time := 20 ns;
+  constant TOTAL      : natural := LED_COUNT * CHANNELS;
+
+  type method_t is (registers, window_single, window_burst);
+  type clocks_array is array (method_t) of natural;
+
+  -- the byteenables of a short burst: a 64-bit bridge sends the half of
+  -- its data path a 32-bit store doesn't use with none enabled, and a
+  -- narrower store enables some; only whole words may land
+  type enables_array is array (natural range <>) of std_logic_vector(3 downto 0);
+  constant ENABLES : enables_array := ("1111", "0000", "0011", "1100", "1111", "0001");
+
+  signal clk : std_logic := '0';
+  signal rst : std_logic := '1';
+
+  signal bus_out : avs_out_t := AVS_IDLE;
+  signal bus_in  : avs_in_t;
+
+  signal avp_read          : std_logic := '0';
+  signal avp_write         : std_logic := '0';
+  signal avp_address       : std_logic_vector(12 downto 0) := (others => '0');
+  signal avp_burstcount    : std_logic_vector(7 downto 0) := x"01";
+  signal avp_writedata     : std_logic_vector(31 downto 0) := (others => '0');
+  signal avp_byteenable    : std_logic_vector(3 downto 0) := "1111";
+  signal avp_readdata      : std_logic_vector(31 downto 0);
+  signal avp_readdatavalid : std_logic;
+  signal avp_waitrequest   : std_logic;
+
+  signal irq          : std_logic;
+  signal strip_output : std_logic_vector(CHANNELS - 1 downto 0);
+
+  signal frame    : colour_array(0 to TOTAL - 1);
+  signal complete : boolean;
+  signal frames   : natural;
+
+begin
+
+  clk <= not clk after CLK_PERIOD / 2;
+
+  dut : entity work.ws_2811_driver_avalon
+    generic map (
+      LED_COUNT => LED_COUNT,
+      CHANNELS  => CHANNELS
+    )
+    port map (
+      clk               => clk,
+      rst               => rst,
+      avs_read          => bus_out.read,
+      avs_write         => bus_out.write,
+      avs_address       => bus_out.address,
+      avs_readdata      => bus_in.readdata,
+      avs_writedata     => bus_out.writedata,
+      avs_waitrequest   => bus_in.waitrequest,
+      avp_read          => avp_read,
+      avp_write         => avp_write,
+      avp_address       => avp_address,
+      avp_burstcount    => avp_burstcount,
+      avp_writedata     => avp_writedata,
+      avp_byteenable    => avp_byteenable,
+      avp_readdata      => avp_readdata,
+      avp_readdatavalid => avp_readdatavalid,
+      avp_waitrequest   => avp_waitrequest,
+      avm_address       => open,
+      avm_read          => open,
+      avm_burstcount    => open,
+      avm_readdata      => (others => '0'),
+      avm_readdatavalid => '0',
+      avm_waitrequest   => '0',
+      asi_data          => (others => '0'),
+      asi_valid         => '0',
+      asi_ready         => open,
+      asi_startofpacket => '0',
+      asi_endofpacket   => '0',
+      irq               => irq,
+      strip_index_out   => open,
+      strip_output      => strip_output
+    );
+
+  decoder : entity work.ws2811_decoder
+    generic map (
+      LED_COUNT => LED_COUNT,
+      CHANNELS  => CHANNELS
+    )
+    port map (
+      clk      => clk,
+      strip    => strip_output,
+      frame    => frame,
+      complete => complete,
+      frames   => frames
+    );
+
+  stimulus : process
+    variable seed1  : positive := SEED;
+    variable seed2  : positive := 16381;
+    variable r      : real;
+    variable data   : std_logic_vector(31 downto 0);
+    variable stride : natural;
+    variable words  : colour_array(0 to TOTAL - 1);
+    variable start  : time;
+    variable clocks : clocks_array;
+    variable seen   : natural;
+    variable errors : natural := 0;
+
+    procedure idle(count : natural) is
+    begin
+      for i in 1 to count loop
+        wait until rising_edge(clk);
+      end loop;
+    end procedure;
+
+    -- a write burst of the words from first on, one beat a clock when the
+    -- window lets it
+    procedure window_write(first : natural; count : natural) is
+    begin
+      avp_address    <= std_logic_vector(to_unsigned(first, 13));
+      avp_burstcount <= std_logic_vector(to_unsigned(count, 8));
+      avp_write      <= '1';
+      for n in first to first + count - 1 loop
+        avp_writedata <= x"00" & words(n);
+        wait until rising_edge(clk) and avp_waitrequest = '0';
+      end loop;
+      avp_write <= '0';
+    end procedure;
+
+    -- reads the words from first on in one burst and counts the ones that
+    -- differ from words
+    procedure window_check(first : natural; count : natural; what : string) is
+      variable n : natural := first;
+    begin
+      avp_address    <= std_logic_vector(to_unsigned(first, 13));
+      avp_burstcount <= std_logic_vector(to_unsigned(count, 8));
+      avp_read       <= '1';
+      wait until rising_edge(clk) and avp_waitrequest = '0';
+      avp_read <= '0';
+      while n < first + count loop
+        wait until rising_edge(clk) and avp_readdatavalid = '1';
+        if avp_readdata /= x"00" & words(n) then
+          report what & ": word " & integer'image(n) & " reads " & to_hstring(avp_readdata) &
+                 ", written " & to_hstring(words(n)) severity error;
+          errors := errors + 1;
+        end if;
+        n := n + 1;
+      end loop;
+    end procedure;
+  begin
+    wait for 5 * CLK_PERIOD;
+    wait until rising_edge(clk);
+    rst <= '0';
+    wait until rising_edge(clk);
+
+    avs_read(clk, bus_out, bus_in, REG_STRIDE, data);
+    stride := to_integer(unsigned(data));
+    set_sim_timing(clk, bus_out, bus_in);
+    avs_write(clk, bus_out, bus_in, REG_CTRL, (CTRL_FRAMEBUFFER => '1', others => '0'));
+
+    for method in method_t loop
+      for n in 0 to TOTAL - 1 loop
+        uniform(seed1, seed2, r);
+        words(n) := std_logic_vector(to_unsigned(integer(trunc(r * 2.0**24)), 24));
+      end loop;
+
+      start := now;
+      case method is
+        when registers =>
+          for n in 0 to TOTAL - 1 loop
+            avs_write(clk, bus_out, bus_in, FB_BASE + (n / LED_COUNT) * stride + n mod LED_COUNT,
+                      x"00" & words(n));
+            idle(GAP);
+          end loop;
+        when window_single =>
+          for n in 0 to TOTAL - 1 loop
+            window_write(n, 1);
+            idle(GAP);
+          end loop;
+        when window_burst =>
+          for n in 0 to (TOTAL - 1) / BURST loop
+            window_write(n * BURST, minimum(BURST, TOTAL - n * BURST));
+            idle(GAP);
+          end loop;
+      end case;
+      clocks(method) := (now - start) / CLK_PERIOD;
+      report method_t'image(method) & ": " & integer'image(TOTAL) & " words in " &
+             integer'image(clocks(method)) & " clocks, " &
+             integer'image(integer(real(TOTAL) * 200.0 / real(clocks(method)))) & " MB/s at 50 MHz";
+
+      for n in 0 to (TOTAL - 1) / BURST loop
+        window_check(n * BURST, minimum(BURST, TOTAL - n * BURST), method_t'image(method));
+      end loop;
+    end loop;
+
+    assert GAP = 0 or clocks(window_burst) < clocks(window_single)
+      report "FAIL: bursts are no faster than single words" severity failure;
+    report "window bursts against the register slave: " &
+           integer'image(integer(10.0 * real(clocks(registers)) / real(clocks(window_burst))) / 10) & "." &
+           integer'image(integer(10.0 * real(clocks(registers)) / real(clocks(window_burst))) mod 10) &
+           " times the throughput";
+
+    -- a burst that enables every byte of only some beats
+    avp_address    <= (others => '0');
+    avp_burstcount <= std_logic_vector(to_unsigned(ENABLES'length, 8));
+    avp_write      <= '1';
+    for n in ENABLES'range loop
+      uniform(seed1, seed2, r);
+      data := x"00" & std_logic_vector(to_unsigned(integer(trunc(r * 2.0**24)), 24));
+      if ENABLES(n) = "1111" then
+        words(n) := data(23 downto 0);
+      end if;
+      avp_writedata  <= data;
+      avp_byteenable <= ENABLES(n);
+      wait until rising_edge(clk) and avp_waitrequest = '0';
+    end loop;
+    avp_write      <= '0';
+    avp_byteenable <= "1111";
+    window_check(0, ENABLES'length, "byteenable");
+
+    -- past the last channel, writes are dropped and reads give 0
+    if TOTAL < 2**13 then
+      avp_address    <= std_logic_vector(to_unsigned(TOTAL, 13));
+      avp_burstcount <= x"01";
+      avp_writedata  <= x"00123456";
+      avp_write      <= '1';
+      wait until rising_edge(clk) and avp_waitrequest = '0';
+      avp_write <= '0';
+      avp_read  <= '1';
+      wait until rising_edge(clk) and avp_waitrequest = '0';
+      avp_read <= '0';
+      wait until rising_edge(clk) and avp_readdatavalid = '1';
+      if avp_readdata /= x"00000000" then
+        report "word " & integer'image(TOTAL) & ", past the last channel, reads " & to_hstring(avp_readdata)
+          severity error;
+        errors := errors + 1;
+      end if;
+    end if;
+
+    avs_write(clk, bus_out, bus_in, REG_COMMIT, x"00000001");
+    wait_frames(clk, bus_out, bus_in, irq, 2);
+    seen := frames;
+    wait until frames = seen + 1;
+
+    assert complete report "short frame" severity failure;
+    for n in 0 to TOTAL - 1 loop
+      if frame(n) /= words(n) then
+        report "LED " & integer'image(n) & ": sent " & to_hstring(frame(n)) & ", written " &
+               to_hstring(words(n)) severity error;
+        errors := errors + 1;
+      end if;
+    end loop;
+
+    assert errors = 0 report "FAIL: " & integer'image(errors) & " words differ" severity failure;
+    report "PASS";
+    std.env.finish;
+  end process;
+
+  watchdog : process
+  begin
+    wait for 50 ms;
+    report "timed out" severity failure;
+    wait;
+  end process;
+
+end architecture sim;
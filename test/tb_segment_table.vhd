@@ -0,0 +1,211 @@
+-- altera vhdl_input_version vhdl_2008
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+use IEEE.math_real.all;
+
+library work;
+use work.ws2811_tb_pkg.all;
+
+-- Checks the colour segments of ws_2811_driver_avalon against a reference
+-- renderer. Every round writes a random background to the framebuffer and
+-- SEGMENTS random segments, some overlapping, some off (length 0) and some
+-- running past the last LED of the last channel, then decodes the frame
+-- that shows them off strip_output. The reference paints the background,
+-- then the segments from the last to the first, one LED at a time, so the
+-- lowest numbered segment wins where they overlap; the frame sent must
+-- match it LED for LED. Reports "PASS" and finishes, or fails with the
+-- number of LEDs that differed.
+entity tb_segment_table is
+  generic (
+    LED_COUNT : integer := 16;
+    CHANNELS  : integer := 2;
+    SEGMENTS  : integer := 8;
+    ROUNDS    : integer := 8;
+    SEED      : integer := 1
+  );
+end entity tb_segment_table;
+
+architecture sim of tb_segment_table is
+
+  constant CLK_PERIOD : time := 20 ns;
+  constant TOTAL      : natural := LED_COUNT * CHANNELS;
+
+  type segment_t is record
+    start  : natural;
+    length : natural;
+    colour : std_logic_vector(23 downto 0);
+  end record;
+  type segment_array is array (0 to SEGMENTS - 1) of segment_t;
+
+  signal clk : std_logic := '0';
+  signal rst : std_logic := '1';
+
+  signal bus_out : avs_out_t := AVS_IDLE;
+  signal bus_in  : avs_in_t;
+
+  signal irq          : std_logic;
+  signal strip_output : std_logic_vector(CHANNELS - 1 downto 0);
+
+  signal frame    : colour_array(0 to TOTAL - 1);
+  signal complete : boolean;
+  signal frames   : natural;
+
+  -- The reference: LED n counts along the channels one after the other,
+  -- like segment starts do
+  function render(background : colour_array; segments : segment_array) return colour_array is
+    variable leds : colour_array(0 to TOTAL - 1) := background;
+  begin
+    for k in SEGMENTS - 1 downto 0 loop
+      for n in 0 to TOTAL - 1 loop
+        if n >= segments(k).start and n < segments(k).start + segments(k).length then
+          leds(n) := segments(k).colour;
+        end if;
+      end loop;
+    end loop;
+    return leds;
+  end function;
+
+begin
+
+  clk <= not clk after CLK_PERIOD / 2;
+
+  dut : entity work.ws_2811_driver_avalon
+    generic map (
+      LED_COUNT => LED_COUNT,
+      CHANNELS  => CHANNELS,
+      SEGMENTS  => SEGMENTS
+    )
+    port map (
+      clk               => clk,
+      rst               => rst,
+      avs_read          => bus_out.read,
+      avs_write         => bus_out.write,
+      avs_address       => bus_out.address,
+      avs_readdata      => bus_in.readdata,
+      avs_writedata     => bus_out.writedata,
+      avs_waitrequest   => bus_in.waitrequest,
+      avp_read          => '0',
+      avp_write         => '0',
+      avp_address       => (others => '0'),
+      avp_burstcount    => x"01",
+      avp_writedata     => (others => '0'),
+      avp_byteenable    => "1111",
+      avp_readdata      => open,
+      avp_readdatavalid => open,
+      avp_waitrequest   => open,
+      avm_address       => open,
+      avm_read          => open,
+      avm_burstcount    => open,
+      avm_readdata      => (others => '0'),
+      avm_readdatavalid => '0',
+      avm_waitrequest   => '0',
+      asi_data          => (others => '0'),
+      asi_valid         => '0',
+      asi_ready         => open,
+      asi_startofpacket => '0',
+      asi_endofpacket   => '0',
+      irq               => irq,
+      strip_index_out   => open,
+      strip_output      => strip_output
+    );
+
+  decoder : entity work.ws2811_decoder
+    generic map (
+      LED_COUNT => LED_COUNT,
+      CHANNELS  => CHANNELS
+    )
+    port map (
+      clk      => clk,
+      strip    => strip_output,
+      frame    => frame,
+      complete => complete,
+      frames   => frames
+    );
+
+  stimulus : process
+    variable seed1      : positive := SEED;
+    variable seed2      : positive := 4093;
+    variable data       : std_logic_vector(31 downto 0);
+    variable stride     : natural;
+    variable background : colour_array(0 to TOTAL - 1);
+    variable segments   : segment_array;
+    variable expected   : colour_array(0 to TOTAL - 1);
+    variable seen       : natural;
+    variable errors     : natural := 0;
+
+    impure function random(limit : natural) return natural is
+      variable r : real;
+    begin
+      uniform(seed1, seed2, r);
+      return integer(trunc(r * real(limit)));
+    end function;
+
+    impure function random_colour return std_logic_vector is
+    begin
+      return std_logic_vector(to_unsigned(random(2**24), 24));
+    end function;
+  begin
+    wait for 5 * CLK_PERIOD;
+    wait until rising_edge(clk);
+    rst <= '0';
+    wait until rising_edge(clk);
+
+    avs_read(clk, bus_out, bus_in, REG_STRIDE, data);
+    stride := to_integer(unsigned(data));
+    set_sim_timing(clk, bus_out, bus_in);
+    avs_write(clk, bus_out, bus_in, REG_CTRL, (CTRL_FRAMEBUFFER => '1', others => '0'));
+
+    for round in 0 to ROUNDS - 1 loop
+      for n in 0 to TOTAL - 1 loop
+        background(n) := random_colour;
+        avs_write(clk, bus_out, bus_in, FB_BASE + (n / LED_COUNT) * stride + n mod LED_COUNT,
+                  x"00" & background(n));
+      end loop;
+      avs_write(clk, bus_out, bus_in, REG_COMMIT, x"00000001");
+
+      -- starts up to a quarter past the end, lengths up to half the LEDs;
+      -- one in four segments is off
+      for k in 0 to SEGMENTS - 1 loop
+        segments(k).start  := random(TOTAL + TOTAL / 4);
+        segments(k).length := random(TOTAL / 2 + 1);
+        if random(4) = 0 then
+          segments(k).length := 0;
+        end if;
+        segments(k).colour := random_colour;
+        avs_write(clk, bus_out, bus_in, SEGMENT_BASE + 4 * k,
+                  std_logic_vector(to_unsigned(segments(k).start, 32)));
+        avs_write(clk, bus_out, bus_in, SEGMENT_BASE + 4 * k + 1,
+                  std_logic_vector(to_unsigned(segments(k).length, 32)));
+        avs_write(clk, bus_out, bus_in, SEGMENT_BASE + 4 * k + 2, x"00" & segments(k).colour);
+      end loop;
+      expected := render(background, segments);
+
+      wait_frames(clk, bus_out, bus_in, irq, 2);
+      seen := frames;
+      wait until frames = seen + 1;
+
+      assert complete report "round " & integer'image(round) & ": short frame" severity failure;
+      for n in 0 to TOTAL - 1 loop
+        if frame(n) /= expected(n) then
+          report "round " & integer'image(round) & ", LED " & integer'image(n) & ": sent " &
+                 to_hstring(frame(n)) & ", reference " & to_hstring(expected(n)) severity error;
+          errors := errors + 1;
+        end if;
+      end loop;
+    end loop;
+
+    assert errors = 0 report "FAIL: " & integer'image(errors) & " LEDs differ" severity failure;
+    report "PASS: " & integer'image(ROUNDS) & " rounds of " & integer'image(SEGMENTS) & " segments";
+    std.env.finish;
+  end process;
+
+  watchdog : process
+  begin
+    wait for 50 ms;
+    report "timed out" severity failure;
+    wait;
+  end process;
+
+end architecture sim;
@@ -0,0 +1,273 @@
+-- altera vhdl_input_version vhdl_2008
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+
+-- Stands in for async_conditioner in tb_stop_button, so the bench drives
+-- blip itself instead of waiting out the 1 ms debounce for every press.
+entity tb_blip_source is
+  port (
+    clk   : in std_ulogic;
+    rst   : in std_ulogic;
+    async : in std_ulogic;
+    sync  : out std_ulogic
+  );
+end entity tb_blip_source;
+
+architecture sim of tb_blip_source is
+begin
+  sync <= async;
+end architecture sim;
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+use IEEE.math_real.all;
+
+-- Press stress test for stop_button_avalon. A presser sends PRESSES blips,
+-- one clock each with one to three clocks between them, the fastest
+-- one_pulse can give and slower, each with a random strip_index, some
+-- inside the win window and some not. A bus master polls the press
+-- register (0x20) and press_hit (0x24) at random intervals, as the
+-- driver's read-and-clear does, so blips land on the clock a read of the
+-- press register is taken as well as between reads. A model of the
+-- component, kept from the same blips and reads, gives what every read
+-- should return: the sum of the press count deltas must come to PRESSES,
+-- and the latched press, won and press_hit must describe the presses since
+-- the last read and the strip_index of the last of them. It also fails if
+-- no blip landed on the clock of a press read. Run it through the
+-- configuration tb_stop_button_blip, which puts tb_blip_source in place of
+-- the conditioner. Reports "PASS" and finishes, or fails at the first read
+-- that doesn't match.
+entity tb_stop_button is
+  generic (
+    PRESSES : integer := 5000;
+    WIN_LO  : integer := 40;
+    WIN_HI  : integer := 59;
+    SEED    : integer := 1
+  );
+end entity tb_stop_button;
+
+architecture sim of tb_stop_button is
+
+  constant CLK_PERIOD : time := 20 ns;
+
+  -- what a read of the press register should return
+  type press_t is record
+    count   : natural;
+    pressed : std_logic;
+    won     : std_logic;
+    hit     : natural;
+  end record;
+
+  component stop_button_avalon is
+    port (
+      clk           : in std_ulogic;
+      rst           : in std_ulogic;
+      avs_read      : in std_logic;
+      avs_write     : in std_logic;
+      avs_address   : in std_logic_vector(3 downto 0);
+      avs_readdata  : out std_logic_vector(31 downto 0);
+      avs_writedata : in std_logic_vector(31 downto 0);
+      irq           : out std_logic;
+      strip_index   : in std_logic_vector(31 downto 0);
+      stop_button   : in std_ulogic
+    );
+  end component stop_button_avalon;
+
+  signal clk : std_logic := '0';
+  signal rst : std_logic := '1';
+
+  signal avs_read      : std_logic := '0';
+  signal avs_write     : std_logic := '0';
+  signal avs_address   : std_logic_vector(3 downto 0) := (others => '0');
+  signal avs_readdata  : std_logic_vector(31 downto 0);
+  signal avs_writedata : std_logic_vector(31 downto 0) := (others => '0');
+  signal irq           : std_logic;
+
+  signal blip        : std_ulogic := '0';
+  signal strip_index : std_logic_vector(31 downto 0) := (others => '0');
+
+  signal pressing : boolean := false;
+  signal pressed  : boolean := false;
+
+  signal expected   : press_t := (0, '0', '0', 0);
+  -- blips on the clock a read of the press register was taken
+  signal coincident : natural := 0;
+
+begin
+
+  clk <= not clk after CLK_PERIOD / 2;
+
+  dut : component stop_button_avalon
+    port map (
+      clk           => clk,
+      rst           => rst,
+      avs_read      => avs_read,
+      avs_write     => avs_write,
+      avs_address   => avs_address,
+      avs_readdata  => avs_readdata,
+      avs_writedata => avs_writedata,
+      irq           => irq,
+      strip_index   => strip_index,
+      stop_button   => blip
+    );
+
+  presser : process
+    variable seed1 : positive := SEED;
+    variable seed2 : positive := 4093;
+    variable r     : real;
+  begin
+    wait until pressing;
+    for n in 1 to PRESSES loop
+      uniform(seed1, seed2, r);
+      for idle in 0 to integer(trunc(r * 3.0)) loop
+        wait until rising_edge(clk);
+      end loop;
+      uniform(seed1, seed2, r);
+      strip_index <= std_logic_vector(to_unsigned(integer(trunc(r * 100.0)), 32));
+      blip        <= '1';
+      wait until rising_edge(clk);
+      blip <= '0';
+    end loop;
+    pressed <= true;
+    wait;
+  end process;
+
+  -- The component as the bench expects it to behave: a read of the press
+  -- register returns what came before its first clock and clears the press
+  -- and win, and a blip on that clock is left for the next read
+  model : process
+    variable read_wait : std_logic := '0';
+    variable state     : press_t := (0, '0', '0', 0);
+  begin
+    wait until rising_edge(clk);
+    if rst = '0' then
+      if avs_read = '1' and read_wait = '0' and avs_address = "1000" then
+        expected      <= state;
+        state.pressed := '0';
+        state.won     := '0';
+        if blip = '1' then
+          coincident <= coincident + 1;
+        end if;
+      end if;
+      if blip = '1' then
+        state.count   := (state.count + 1) mod 2**16;
+        state.pressed := '1';
+        state.hit     := to_integer(unsigned(strip_index));
+        if state.hit >= WIN_LO and state.hit <= WIN_HI then
+          state.won := '1';
+        end if;
+      end if;
+      if avs_read = '1' then
+        read_wait := not read_wait;
+      else
+        read_wait := '0';
+      end if;
+    end if;
+  end process;
+
+  master : process
+    variable seed1    : positive := SEED;
+    variable seed2    : positive := 24571;
+    variable r        : real;
+    variable data     : std_logic_vector(31 downto 0);
+    variable hit      : std_logic_vector(31 downto 0);
+    variable count    : natural;
+    variable last     : natural := 0;
+    variable total    : natural := 0;
+    variable reads    : natural := 0;
+    variable finished : boolean;
+
+    procedure bus_write(address : natural; value : natural) is
+    begin
+      avs_address   <= std_logic_vector(to_unsigned(address, 4));
+      avs_writedata <= std_logic_vector(to_unsigned(value, 32));
+      avs_write     <= '1';
+      wait until rising_edge(clk);
+      avs_write <= '0';
+    end procedure;
+
+    -- a read holds avs_read for two clocks and takes the readdata
+    -- registered on the first
+    procedure bus_read(address : natural; value : out std_logic_vector(31 downto 0)) is
+    begin
+      avs_address <= std_logic_vector(to_unsigned(address, 4));
+      avs_read    <= '1';
+      wait until rising_edge(clk);
+      wait until rising_edge(clk);
+      value    := avs_readdata;
+      avs_read <= '0';
+    end procedure;
+  begin
+    wait for 5 * CLK_PERIOD;
+    wait until rising_edge(clk);
+    rst <= '0';
+    wait until rising_edge(clk);
+
+    bus_write(4, WIN_LO);
+    bus_write(5, WIN_HI);
+    pressing <= true;
+
+    loop
+      -- once the presser is done, one more read picks up the last presses
+      finished := pressed;
+      uniform(seed1, seed2, r);
+      for idle in 1 to integer(trunc(r * 16.0)) loop
+        wait until rising_edge(clk);
+      end loop;
+
+      bus_read(8, data);
+      bus_read(9, hit);
+      reads := reads + 1;
+
+      count := to_integer(unsigned(data(31 downto 16)));
+      assert count = expected.count
+        report "read " & integer'image(reads) & ": press count " & integer'image(count) & ", expected " &
+               integer'image(expected.count) severity failure;
+      assert data(0) = expected.pressed
+        report "read " & integer'image(reads) & ": press bit " & std_logic'image(data(0)) & ", expected " &
+               std_logic'image(expected.pressed) severity failure;
+      assert data(1) = expected.won
+        report "read " & integer'image(reads) & ": won " & std_logic'image(data(1)) & ", expected " &
+               std_logic'image(expected.won) severity failure;
+      assert to_integer(unsigned(hit)) = expected.hit
+        report "read " & integer'image(reads) & ": press_hit " & integer'image(to_integer(unsigned(hit))) &
+               ", expected " & integer'image(expected.hit) severity failure;
+
+      total := total + (count - last) mod 2**16;
+      last  := count;
+      exit when finished;
+    end loop;
+
+    assert total = PRESSES
+      report "FAIL: " & integer'image(total) & " presses counted, " & integer'image(PRESSES) & " sent"
+      severity failure;
+    assert coincident > 0 report "FAIL: no press on the clock of a press read, so that case is untested"
+      severity failure;
+    report "PASS: " & integer'image(PRESSES) & " presses over " & integer'image(reads) & " reads, " &
+           integer'image(coincident) & " on the clock of a read";
+    std.env.finish;
+  end process;
+
+  watchdog : process
+  begin
+    wait for 10 ms;
+    report "timed out" severity failure;
+    wait;
+  end process;
+
+end architecture sim;
+
+configuration tb_stop_button_blip of tb_stop_button is
+  for sim
+    for dut : stop_button_avalon
+      use entity work.stop_button_avalon(arch);
+      for arch
+        for CONDITIONER : async_conditioner
+          use entity work.tb_blip_source(sim);
+        end for;
+      end for;
+    end for;
+  end for;
+end configuration tb_stop_button_blip;
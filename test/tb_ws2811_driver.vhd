@@ -0,0 +1,276 @@
+-- altera vhdl_input_version vhdl_2008
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+use IEEE.math_real.all;
+
+library work;
+use work.ws2811_tb_pkg.all;
+
+-- Self-checking testbench for the WS2811 output of ws_2811_driver_avalon.
+-- It sets the bit timing and latch from its generics, then writes FRAMES
+-- frames of random colours to the framebuffer through the register slave,
+-- commits each one and waits for the frame_done interrupt that shows it.
+-- A monitor samples strip_output every clock and decodes every channel back
+-- into 24-bit words (green, red, blue, most significant bit first). In the
+-- frames it checks:
+--   - every high time is T0H or T1H, and decodes to the bit it stands for
+--   - every bit slot is max(T0H + T0L, T1H + T1L), so the low time of a bit
+--     is at least its T0L or T1L
+--   - every channel sends LED_COUNT words, equal to the frame written
+--   - the line is low between frames for at least LATCH, and for no more
+--     than LATCH and one bit slot
+-- Reports "PASS" and finishes, or fails with the errors counted.
+entity tb_ws2811_driver is
+  generic (
+    LED_COUNT : integer := 8;
+    CHANNELS  : integer := 2;
+    -- clock cycles of 20 ns; LATCH must be longer than a bit slot
+    T0H       : integer := 5;
+    T0L       : integer := 13;
+    T1H       : integer := 12;
+    T1L       : integer := 6;
+    LATCH     : integer := 60;
+    FRAMES    : integer := 4;
+    SEED      : integer := 1
+  );
+end entity tb_ws2811_driver;
+
+architecture sim of tb_ws2811_driver is
+
+  constant CLK_PERIOD : time := 20 ns;
+  constant BIT_PERIOD : natural := maximum(T0H + T0L, T1H + T1L);
+
+  type word_array is array (0 to CHANNELS * LED_COUNT - 1) of std_logic_vector(23 downto 0);
+
+  signal clk : std_logic := '0';
+  signal rst : std_logic := '1';
+
+  signal bus_out : avs_out_t := AVS_IDLE;
+  signal bus_in  : avs_in_t;
+
+  signal irq          : std_logic;
+  signal strip_output : std_logic_vector(CHANNELS - 1 downto 0);
+
+  -- the frame the monitor checks next, once armed
+  signal expected       : word_array := (others => (others => '0'));
+  signal armed          : boolean := false;
+  signal frames_checked : natural := 0;
+  signal errors         : natural := 0;
+
+  function grb(word : std_logic_vector(23 downto 0)) return string is
+  begin
+    return "G=" & to_hstring(word(23 downto 16)) & " R=" & to_hstring(word(15 downto 8)) &
+           " B=" & to_hstring(word(7 downto 0));
+  end function;
+
+begin
+
+  assert LATCH > BIT_PERIOD report "LATCH must be longer than a bit slot" severity failure;
+
+  clk <= not clk after CLK_PERIOD / 2;
+
+  dut : entity work.ws_2811_driver_avalon
+    generic map (
+      LED_COUNT => LED_COUNT,
+      CHANNELS  => CHANNELS
+    )
+    port map (
+      clk               => clk,
+      rst               => rst,
+      avs_read          => bus_out.read,
+      avs_write         => bus_out.write,
+      avs_address       => bus_out.address,
+      avs_readdata      => bus_in.readdata,
+      avs_writedata     => bus_out.writedata,
+      avs_waitrequest   => bus_in.waitrequest,
+      avp_read          => '0',
+      avp_write         => '0',
+      avp_address       => (others => '0'),
+      avp_burstcount    => x"01",
+      avp_writedata     => (others => '0'),
+      avp_byteenable    => "1111",
+      avp_readdata      => open,
+      avp_readdatavalid => open,
+      avp_waitrequest   => open,
+      avm_address       => open,
+      avm_read          => open,
+      avm_burstcount    => open,
+      avm_readdata      => (others => '0'),
+      avm_readdatavalid => '0',
+      avm_waitrequest   => '0',
+      asi_data          => (others => '0'),
+      asi_valid         => '0',
+      asi_ready         => open,
+      asi_startofpacket => '0',
+      asi_endofpacket   => '0',
+      irq               => irq,
+      strip_index_out   => open,
+      strip_output      => strip_output
+    );
+
+  stimulus : process
+    variable seed1  : positive := SEED;
+    variable seed2  : positive := 7919;
+    variable r      : real;
+    variable data   : std_logic_vector(31 downto 0);
+    variable stride : natural;
+    variable frame  : word_array;
+  begin
+    wait for 5 * CLK_PERIOD;
+    wait until rising_edge(clk);
+    rst <= '0';
+    wait until rising_edge(clk);
+
+    avs_read(clk, bus_out, bus_in, REG_STRIDE, data);
+    stride := to_integer(unsigned(data));
+
+    -- taken up at the end of the frame being sent
+    avs_write(clk, bus_out, bus_in, REG_T0H, std_logic_vector(to_unsigned(T0H, 32)));
+    avs_write(clk, bus_out, bus_in, REG_T0L, std_logic_vector(to_unsigned(T0L, 32)));
+    avs_write(clk, bus_out, bus_in, REG_T1H, std_logic_vector(to_unsigned(T1H, 32)));
+    avs_write(clk, bus_out, bus_in, REG_T1L, std_logic_vector(to_unsigned(T1L, 32)));
+    avs_write(clk, bus_out, bus_in, REG_LATCH, std_logic_vector(to_unsigned(LATCH, 32)));
+    avs_write(clk, bus_out, bus_in, REG_CTRL, (CTRL_FRAMEBUFFER => '1', others => '0'));
+
+    -- the first frame_done takes the timing up, so the frame after it and
+    -- the latch before every frame checked are sent with it
+    for settle in 1 to 2 loop
+      avs_write(clk, bus_out, bus_in, REG_IRQ_CTRL, x"00000003");
+      wait until rising_edge(clk) and irq = '1';
+    end loop;
+
+    for f in 0 to FRAMES - 1 loop
+      -- the back page, which the strip does not show
+      for c in 0 to CHANNELS - 1 loop
+        for i in 0 to LED_COUNT - 1 loop
+          uniform(seed1, seed2, r);
+          frame(c * LED_COUNT + i) := std_logic_vector(to_unsigned(integer(trunc(r * 2.0**24)), 24));
+          avs_write(clk, bus_out, bus_in, FB_BASE + c * stride + i, x"00" & frame(c * LED_COUNT + i));
+        end loop;
+      end loop;
+      expected <= frame;
+
+      -- the interrupt after the commit is the frame_done that swaps the
+      -- pages; should a frame end between the two writes, the page has
+      -- swapped already and the next frame shows it just the same
+      avs_write(clk, bus_out, bus_in, REG_COMMIT, x"00000001");
+      avs_write(clk, bus_out, bus_in, REG_IRQ_CTRL, x"00000003");
+      wait until rising_edge(clk) and irq = '1';
+      armed <= true;
+      wait until frames_checked = f + 1;
+      armed <= false;
+      wait until rising_edge(clk);
+    end loop;
+
+    assert errors = 0 report "FAIL: " & integer'image(errors) & " errors" severity failure;
+    report "PASS: " & integer'image(FRAMES) & " frames on " & integer'image(CHANNELS) & " channels";
+    std.env.finish;
+  end process;
+
+  -- one frame at the reset timing, then the frames the stimulus waits
+  -- for, with time to spare
+  watchdog : process
+  begin
+    wait for (LED_COUNT * 24 * 125 + 5000 + (FRAMES + 3) * 2 * (LED_COUNT * 24 * BIT_PERIOD + LATCH)) * CLK_PERIOD +
+             FRAMES * CHANNELS * LED_COUNT * 4 * CLK_PERIOD + 100 us;
+    report "timed out after " & integer'image(frames_checked) & " frames" severity failure;
+    wait;
+  end process;
+
+  -- Counts clocks high and low on every channel. A rising edge after a
+  -- low of LATCH or more starts a frame, which is checked if the stimulus
+  -- armed the monitor by then; a low of LATCH ends it.
+  monitor : process
+    type nat_array is array (0 to CHANNELS - 1) of natural;
+    type bool_array is array (0 to CHANNELS - 1) of boolean;
+    type word_shift is array (0 to CHANNELS - 1) of std_logic_vector(23 downto 0);
+    variable level     : std_logic_vector(CHANNELS - 1 downto 0) := (others => '0');
+    variable high_len  : nat_array := (others => 0);
+    variable low_len   : nat_array := (others => 0);
+    variable last_high : nat_array := (others => 0);
+    variable bits      : nat_array := (others => 0);
+    variable in_frame  : bool_array := (others => false);
+    variable checking  : bool_array := (others => false);
+    variable shift     : word_shift := (others => (others => '0'));
+    variable ended     : natural := 0;
+    variable count     : natural := 0;
+    variable value     : std_logic;
+    variable index     : natural;
+  begin
+    wait until rising_edge(clk);
+    if rst = '0' then
+      for c in 0 to CHANNELS - 1 loop
+        if strip_output(c) = '1' and level(c) = '0' then
+          -- a bit slot starts
+          if not in_frame(c) then
+            if low_len(c) >= LATCH then
+              in_frame(c) := true;
+              checking(c) := armed;
+              bits(c)     := 0;
+              if checking(c) and (low_len(c) <= LATCH or low_len(c) > LATCH + BIT_PERIOD) then
+                report "channel " & integer'image(c) & ": low for " & integer'image(low_len(c)) &
+                       " clocks between frames, latch is " & integer'image(LATCH) severity error;
+                count := count + 1;
+              end if;
+            end if;
+          elsif checking(c) and low_len(c) /= BIT_PERIOD - last_high(c) then
+            report "channel " & integer'image(c) & ", bit " & integer'image(bits(c)) & ": low for " &
+                   integer'image(low_len(c)) & " clocks, expected " &
+                   integer'image(BIT_PERIOD - last_high(c)) severity error;
+            count := count + 1;
+          end if;
+          high_len(c) := 1;
+        elsif strip_output(c) = '1' then
+          high_len(c) := high_len(c) + 1;
+        elsif level(c) = '1' then
+          -- the high part of a bit is over
+          if high_len(c) = T1H then
+            value := '1';
+          else
+            value := '0';
+            if checking(c) and high_len(c) /= T0H then
+              report "channel " & integer'image(c) & ", bit " & integer'image(bits(c)) & ": high for " &
+                     integer'image(high_len(c)) & " clocks, neither T0H nor T1H" severity error;
+              count := count + 1;
+            end if;
+          end if;
+          shift(c)     := shift(c)(22 downto 0) & value;
+          bits(c)      := bits(c) + 1;
+          last_high(c) := high_len(c);
+          low_len(c)   := 1;
+          if checking(c) and bits(c) mod 24 = 0 and bits(c) <= 24 * LED_COUNT then
+            index := c * LED_COUNT + bits(c) / 24 - 1;
+            if shift(c) /= expected(index) then
+              report "channel " & integer'image(c) & ", LED " & integer'image(bits(c) / 24 - 1) &
+                     ": sent " & grb(shift(c)) & ", written " & grb(expected(index)) severity error;
+              count := count + 1;
+            end if;
+          end if;
+        else
+          low_len(c) := low_len(c) + 1;
+          if in_frame(c) and low_len(c) = LATCH then
+            in_frame(c) := false;
+            if checking(c) then
+              if bits(c) /= 24 * LED_COUNT then
+                report "channel " & integer'image(c) & ": " & integer'image(bits(c)) &
+                       " bits in the frame, expected " & integer'image(24 * LED_COUNT) severity error;
+                count := count + 1;
+              end if;
+              ended := ended + 1;
+            end if;
+          end if;
+        end if;
+        level(c) := strip_output(c);
+      end loop;
+
+      errors <= count;
+      if ended = CHANNELS then
+        ended := 0;
+        frames_checked <= frames_checked + 1;
+      end if;
+    end if;
+  end process;
+
+end architecture sim;
@@ -0,0 +1,201 @@
+-- altera vhdl_input_version vhdl_2008
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+
+library work;
+use work.ws2811_tb_pkg.all;
+
+-- Frame rate benchmark for ws_2811_driver_avalon. For every timing preset
+-- of ws2811_driver.c, and every active LED count in ACTIVE_COUNTS, it writes
+-- the five timing registers and active_count, lets one frame go by so they
+-- are taken up, and times two frame starts on strip_output(0).
+-- It reports the frame time, frames per second and pixels per second over
+-- all CHANNELS channels. It checks that the channels start every frame
+-- together, and that the time matches the register values: 24 bits per
+-- active LED times the bit slot, plus the latch period and the clock the
+-- driver spends loading the first pixel. The channels are sent in
+-- lockstep, so the time does not depend on CHANNELS.
+-- Reports "PASS" and finishes, or fails on the first frame that is off.
+entity tb_ws2811_timing is
+  generic (
+    LED_COUNT : integer := 250;
+    CHANNELS  : integer := 1
+  );
+end entity tb_ws2811_timing;
+
+architecture sim of tb_ws2811_timing is
+
+  constant CLK_PERIOD : time := 20 ns;
+  constant CLK_HZ     : real := 50.0e6;
+
+  -- the presets of ws2811_driver.c, in clock cycles
+  type preset_t is record
+    name  : string(1 to 7);
+    t0h   : natural;
+    t0l   : natural;
+    t1h   : natural;
+    t1l   : natural;
+    latch : natural;
+  end record;
+  type preset_array is array (natural range <>) of preset_t;
+
+  constant PRESETS : preset_array := (
+    ("ws2811 ", 25, 100, 60, 65, 5000),
+    ("ws2812b", 20, 43, 40, 23, 15000),
+    ("sk6812 ", 15, 45, 30, 30, 4000)
+  );
+
+  -- active_count values; 0 sends every LED, and counts past LED_COUNT are
+  -- left out
+  constant ACTIVE_COUNTS : integer_vector := (0, 100, 50, 10);
+
+  -- longer than any low within a frame, shorter than any latch
+  constant FRAME_GAP : natural := 1000;
+
+  signal clk : std_logic := '0';
+  signal rst : std_logic := '1';
+
+  signal bus_out : avs_out_t := AVS_IDLE;
+  signal bus_in  : avs_in_t;
+
+  signal irq          : std_logic;
+  signal strip_output : std_logic_vector(CHANNELS - 1 downto 0);
+
+  -- frame starts seen on channel 0, and the clock of the last one
+  signal frame_starts : natural := 0;
+  signal frame_clock  : natural := 0;
+
+  function reg(value : natural) return std_logic_vector is
+  begin
+    return std_logic_vector(to_unsigned(value, 32));
+  end function;
+
+begin
+
+  clk <= not clk after CLK_PERIOD / 2;
+
+  dut : entity work.ws_2811_driver_avalon
+    generic map (
+      LED_COUNT => LED_COUNT,
+      CHANNELS  => CHANNELS
+    )
+    port map (
+      clk               => clk,
+      rst               => rst,
+      avs_read          => bus_out.read,
+      avs_write         => bus_out.write,
+      avs_address       => bus_out.address,
+      avs_readdata      => bus_in.readdata,
+      avs_writedata     => bus_out.writedata,
+      avs_waitrequest   => bus_in.waitrequest,
+      avp_read          => '0',
+      avp_write         => '0',
+      avp_address       => (others => '0'),
+      avp_burstcount    => x"01",
+      avp_writedata     => (others => '0'),
+      avp_byteenable    => "1111",
+      avp_readdata      => open,
+      avp_readdatavalid => open,
+      avp_waitrequest   => open,
+      avm_address       => open,
+      avm_read          => open,
+      avm_burstcount    => open,
+      avm_readdata      => (others => '0'),
+      avm_readdatavalid => '0',
+      avm_waitrequest   => '0',
+      asi_data          => (others => '0'),
+      asi_valid         => '0',
+      asi_ready         => open,
+      asi_startofpacket => '0',
+      asi_endofpacket   => '0',
+      irq               => irq,
+      strip_index_out   => open,
+      strip_output      => strip_output
+    );
+
+  stimulus : process
+    variable p          : preset_t;
+    variable bit_period : natural;
+    variable expected   : natural;
+    variable measured   : natural;
+    variable start      : natural;
+    variable leds       : natural;
+    variable seconds    : real;
+  begin
+    wait for 5 * CLK_PERIOD;
+    wait until rising_edge(clk);
+    rst <= '0';
+    wait until rising_edge(clk);
+    avs_write(clk, bus_out, bus_in, REG_IRQ_CTRL, x"00000001");
+
+    for k in PRESETS'range loop
+      p := PRESETS(k);
+      avs_write(clk, bus_out, bus_in, REG_T0H, reg(p.t0h));
+      avs_write(clk, bus_out, bus_in, REG_T0L, reg(p.t0l));
+      avs_write(clk, bus_out, bus_in, REG_T1H, reg(p.t1h));
+      avs_write(clk, bus_out, bus_in, REG_T1L, reg(p.t1l));
+      avs_write(clk, bus_out, bus_in, REG_LATCH, reg(p.latch));
+
+      for a in ACTIVE_COUNTS'range loop
+        if ACTIVE_COUNTS(a) <= LED_COUNT then
+          avs_write(clk, bus_out, bus_in, REG_ACTIVE, reg(ACTIVE_COUNTS(a)));
+          if ACTIVE_COUNTS(a) = 0 then
+            leds := LED_COUNT;
+          else
+            leds := ACTIVE_COUNTS(a);
+          end if;
+
+          -- the frame_done after the writes takes them up, and the frame
+          -- after it is the first one sent with them
+          avs_write(clk, bus_out, bus_in, REG_IRQ_CTRL, x"00000003");
+          wait until rising_edge(clk) and irq = '1';
+          avs_write(clk, bus_out, bus_in, REG_IRQ_CTRL, x"00000003");
+          start := frame_starts;
+          wait until frame_starts = start + 1;
+          measured := frame_clock;
+          wait until frame_starts = start + 2;
+          measured := frame_clock - measured;
+
+          bit_period := maximum(p.t0h + p.t0l, p.t1h + p.t1l);
+          expected   := 24 * leds * bit_period + maximum(p.latch, 1) + 1;
+          seconds    := real(measured) / CLK_HZ;
+          report p.name & ": " & integer'image(leds) & " of " & integer'image(LED_COUNT) &
+                 " LEDs, frame " & to_string(seconds * 1.0e6, 2) & " us, " &
+                 to_string(1.0 / seconds, 1) & " frames/s, " &
+                 to_string(real(CHANNELS * leds) / seconds, 0) & " pixels/s on " &
+                 integer'image(CHANNELS) & " channels";
+          assert measured = expected
+            report p.name & ", " & integer'image(leds) & " LEDs: frame took " & integer'image(measured) &
+                   " clocks, expected " & integer'image(expected) severity failure;
+        end if;
+      end loop;
+    end loop;
+
+    report "PASS";
+    std.env.finish;
+  end process;
+
+  -- a rising edge after a low of FRAME_GAP clocks or more starts a frame,
+  -- on every channel at once
+  monitor : process
+    variable clock   : natural := 0;
+    variable low_len : natural := 0;
+  begin
+    wait until rising_edge(clk);
+    clock := clock + 1;
+    if strip_output(0) = '1' then
+      if low_len >= FRAME_GAP then
+        assert strip_output = (strip_output'range => '1')
+          report "channels out of step at a frame start" severity failure;
+        frame_starts <= frame_starts + 1;
+        frame_clock  <= clock;
+      end if;
+      low_len := 0;
+    else
+      low_len := low_len + 1;
+    end if;
+  end process;
+
+end architecture sim;
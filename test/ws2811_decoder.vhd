@@ -0,0 +1,88 @@
+-- altera vhdl_input_version vhdl_2008
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+
+library work;
+use work.ws2811_tb_pkg.all;
+
+-- Decodes the strip_output lines of ws_2811_driver_avalon back into the
+-- colours sent, for the testbenches that check what the pixel path shows
+-- rather than the waveform (tb_ws2811_driver checks that). Samples every
+-- clock: a high longer than THRESHOLD clocks is a 1, and a low of GAP
+-- clocks ends a frame. At the end of every frame, frame holds LED i of
+-- channel c at c * LED_COUNT + i, complete tells whether every channel
+-- sent exactly LED_COUNT LEDs, and frames counts up by one.
+entity ws2811_decoder is
+  generic (
+    LED_COUNT : integer;
+    CHANNELS  : integer;
+    THRESHOLD : natural := (SIM_T0H + SIM_T1H) / 2;
+    GAP       : natural := SIM_LATCH
+  );
+  port (
+    clk      : in std_logic;
+    strip    : in std_logic_vector(CHANNELS - 1 downto 0);
+    frame    : out colour_array(0 to CHANNELS * LED_COUNT - 1);
+    complete : out boolean;
+    frames   : out natural
+  );
+end entity ws2811_decoder;
+
+architecture sim of ws2811_decoder is
+begin
+
+  decode : process
+    type nat_array is array (0 to CHANNELS - 1) of natural;
+    variable level    : std_logic_vector(CHANNELS - 1 downto 0) := (others => '0');
+    variable high_len : nat_array := (others => 0);
+    variable low_len  : nat_array := (others => 0);
+    variable bits     : nat_array := (others => 0);
+    variable shift    : colour_array(0 to CHANNELS - 1) := (others => (others => '0'));
+    variable words    : colour_array(0 to CHANNELS * LED_COUNT - 1) := (others => (others => '0'));
+    variable count    : natural := 0;
+    variable all_sent : boolean;
+  begin
+    frames <= 0;
+    complete <= false;
+    loop
+      wait until rising_edge(clk);
+      for c in 0 to CHANNELS - 1 loop
+        if strip(c) = '1' then
+          high_len(c) := high_len(c) + 1;
+          low_len(c)  := 0;
+        else
+          if level(c) = '1' then
+            if high_len(c) > THRESHOLD then
+              shift(c) := shift(c)(22 downto 0) & '1';
+            else
+              shift(c) := shift(c)(22 downto 0) & '0';
+            end if;
+            bits(c)  := bits(c) + 1;
+            if bits(c) mod 24 = 0 and bits(c) <= 24 * LED_COUNT then
+              words(c * LED_COUNT + bits(c) / 24 - 1) := shift(c);
+            end if;
+          end if;
+          high_len(c) := 0;
+          low_len(c)  := low_len(c) + 1;
+        end if;
+        level(c) := strip(c);
+      end loop;
+
+      -- the channels go in lockstep, so channel 0 marks the end of a frame
+      if low_len(0) = GAP and bits(0) > 0 then
+        all_sent := true;
+        for c in 0 to CHANNELS - 1 loop
+          all_sent := all_sent and bits(c) = 24 * LED_COUNT;
+          bits(c)  := 0;
+        end loop;
+        count    := count + 1;
+        frame    <= words;
+        complete <= all_sent;
+        frames   <= count;
+      end if;
+    end loop;
+  end process;
+
+end architecture sim;
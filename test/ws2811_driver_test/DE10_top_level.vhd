@@ -73,8 +73,16 @@ architecture DE10Nano_arch of DE10_Top_Level is
   constant CLK_PERIOD : time    := 20 ns; 
   constant LED_COUNT  : integer := 250; --Number of LEDs in the WS2811 chain
 
+  -- WS2811 400 kHz timings in clock cycles
+  constant T0H          : unsigned(15 downto 0) := to_unsigned(integer(500 ns / CLK_PERIOD), 16);
+  constant T0L          : unsigned(15 downto 0) := to_unsigned(integer(2000 ns / CLK_PERIOD), 16);
+  constant T1H          : unsigned(15 downto 0) := to_unsigned(integer(1200 ns / CLK_PERIOD), 16);
+  constant T1L          : unsigned(15 downto 0) := to_unsigned(integer(1300 ns / CLK_PERIOD), 16);
+  constant LATCH_PERIOD : unsigned(15 downto 0) := to_unsigned(integer(100 us / CLK_PERIOD), 16);
+
   -- Signals for the ws2811 driver
-  signal data_array  : std_logic_vector((24 * LED_COUNT) - 1 downto 0);
+  signal pixel_index : natural range 0 to LED_COUNT - 1;
+  signal pixel_data  : std_logic_vector(23 downto 0);
   signal rgb_all     : std_logic_vector(23 downto 0);
   signal rgb_single  : std_logic_vector(23 downto 0);
   signal strip_index : integer range 0 to LED_COUNT - 1 := 0;
@@ -82,14 +90,27 @@ architecture DE10Nano_arch of DE10_Top_Level is
   -- Define Components
   component ws2811_driver is
     generic (
-      CLK_PERIOD : time;
-      LED_COUNT  : integer
+      LED_COUNT  : integer;
+      CHANNELS   : integer
     );
     port (
       clk          : in std_logic;
       rst          : in std_logic;
-      data_array   : in std_logic_vector((24 * LED_COUNT) - 1 downto 0);
-      strip_output : out std_logic
+      t0h          : in unsigned(15 downto 0);
+      t0l          : in unsigned(15 downto 0);
+      t1h          : in unsigned(15 downto 0);
+      t1l          : in unsigned(15 downto 0);
+      latch_period : in unsigned(15 downto 0);
+      pixel_count  : in natural range 1 to LED_COUNT;
+      on_demand    : in std_logic;
+      start        : in std_logic;
+      pixel_index  : out natural range 0 to LED_COUNT - 1;
+      pixel_data   : in std_logic_vector(24 * CHANNELS - 1 downto 0);
+      pixel_taken  : out std_logic;
+      frame_done   : out std_logic;
+      frame_load   : out std_logic;
+      frame_start  : out std_logic;
+      strip_output : out std_logic_vector(CHANNELS - 1 downto 0)
     );
   end component;
 
@@ -107,36 +128,35 @@ begin
   -- Sets switches to strip index
   strip_index <= to_integer(unsigned(SW));
   
-  process(SW, rgb_single, rgb_all)
-    variable i : integer;
-  begin
-    -- Clear the entire data array first
-    data_array <= (others => '0');
-
-    -- Default: Set all LEDs to full red
-    for i in 0 to LED_COUNT - 1 loop
-      data_array(((i+1) * 24 - 1) downto (i * 24)) <= rgb_all(23 downto 0);
-    end loop;
-
-    -- Set specific LED with a different color
-  if strip_index < LED_COUNT then
-    data_array(((strip_index+1) * 24 - 1) downto (strip_index * 24)) <= rgb_single(23 downto 0);
-  end if;
-  end process;
+  -- Set specific LED with a different color, all others full red
+  pixel_data <= rgb_single when pixel_index = strip_index else rgb_all;
 
 
   -- Instantiate driver
   DRIVER1 : ws2811_driver
   generic map(
-    CLK_PERIOD => CLK_PERIOD,
-    LED_COUNT  => LED_COUNT
+    LED_COUNT  => LED_COUNT,
+    CHANNELS   => 1
   )
   port map
   (
     clk          => FPGA_CLK1_50,
     rst          => not KEY(0),
-    data_array   => data_array,
-    strip_output => Audio_Mini_GPIO_0(0)
+    t0h          => T0H,
+    t0l          => T0L,
+    t1h          => T1H,
+    t1l          => T1L,
+    latch_period => LATCH_PERIOD,
+    pixel_count  => LED_COUNT,
+    on_demand    => '0',
+    start        => '0',
+    pixel_index  => pixel_index,
+    pixel_data   => pixel_data,
+    pixel_taken  => open,
+    frame_done   => open,
+    frame_load   => open,
+    frame_start  => open,
+    strip_output(0) => Audio_Mini_GPIO_0(0)
   );
 
   -- Status LEDs
@@ -0,0 +1,143 @@
+-- altera vhdl_input_version vhdl_2008
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+
+-- Bus functional model of the register slave of ws_2811_driver_avalon, and
+-- its register map, for the testbenches in this directory. Addresses are
+-- word addresses, as on avs_address; the framebuffer starts at FB_BASE.
+package ws2811_tb_pkg is
+
+  constant REG_RGB_ALL     : natural := 1;
+  constant REG_CTRL        : natural := 3;
+  constant REG_COMMIT      : natural := 5;
+  constant REG_IRQ_CTRL    : natural := 6;
+  constant REG_FRAME_COUNT : natural := 7;
+  constant REG_T0H         : natural := 8;
+  constant REG_T0L         : natural := 9;
+  constant REG_T1H         : natural := 10;
+  constant REG_T1L         : natural := 11;
+  constant REG_LATCH       : natural := 12;
+  constant REG_ACTIVE      : natural := 13;
+  constant REG_STRIDE      : natural := 15;
+  constant REG_BRIGHTNESS  : natural := 22;
+  constant REG_HUE_OFFSET  : natural := 25;
+  constant REG_STREAM_UNDERFLOW    : natural := 31;
+  constant REG_STREAM_BACKPRESSURE : natural := 32;
+  constant SPRITE_BASE     : natural := 64;
+  constant SEGMENT_BASE    : natural := 128;
+  constant GAMMA_BASE      : natural := 512;
+  constant FB_BASE         : natural := 2**13;
+
+  constant CTRL_FRAMEBUFFER : natural := 0;
+  constant CTRL_GAMMA       : natural := 4;
+  constant CTRL_HSV         : natural := 8;
+  constant CTRL_STREAM      : natural := 9;
+
+  -- A quick timing for simulation, in clock cycles: an 18-clock bit slot
+  -- and a 60-clock latch. ws2811_decoder tells the bits apart by it.
+  constant SIM_T0H   : natural := 5;
+  constant SIM_T0L   : natural := 13;
+  constant SIM_T1H   : natural := 12;
+  constant SIM_T1L   : natural := 6;
+  constant SIM_LATCH : natural := 60;
+
+  -- LED colours as sent, green in bits 23-16, red in 15-8, blue in 7-0
+  type colour_array is array (natural range <>) of std_logic_vector(23 downto 0);
+
+  -- what the testbench drives, and what it gets back
+  type avs_out_t is record
+    read      : std_logic;
+    write     : std_logic;
+    address   : std_logic_vector(13 downto 0);
+    writedata : std_logic_vector(31 downto 0);
+  end record;
+
+  type avs_in_t is record
+    readdata    : std_logic_vector(31 downto 0);
+    waitrequest : std_logic;
+  end record;
+
+  constant AVS_IDLE : avs_out_t := ('0', '0', (others => '0'), (others => '0'));
+
+  -- Both start just after a rising edge of clk and return just after the
+  -- edge that completes the access
+  procedure avs_write(signal clk : in std_logic;
+                      signal bus_out : out avs_out_t;
+                      signal bus_in : in avs_in_t;
+                      address : natural;
+                      data : std_logic_vector(31 downto 0));
+
+  procedure avs_read(signal clk : in std_logic;
+                     signal bus_out : out avs_out_t;
+                     signal bus_in : in avs_in_t;
+                     address : natural;
+                     data : out std_logic_vector(31 downto 0));
+
+  -- Loads the SIM_* timing; it is taken up at the end of the frame being
+  -- sent
+  procedure set_sim_timing(signal clk : in std_logic;
+                           signal bus_out : out avs_out_t;
+                           signal bus_in : in avs_in_t);
+
+  -- Enables the frame-done interrupt, clears it and waits for count more.
+  -- After two, the last frame sent showed everything written and committed
+  -- before the call.
+  procedure wait_frames(signal clk : in std_logic;
+                        signal bus_out : out avs_out_t;
+                        signal bus_in : in avs_in_t;
+                        signal irq : in std_logic;
+                        count : positive);
+
+end package ws2811_tb_pkg;
+
+package body ws2811_tb_pkg is
+
+  procedure avs_write(signal clk : in std_logic;
+                      signal bus_out : out avs_out_t;
+                      signal bus_in : in avs_in_t;
+                      address : natural;
+                      data : std_logic_vector(31 downto 0)) is
+  begin
+    bus_out <= ('0', '1', std_logic_vector(to_unsigned(address, 14)), data);
+    wait until rising_edge(clk) and bus_in.waitrequest = '0';
+    bus_out <= AVS_IDLE;
+  end procedure;
+
+  procedure avs_read(signal clk : in std_logic;
+                     signal bus_out : out avs_out_t;
+                     signal bus_in : in avs_in_t;
+                     address : natural;
+                     data : out std_logic_vector(31 downto 0)) is
+  begin
+    bus_out <= ('1', '0', std_logic_vector(to_unsigned(address, 14)), (others => '0'));
+    wait until rising_edge(clk) and bus_in.waitrequest = '0';
+    data := bus_in.readdata;
+    bus_out <= AVS_IDLE;
+  end procedure;
+
+  procedure set_sim_timing(signal clk : in std_logic;
+                           signal bus_out : out avs_out_t;
+                           signal bus_in : in avs_in_t) is
+  begin
+    avs_write(clk, bus_out, bus_in, REG_T0H, std_logic_vector(to_unsigned(SIM_T0H, 32)));
+    avs_write(clk, bus_out, bus_in, REG_T0L, std_logic_vector(to_unsigned(SIM_T0L, 32)));
+    avs_write(clk, bus_out, bus_in, REG_T1H, std_logic_vector(to_unsigned(SIM_T1H, 32)));
+    avs_write(clk, bus_out, bus_in, REG_T1L, std_logic_vector(to_unsigned(SIM_T1L, 32)));
+    avs_write(clk, bus_out, bus_in, REG_LATCH, std_logic_vector(to_unsigned(SIM_LATCH, 32)));
+  end procedure;
+
+  procedure wait_frames(signal clk : in std_logic;
+                        signal bus_out : out avs_out_t;
+                        signal bus_in : in avs_in_t;
+                        signal irq : in std_logic;
+                        count : positive) is
+  begin
+    for n in 1 to count loop
+      avs_write(clk, bus_out, bus_in, REG_IRQ_CTRL, x"00000003");
+      wait until rising_edge(clk) and irq = '1';
+    end loop;
+  end procedure;
+
+end package body ws2811_tb_pkg;